@@ -16,9 +16,10 @@
 #else
  #include "WProgram.h"
 #endif
-#include <Wire.h>
+#include "I2CBus.h"
 #include <avr/pgmspace.h>
 #include "Adafruit_MCP23008.h"
+#include "Profiler.h"
 
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -30,37 +31,24 @@ void Adafruit_MCP23008::begin(uint8_t addr) {
   }
   i2caddr = addr;
 
-  Wire.begin();
+  // The bus is set up by i2cBus.begin()
 
-  // set defaults!
-  Wire.beginTransmission(MCP23008_ADDRESS | i2caddr);
-#if ARDUINO >= 100
-  Wire.write((byte)MCP23008_IODIR);
-  Wire.write((byte)0xFF);  // all inputs
-  Wire.write((byte)0x00);
-  Wire.write((byte)0x00);
-  Wire.write((byte)0x00);
-  Wire.write((byte)0x00);
-  Wire.write((byte)0x00);
-  Wire.write((byte)0x00);
-  Wire.write((byte)0x00);
-  Wire.write((byte)0x00);
-  Wire.write((byte)0x00);	
-#else
-  Wire.send(MCP23008_IODIR);
-  Wire.send(0xFF);  // all inputs
-  Wire.send(0x00);
-  Wire.send(0x00);
-  Wire.send(0x00);
-  Wire.send(0x00);
-  Wire.send(0x00);
-  Wire.send(0x00);
-  Wire.send(0x00);
-  Wire.send(0x00);
-  Wire.send(0x00);	
-#endif
-  Wire.endTransmission();
+  // SEQOP may still be set if only the MCU has been reset - the defaults below are written with the address pointer incrementing
+  write8(MCP23008_IOCON, 0x00);
 
+  // set defaults!
+  i2cBus.beginTransmission(MCP23008_ADDRESS | i2caddr, I2C_PRIORITY_HIGH);
+  i2cBus.write((byte)MCP23008_IODIR);
+  i2cBus.write((byte)0xFF);  // all inputs
+  for (uint8_t i = 0; i < 9; i++)
+    i2cBus.write((byte)0x00);
+  i2cBus.endTransmission(true);
+  PROFILE_I2C(MCP23008_ADDRESS | i2caddr, 11);
+  iodir = 0xFF;
+  olat = 0x00;
+
+  // Keep the address pointer on the register written, so writeMask() can write OLAT twice in one transaction
+  write8(MCP23008_IOCON, MCP23008_IOCON_SEQOP);
 }
 
 void Adafruit_MCP23008::begin(void) {
@@ -68,23 +56,25 @@ void Adafruit_MCP23008::begin(void) {
 }
 
 void Adafruit_MCP23008::pinMode(uint8_t p, uint8_t d) {
-  uint8_t iodir;
-  
+  uint8_t newIodir = iodir;
 
   // only 8 bits!
   if (p > 7)
     return;
-  
-  iodir = read8(MCP23008_IODIR);
 
   // set the pin and direction
   if (d == INPUT) {
-    iodir |= 1 << p; 
+    newIodir |= 1 << p; 
   } else {
-    iodir &= ~(1 << p);
+    newIodir &= ~(1 << p);
   }
 
   // write the new IODIR
+  writeIODIR(newIodir);
+}
+
+void Adafruit_MCP23008::writeIODIR(uint8_t d) {
+  iodir = d;
   write8(MCP23008_IODIR, iodir);
 }
 
@@ -94,29 +84,35 @@ uint8_t Adafruit_MCP23008::readGPIO(void) {
 }
 
 void Adafruit_MCP23008::writeGPIO(uint8_t gpio) {
+  olat = gpio;
   write8(MCP23008_GPIO, gpio);
 }
 
+void Adafruit_MCP23008::writeMask(uint8_t mask, uint8_t value, bool breakBeforeMake) {
+  uint8_t newOlat = (olat & ~mask) | (value & mask);
+  // Only release pins first - the pins going HIGH keep their current state
+  uint8_t released = olat & newOlat;
+  bool breakFirst = breakBeforeMake && released != olat && released != newOlat;
+
+  // Relay and trigger writes are sent before any display traffic waiting on the bus - and waited for, so the pins have switched when this returns
+  i2cBus.beginTransmission(MCP23008_ADDRESS | i2caddr, I2C_PRIORITY_HIGH);
+  i2cBus.write((byte)MCP23008_OLAT);
+  if (breakFirst)
+    i2cBus.write((byte)released);
+  i2cBus.write((byte)newOlat);
+  i2cBus.endTransmission(true);
+  PROFILE_I2C(MCP23008_ADDRESS | i2caddr, breakFirst ? 3 : 2);
+  olat = newOlat;
+}
+
 
 void Adafruit_MCP23008::digitalWrite(uint8_t p, uint8_t d) {
-  uint8_t gpio;
-  
   // only 8 bits!
   if (p > 7)
     return;
 
-  // read the current GPIO output latches
-  gpio = readGPIO();
-
-  // set the pin and direction
-  if (d == HIGH) {
-    gpio |= 1 << p; 
-  } else {
-    gpio &= ~(1 << p);
-  }
-
-  // write the new GPIO
-  writeGPIO(gpio);
+  // set the pin from the cached output latches
+  writeMask(1 << p, (d == HIGH) ? 0xFF : 0x00);
 }
 
 void Adafruit_MCP23008::pullUp(uint8_t p, uint8_t d) {
@@ -147,31 +143,23 @@ uint8_t Adafruit_MCP23008::digitalRead(uint8_t p) {
 }
 
 uint8_t Adafruit_MCP23008::read8(uint8_t addr) {
-  Wire.beginTransmission(MCP23008_ADDRESS | i2caddr);
-#if ARDUINO >= 100
-  Wire.write((byte)addr);	
-#else
-  Wire.send(addr);	
-#endif
-  Wire.endTransmission();
-  Wire.requestFrom(MCP23008_ADDRESS | i2caddr, 1);
+  uint8_t data = 0;
 
-#if ARDUINO >= 100
-  return Wire.read();
-#else
-  return Wire.receive();
-#endif
+  i2cBus.beginTransmission(MCP23008_ADDRESS | i2caddr, I2C_PRIORITY_HIGH);
+  i2cBus.write((byte)addr);
+  i2cBus.endTransmission();
+  i2cBus.requestFrom(MCP23008_ADDRESS | i2caddr, &data, 1, I2C_PRIORITY_HIGH);
+  PROFILE_I2C(MCP23008_ADDRESS | i2caddr, 1);
+  PROFILE_I2C(MCP23008_ADDRESS | i2caddr, 1);
+
+  return data;
 }
 
 
 void Adafruit_MCP23008::write8(uint8_t addr, uint8_t data) {
-  Wire.beginTransmission(MCP23008_ADDRESS | i2caddr);
-#if ARDUINO >= 100
-  Wire.write((byte)addr);
-  Wire.write((byte)data);
-#else
-  Wire.send(addr);	
-  Wire.send(data);
-#endif
-  Wire.endTransmission();
+  i2cBus.beginTransmission(MCP23008_ADDRESS | i2caddr, I2C_PRIORITY_HIGH);
+  i2cBus.write((byte)addr);
+  i2cBus.write((byte)data);
+  i2cBus.endTransmission(true);
+  PROFILE_I2C(MCP23008_ADDRESS | i2caddr, 2);
 }
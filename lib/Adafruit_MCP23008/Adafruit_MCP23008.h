@@ -13,7 +13,7 @@
 
 #ifndef _ADAFRUIT_MCP23008_H
 #define _ADAFRUIT_MCP23008_H
-// Don't forget the Wire library
+// The device is accessed through the shared I2CBus - i2cBus.begin() must be called before begin()
 class Adafruit_MCP23008 {
 public:
   void begin(uint8_t addr);
@@ -26,8 +26,17 @@ public:
   uint8_t readGPIO(void);
   void writeGPIO(uint8_t);
 
+  // The output latches and directions are cached, so writes don't need to read the registers first
+  // Sets the pins in mask to the corresponding bits of value. If breakBeforeMake is true, pins
+  // going LOW are released before pins going HIGH are set - still in a single transaction
+  void writeMask(uint8_t mask, uint8_t value, bool breakBeforeMake = false);
+  // Sets the direction of all pins (a 1 bit is INPUT)
+  void writeIODIR(uint8_t);
+
  private:
   uint8_t i2caddr;
+  uint8_t olat;   // Shadow of OLAT
+  uint8_t iodir;  // Shadow of IODIR
   uint8_t read8(uint8_t addr);
   void write8(uint8_t addr, uint8_t data);
 };
@@ -47,4 +56,7 @@ public:
 #define MCP23008_GPIO 0x09
 #define MCP23008_OLAT 0x0A
 
-#endif
+// IOCON bits
+#define MCP23008_IOCON_SEQOP 0x20 // Disables the address pointer increment
+
+#endif
@@ -0,0 +1,166 @@
+#include "AdcSampler.h"
+#include <util/atomic.h>
+
+AdcSampler adcSampler;
+
+// Conversion result of the bandgap (measured with Vcc as reference) when Vcc is mV
+#define VCC_RAW(mV) ((ADC_SAMPLER_BANDGAP_MV * 1024L) / (mV))
+
+ISR(ADC_vect)
+{
+  adcSampler.isr();
+}
+
+AdcSampler::AdcSampler()
+{
+  powerLossMinRaw = 0xFFFF; // No power loss detection until a window is set
+  powerLossMaxRaw = 0;
+  powerLossDetected = false;
+}
+
+// ---------------------------------------------------
+void AdcSampler::begin(uint8_t pin1, uint8_t pin2)
+{
+  mux[0] = ADC_SAMPLER_BANDGAP_MUX;
+  mux[1] = (pin1 >= A0) ? pin1 - A0 : pin1;
+  mux[2] = (pin2 >= A0) ? pin2 - A0 : pin2;
+  historyPos = 0;
+  for (uint8_t i = 0; i < ADC_SAMPLER_CHANNELS; i++)
+    value[i] = 0;
+  for (uint8_t i = 0; i < ADC_SAMPLER_CHANNELS - 1; i++)
+  {
+    for (uint8_t j = 0; j < ADC_SAMPLER_AVERAGE; j++)
+      history[i][j] = 0;
+  }
+  rounds = 0;
+  resume();
+
+  while (rounds < ADC_SAMPLER_AVERAGE)
+    delay(1);
+}
+
+// ---------------------------------------------------
+void AdcSampler::stop()
+{
+  ADCSRA = 0;
+}
+
+// ---------------------------------------------------
+void AdcSampler::resume()
+{
+  // The conversion in progress when stopped is lost, so the current channel is started over
+  channel = 0;
+  discard = ADC_SAMPLER_DISCARD;
+  count = 0;
+  sum = 0;
+
+  // AVcc is used as reference for all channels, so only the mux is changed between conversions
+  ADMUX = _BV(REFS0) | mux[0];
+  // Enable the ADC and its interrupt and start the first conversion. Prescaler of 128 gives 125 kHz ADC clock (about 100 us per conversion) at 16 MHz
+  ADCSRA = _BV(ADEN) | _BV(ADIE) | _BV(ADSC) | _BV(ADPS2) | _BV(ADPS1) | _BV(ADPS0);
+}
+
+// ---------------------------------------------------
+void AdcSampler::setPowerLossWindow(uint16_t minMv, uint16_t maxMv)
+{
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+  {
+    powerLossMinRaw = VCC_RAW(maxMv);
+    powerLossMaxRaw = VCC_RAW(minMv);
+  }
+}
+
+// ---------------------------------------------------
+bool AdcSampler::powerLost()
+{
+  return powerLossDetected;
+}
+
+// ---------------------------------------------------
+void AdcSampler::clearPowerLoss()
+{
+  powerLossDetected = false;
+}
+
+// ---------------------------------------------------
+uint16_t AdcSampler::readVcc()
+{
+  uint16_t raw = readChannel(0);
+
+  if (raw == 0)
+    return 0;
+  return (ADC_SAMPLER_BANDGAP_MV * 1024L) / raw;
+}
+
+// ---------------------------------------------------
+uint16_t AdcSampler::read(uint8_t pin)
+{
+  uint8_t pinMux = (pin >= A0) ? pin - A0 : pin;
+
+  for (uint8_t i = 1; i < ADC_SAMPLER_CHANNELS; i++)
+  {
+    if (mux[i] == pinMux)
+      return readChannel(i) / ADC_SAMPLER_AVERAGE;
+  }
+  return 0;
+}
+
+// ---------------------------------------------------
+uint16_t AdcSampler::readChannel(uint8_t channel)
+{
+  uint16_t result;
+
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+  {
+    result = value[channel];
+  }
+  return result;
+}
+
+// ---------------------------------------------------
+void AdcSampler::isr()
+{
+  uint16_t result = ADC;
+
+  if (discard)
+  {
+    discard--;
+    ADCSRA |= _BV(ADSC);
+    return;
+  }
+
+  if (channel == 0)
+  {
+    // Vcc is not oversampled, so a power loss is detected as fast as possible
+    value[0] = result;
+    if (result > powerLossMinRaw && result < powerLossMaxRaw)
+      powerLossDetected = true;
+  }
+  else
+  {
+    sum += result;
+    if (++count < ADC_SAMPLER_OVERSAMPLING)
+    {
+      ADCSRA |= _BV(ADSC);
+      return;
+    }
+
+    // Replace the oldest measurement in the moving average
+    uint16_t *oldest = &history[channel - 1][historyPos];
+    value[channel] = value[channel] - *oldest + sum;
+    *oldest = sum;
+    count = 0;
+    sum = 0;
+  }
+
+  if (++channel == ADC_SAMPLER_CHANNELS)
+  {
+    channel = 0;
+    if (++historyPos == ADC_SAMPLER_AVERAGE)
+      historyPos = 0;
+    rounds++;
+  }
+  ADMUX = _BV(REFS0) | mux[channel];
+  discard = ADC_SAMPLER_DISCARD;
+  ADCSRA |= _BV(ADSC);
+}
@@ -0,0 +1,76 @@
+/*
+**
+** Interrupt driven ADC sampler for MezmerizeB1Buffer
+**
+** The ADC is kept busy in the background: every conversion complete interrupt
+** stores the result and starts a conversion of the next channel, so nothing has
+** to wait for the ADC. Two analog pins are sampled together with the internal
+** 1.1V bandgap, which is used to measure Vcc and detect power loss as soon as
+** it happens.
+** The analog pins are oversampled and averaged over the last few rounds to
+** give steady readings.
+**
+** Copyright (c) 2020 Carsten Grønning, Jan Abkjer Tofft
+**
+*/
+
+#ifndef AdcSampler_h_
+#define AdcSampler_h_
+
+#include <Arduino.h>
+
+#define ADC_SAMPLER_CHANNELS 3    // Vcc (bandgap) and two analog pins
+#define ADC_SAMPLER_BANDGAP_MUX 0x0E
+#define ADC_SAMPLER_BANDGAP_MV 1100L
+#define ADC_SAMPLER_DISCARD 1     // Conversions thrown away after the mux has been switched, to let the input settle
+#define ADC_SAMPLER_OVERSAMPLING 16 // Conversions summed for every measurement of an analog pin
+#define ADC_SAMPLER_AVERAGE 4     // Number of measurements in the moving average of an analog pin (OVERSAMPLING * AVERAGE * 1023 must fit in 16 bits)
+
+class AdcSampler
+{
+  public:
+    AdcSampler();
+
+    // Starts the background sampling of pin1, pin2 and Vcc. Returns when the moving averages have been filled.
+    void begin(uint8_t pin1, uint8_t pin2);
+    // Stops the sampling and turns off the ADC (i.e. before sleeping). The measurements are kept, so read() and readVcc() return the values from before stop().
+    void stop();
+    // Starts the sampling again after stop() - without waiting for new measurements.
+    void resume();
+
+    // Power is regarded as lost when Vcc is measured above minMv and below maxMv (the lower limit avoids false alarms when powered by USB only).
+    void setPowerLossWindow(uint16_t minMv, uint16_t maxMv);
+    // Returns true if power loss has been detected since begin() or the last call of clearPowerLoss().
+    bool powerLost();
+    void clearPowerLoss();
+
+    // Returns the latest measurement of Vcc in mV.
+    uint16_t readVcc();
+    // Returns the moving average of the measurements of pin in 1/ADC_SAMPLER_OVERSAMPLING of the 10 bit conversion result (0-16368) - pin must be one of the pins given to begin().
+    uint16_t read(uint8_t pin);
+
+    // Called by the ADC conversion complete interrupt.
+    void isr();
+
+  private:
+    uint8_t mux[ADC_SAMPLER_CHANNELS];
+    volatile uint16_t value[ADC_SAMPLER_CHANNELS]; // Vcc: latest conversion, pins: sum of the measurements in history
+    uint8_t channel;
+    uint8_t discard;
+    uint8_t count;  // Conversions summed in sum
+    uint16_t sum;
+    uint16_t history[ADC_SAMPLER_CHANNELS - 1][ADC_SAMPLER_AVERAGE];
+    uint8_t historyPos;
+    volatile uint8_t rounds;  // Incremented every time all channels have been measured
+
+    // The power loss window expressed as bandgap conversion results (a lower Vcc gives a higher result)
+    uint16_t powerLossMinRaw;
+    uint16_t powerLossMaxRaw;
+    volatile bool powerLossDetected;
+
+    uint16_t readChannel(uint8_t channel);
+};
+
+extern AdcSampler adcSampler;
+
+#endif
@@ -177,6 +177,7 @@ void ClickEncoder::service(void)
 int16_t ClickEncoder::getValue(void)
 {
   int16_t val;
+  uint8_t oldSREG = SREG; // may be called from an interrupt routine, so the interrupt state is restored instead of enabled
 
   cli();
   val = delta;
@@ -185,7 +186,7 @@ int16_t ClickEncoder::getValue(void)
   else if (steps == 4) delta = val & 3;
   else delta = 0; // default to 1 step per notch
 
-  sei();
+  SREG = oldSREG;
 
   if (steps == 4) val >>= 2;
   if (steps == 2) val >>= 1;
@@ -0,0 +1,290 @@
+#include "I2CBus.h"
+#include <util/atomic.h>
+#include <util/twi.h>
+
+I2CBus i2cBus;
+
+#define SLOT_FREE 0
+#define SLOT_FILLING 1
+#define SLOT_QUEUED 2
+#define SLOT_ACTIVE 3
+#define SLOT_DONE 4
+
+// Clears the interrupt flag, so the TWI does the next step of the transaction
+#define TWCR_NEXT (_BV(TWEN) | _BV(TWIE) | _BV(TWINT))
+
+ISR(TWI_vect)
+{
+  i2cBus.isr();
+}
+
+I2CBus::I2CBus()
+{
+  for (uint8_t i = 0; i < I2C_BUS_SLOTS; i++)
+    slots[i].state = SLOT_FREE;
+  filling = 0;
+  nextSequence = 0;
+  current = I2C_BUS_NONE;
+  error = I2C_OK;
+}
+
+// ---------------------------------------------------
+void I2CBus::begin(uint32_t clock)
+{
+  // Internal pull-ups on SDA (A4) and SCL (A5), like the Wire library
+  PORTC |= _BV(PC4) | _BV(PC5);
+  TWSR = 0; // Prescaler 1
+  TWBR = ((F_CPU / clock) - 16) / 2;
+  TWCR = _BV(TWEN) | _BV(TWIE);
+}
+
+// ---------------------------------------------------
+void I2CBus::beginTransmission(uint8_t address, uint8_t priority)
+{
+  uint8_t i;
+
+  // The interrupt frees the slots as the transactions are sent
+  while ((i = freeSlot(priority)) == I2C_BUS_NONE)
+    yield();
+
+  filling = &slots[i];
+  filling->state = SLOT_FILLING;
+  filling->address = address << 1; // TW_WRITE
+  filling->priority = priority;
+  filling->length = 0;
+}
+
+// ---------------------------------------------------
+size_t I2CBus::write(uint8_t data)
+{
+  if (filling == 0 || filling->length >= I2C_BUS_BUFFER)
+    return 0;
+  filling->data[filling->length++] = data;
+  return 1;
+}
+
+// ---------------------------------------------------
+size_t I2CBus::write(const uint8_t *data, size_t length)
+{
+  size_t n = 0;
+
+  while (n < length && write(data[n]))
+    n++;
+  return n;
+}
+
+// ---------------------------------------------------
+uint8_t I2CBus::endTransmission(bool wait)
+{
+  Transaction *t = filling;
+
+  if (t == 0)
+    return I2C_ERROR;
+  filling = 0;
+  t->wait = wait;
+  submit(t);
+  if (!wait)
+    return I2C_OK;
+
+  waitFor(t);
+  uint8_t status = t->status;
+  t->state = SLOT_FREE;
+  return status;
+}
+
+// ---------------------------------------------------
+uint8_t I2CBus::requestFrom(uint8_t address, uint8_t *data, uint8_t length, uint8_t priority)
+{
+  if (length > I2C_BUS_BUFFER)
+    length = I2C_BUS_BUFFER;
+  if (length == 0)
+    return 0;
+
+  beginTransmission(address, priority);
+  Transaction *t = filling;
+  filling = 0;
+  t->address |= TW_READ;
+  t->length = length;
+  t->wait = true;
+  submit(t);
+  waitFor(t);
+
+  length = (t->status == I2C_OK) ? t->length : 0;
+  memcpy(data, t->data, length);
+  t->state = SLOT_FREE;
+  return length;
+}
+
+// ---------------------------------------------------
+void I2CBus::flush()
+{
+  while (!idle())
+    yield();
+}
+
+// ---------------------------------------------------
+bool I2CBus::idle()
+{
+  return current == I2C_BUS_NONE;
+}
+
+// ---------------------------------------------------
+uint8_t I2CBus::lastError()
+{
+  uint8_t status = error;
+
+  error = I2C_OK;
+  return status;
+}
+
+// ---------------------------------------------------
+// Returns the index of a free slot or I2C_BUS_NONE. I2C_PRIORITY_LOW doesn't get the last free slot, so a burst of display writes can't make the relays wait for a slot
+uint8_t I2CBus::freeSlot(uint8_t priority)
+{
+  uint8_t found = I2C_BUS_NONE;
+  uint8_t count = 0;
+
+  for (uint8_t i = 0; i < I2C_BUS_SLOTS; i++)
+  {
+    if (slots[i].state == SLOT_FREE)
+    {
+      found = i;
+      count++;
+    }
+  }
+  if (priority >= I2C_PRIORITY_LOW && count < 2)
+    return I2C_BUS_NONE;
+  return found;
+}
+
+// ---------------------------------------------------
+void I2CBus::submit(Transaction *t)
+{
+  t->sequence = nextSequence++;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+  {
+    t->state = SLOT_QUEUED;
+    if (current == I2C_BUS_NONE)
+    {
+      // The STOP ending the previous transaction may still be on the wire
+      while (TWCR & _BV(TWSTO))
+        ;
+      startNext(false);
+    }
+  }
+}
+
+// ---------------------------------------------------
+void I2CBus::waitFor(Transaction *t)
+{
+  while (t->state != SLOT_DONE)
+    yield();
+}
+
+// ---------------------------------------------------
+// Ends the current transaction and goes on with the next
+void I2CBus::complete(uint8_t status)
+{
+  Transaction *t = &slots[current];
+
+  t->status = status;
+  t->length = position;
+  if (t->wait)
+    t->state = SLOT_DONE;
+  else
+  {
+    if (status != I2C_OK)
+      error = status;
+    t->state = SLOT_FREE;
+  }
+  startNext(true);
+}
+
+// ---------------------------------------------------
+// Starts the queued transaction of the highest priority - after a STOP if stop is true (a transaction has just ended). Without a queued transaction the bus is released
+void I2CBus::startNext(bool stop)
+{
+  uint8_t next = I2C_BUS_NONE;
+
+  for (uint8_t i = 0; i < I2C_BUS_SLOTS; i++)
+  {
+    if (slots[i].state != SLOT_QUEUED)
+      continue;
+    if (next == I2C_BUS_NONE || slots[i].priority < slots[next].priority ||
+        (slots[i].priority == slots[next].priority && (int8_t)(slots[i].sequence - slots[next].sequence) < 0))
+      next = i;
+  }
+
+  current = next;
+  if (next == I2C_BUS_NONE)
+  {
+    TWCR = TWCR_NEXT | _BV(TWSTO);
+    return;
+  }
+  slots[next].state = SLOT_ACTIVE;
+  // STOP followed by START - the EEPROM only starts its write cycle at a STOP, so a repeated START can't be used
+  TWCR = TWCR_NEXT | _BV(TWSTA) | (stop ? _BV(TWSTO) : 0);
+}
+
+// ---------------------------------------------------
+void I2CBus::isr()
+{
+  if (current == I2C_BUS_NONE)
+  {
+    // Nothing to do (i.e. a bus error while idle) - release the bus
+    TWCR = TWCR_NEXT | _BV(TWSTO);
+    return;
+  }
+
+  Transaction *t = &slots[current];
+
+  switch (TW_STATUS)
+  {
+  case TW_START:
+  case TW_REP_START:
+    position = 0;
+    TWDR = t->address;
+    TWCR = TWCR_NEXT;
+    break;
+
+  case TW_MT_SLA_ACK:
+  case TW_MT_DATA_ACK:
+    if (position < t->length)
+    {
+      TWDR = t->data[position++];
+      TWCR = TWCR_NEXT;
+    }
+    else
+      complete(I2C_OK);
+    break;
+
+  case TW_MR_DATA_ACK:
+    t->data[position++] = TWDR;
+    // Fall through
+  case TW_MR_SLA_ACK:
+    // Acknowledge the bytes until the last one, so the device stops sending
+    if (position + 1 < t->length)
+      TWCR = TWCR_NEXT | _BV(TWEA);
+    else
+      TWCR = TWCR_NEXT;
+    break;
+
+  case TW_MR_DATA_NACK:
+    t->data[position++] = TWDR;
+    complete(I2C_OK);
+    break;
+
+  case TW_MT_SLA_NACK:
+  case TW_MR_SLA_NACK:
+    complete(I2C_NACK_ADDRESS);
+    break;
+
+  case TW_MT_DATA_NACK:
+    complete(I2C_NACK_DATA);
+    break;
+
+  default: // Arbitration lost or bus error
+    complete(I2C_ERROR);
+    break;
+  }
+}
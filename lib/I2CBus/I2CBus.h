@@ -0,0 +1,95 @@
+/*
+**
+** Shared I2C bus for MezmerizeB1Buffer
+**
+** Owns the TWI of the MCU for the drivers of the display, the relay expanders
+** and the EEPROM (instead of the Wire library). The bus clock is set once by
+** begin(). Transactions are queued and clocked out by the TWI interrupt, so
+** the CPU keeps running while the bytes are on the wire - a caller only waits
+** when it needs the result (reads, or writes it needs the status of).
+** Queued transactions of a higher priority are sent before those of lower
+** priorities - transactions of the same priority keep their order.
+**
+** Copyright (c) 2020 Carsten Grønning, Jan Abkjer Tofft
+**
+*/
+
+#ifndef I2CBus_h_
+#define I2CBus_h_
+
+#include <Arduino.h>
+
+#define I2C_BUS_CLOCK 400000UL // All devices on the bus support 400 kHz
+#define I2C_BUS_SLOTS 4        // Transactions that can be queued at the same time - the last free slot is kept for the priorities above I2C_PRIORITY_LOW
+#define I2C_BUS_BUFFER 32      // Bytes of one transaction (not counting the address)
+#define I2C_BUS_NONE 0xFF
+
+// Priorities
+#define I2C_PRIORITY_HIGH 0   // Relays and triggers
+#define I2C_PRIORITY_NORMAL 1 // EEPROM
+#define I2C_PRIORITY_LOW 2    // Display
+
+// Status of a transaction - the same codes as returned by Wire.endTransmission()
+#define I2C_OK 0
+#define I2C_NACK_ADDRESS 2
+#define I2C_NACK_DATA 3
+#define I2C_ERROR 4
+
+class I2CBus
+{
+  public:
+    I2CBus();
+
+    // Enables the TWI (and the pull-ups of SDA and SCL) and sets the bus clock.
+    void begin(uint32_t clock = I2C_BUS_CLOCK);
+
+    // Starts a write transaction to the 7 bit address. Waits for a free slot if the queue is full.
+    void beginTransmission(uint8_t address, uint8_t priority = I2C_PRIORITY_NORMAL);
+    // Adds bytes to the transaction. Returns the number of bytes added - there is room for I2C_BUS_BUFFER bytes.
+    size_t write(uint8_t data);
+    size_t write(const uint8_t *data, size_t length);
+    // Queues the transaction. If wait is true, waits until it has been sent and returns its status, else returns I2C_OK right away (see lastError()).
+    uint8_t endTransmission(bool wait = false);
+
+    // Reads length bytes (at most I2C_BUS_BUFFER) from address into data - waits for the transaction. Returns the number of bytes read.
+    uint8_t requestFrom(uint8_t address, uint8_t *data, uint8_t length, uint8_t priority = I2C_PRIORITY_NORMAL);
+
+    // Waits until all queued transactions have been sent.
+    void flush();
+    // Returns true if no transaction is queued or being sent (i.e. the MCU may sleep).
+    bool idle();
+    // Returns the status of the latest transaction that failed without being waited for - and clears it.
+    uint8_t lastError();
+
+    // Called by the TWI interrupt.
+    void isr();
+
+  private:
+    struct Transaction
+    {
+      volatile uint8_t state;
+      bool wait;         // Kept for the caller when done, else freed by the interrupt
+      uint8_t address;   // Address and R/W bit as sent on the wire
+      uint8_t priority;
+      uint8_t sequence;  // Order of the transactions of the same priority
+      uint8_t length;    // Bytes to send or receive - bytes transferred when done
+      uint8_t status;
+      uint8_t data[I2C_BUS_BUFFER];
+    };
+    Transaction slots[I2C_BUS_SLOTS];
+    Transaction *filling;     // Transaction between beginTransmission() and endTransmission()
+    uint8_t nextSequence;
+    volatile uint8_t current; // Slot on the wire or I2C_BUS_NONE
+    uint8_t position;         // Next byte of the current transaction
+    volatile uint8_t error;
+
+    uint8_t freeSlot(uint8_t priority);
+    void submit(Transaction *t);
+    void waitFor(Transaction *t);
+    void complete(uint8_t status);
+    void startNext(bool stop);
+};
+
+extern I2CBus i2cBus;
+
+#endif
@@ -73,6 +73,7 @@ protected:
     static constexpr uint32_t timespanEvent = HashIR_TIMESPAN;
 
     friend CIRL_Receive<CHashIR>;
+    friend class IRReceiver; // Decodes several protocols on one pin
     friend CIRL_Protocol<CHashIR, HashIR_data_t>;
 
     // Interrupt function that is attached
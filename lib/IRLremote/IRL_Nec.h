@@ -124,6 +124,7 @@ protected:
     static constexpr uint8_t irLength = NEC_LENGTH;
 
     friend CIRL_Receive<CNec>;
+    friend class IRReceiver; // Decodes several protocols on one pin
     friend CIRL_Protocol<CNec, Nec_data_t>;
     friend CIRL_DecodeSpaces<CNec, NEC_BLOCKS>;
 
@@ -139,6 +139,7 @@ protected:
     static constexpr uint8_t irLength = PANASONIC_LENGTH;
 
     friend CIRL_Receive<CPanasonic>;
+    friend class IRReceiver; // Decodes several protocols on one pin
     friend CIRL_Protocol<CPanasonic, Panasonic_data_t>;
     friend CIRL_DecodeSpaces<CPanasonic, PANASONIC_BLOCKS>;
 
@@ -0,0 +1,104 @@
+#include "IRReceiver.h"
+
+volatile uint8_t *IRReceiver::pinRegister;
+uint8_t IRReceiver::pinMask;
+uint8_t IRReceiver::protocols;
+bool IRReceiver::repeat;
+uint32_t IRReceiver::necCommand;
+uint32_t IRReceiver::panasonicCommand;
+uint32_t IRReceiver::panasonicEvent;
+
+bool IRReceiver::begin(uint8_t pin, uint8_t protocols)
+{
+  IRReceiver::protocols = protocols;
+  pinRegister = portInputRegister(digitalPinToPort(pin));
+  pinMask = digitalPinToBitMask(pin);
+  pinMode(pin, INPUT_PULLUP);
+
+  if (digitalPinToInterrupt(pin) == NOT_AN_INTERRUPT)
+    return false;
+  // The hash needs every edge - the NEC and Panasonic decoders only the falling ones
+  attachInterrupt(digitalPinToInterrupt(pin), interrupt, CHANGE);
+  return true;
+}
+
+// ---------------------------------------------------
+bool IRReceiver::available()
+{
+  return ((protocols & IR_PROTOCOL_NEC) && CNec().available()) ||
+         ((protocols & IR_PROTOCOL_PANASONIC) && CPanasonic().available()) ||
+         ((protocols & IR_PROTOCOL_HASH) && CHashIR().available());
+}
+
+bool IRReceiver::receiving()
+{
+  return ((protocols & IR_PROTOCOL_NEC) && CNec().receiving()) ||
+         ((protocols & IR_PROTOCOL_PANASONIC) && CPanasonic().receiving()) ||
+         ((protocols & IR_PROTOCOL_HASH) && CHashIR().receiving());
+}
+
+HashIR_data_t IRReceiver::read()
+{
+  HashIR_data_t code = HashIR_data_t();
+
+  repeat = false;
+  if ((protocols & IR_PROTOCOL_NEC) && CNec().available())
+  {
+    Nec_data_t data = CNec().read();
+
+    // The decoder flags a repeat frame with address 0xFFFF and command 0
+    if (data.address == 0xFFFF && data.command == 0)
+      repeat = true;
+    else
+      necCommand = ((uint32_t)data.address << 8) | data.command;
+    code.address = IR_ADDRESS_NEC;
+    code.command = necCommand;
+  }
+  else if ((protocols & IR_PROTOCOL_PANASONIC) && CPanasonic().available())
+  {
+    uint32_t event = CPanasonic().lastEvent();
+    Panasonic_data_t data = CPanasonic().read();
+
+    // The last byte of the command is the checksum of the other three, so it is replaced by the 16 bit manufacturer code folded to 8 bits
+    code.address = IR_ADDRESS_PANASONIC;
+    code.command = (data.command & 0x00FFFFFF) | ((uint32_t)(lowByte(data.address) ^ highByte(data.address)) << 24);
+
+    // Panasonic has no repeat frame - the frame is resent while the key is held
+    repeat = code.command == panasonicCommand && event - panasonicEvent < PANASONIC_LIMIT_REPEAT;
+    panasonicCommand = code.command;
+    panasonicEvent = event;
+  }
+  else if (protocols & IR_PROTOCOL_HASH)
+  {
+    // The hash reads the same way as CHashIR alone (available() changes the pulse count), so learned codes stay valid
+    code = CHashIR().read();
+    if (code.address >= IR_ADDRESS_PANASONIC)
+      code.address = IR_ADDRESS_PANASONIC - 1;
+  }
+  return code;
+}
+
+bool IRReceiver::repeated()
+{
+  return repeat;
+}
+
+// ---------------------------------------------------
+void IRReceiver::interrupt()
+{
+  if (protocols & IR_PROTOCOL_HASH)
+    CHashIR::interrupt();
+
+  // The output of the receiver is low during a mark, so a high pin is a rising edge
+  if (*pinRegister & pinMask)
+    return;
+
+  if (protocols & IR_PROTOCOL_NEC)
+    CNec::interrupt();
+  if (protocols & IR_PROTOCOL_PANASONIC)
+    CPanasonic::interrupt();
+
+  // Throw away the hash of a frame that has been decoded - the hash starts again after the next timeout
+  if ((protocols & IR_PROTOCOL_HASH) && CHashIR::lastDuration != 0 && (CNec().available() || CPanasonic().available()))
+    CHashIR().resetReading();
+}
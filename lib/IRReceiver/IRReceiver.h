@@ -0,0 +1,64 @@
+/*
+**
+** IR receiver for MezmerizeB1Buffer
+**
+** Decodes NEC and Panasonic frames with the decoders of IRLremote as soon as
+** the last bit of a frame has been received, and falls back to the hash of
+** IRLremote for remotes of other protocols. All of them run on the same pin
+** change interrupt, and a frame decoded as NEC or Panasonic is not also
+** reported as a hash code.
+**
+** Codes are returned in the HashIR_data_t layout, so codes of all protocols can
+** be bound to keys the same way. The address of a NEC or Panasonic code is
+** IR_ADDRESS_NEC or IR_ADDRESS_PANASONIC - the address of a hash code is its
+** pulse count, which is kept below them.
+**
+** NEC repeat frames and Panasonic frames resent while a key is held are
+** reported as the code of the key with repeated() returning true.
+**
+** Copyright (c) 2020 Carsten Grønning, Jan Abkjer Tofft
+**
+*/
+
+#ifndef IRReceiver_h_
+#define IRReceiver_h_
+
+#include <Arduino.h>
+#include "IRLremote.h"
+
+// Protocols to decode - see begin()
+#define IR_PROTOCOL_NEC 0x01
+#define IR_PROTOCOL_PANASONIC 0x02
+#define IR_PROTOCOL_HASH 0x04
+
+#define IR_ADDRESS_NEC 0xFF
+#define IR_ADDRESS_PANASONIC 0xFE
+
+class IRReceiver
+{
+  public:
+    // Attaches the interrupt of pin (it must be an external interrupt pin). protocols is the IR_PROTOCOL_ values of the protocols to decode
+    static bool begin(uint8_t pin, uint8_t protocols);
+
+    // Returns true when a code is ready to be read
+    static bool available();
+    // Returns true while a frame is being received
+    static bool receiving();
+    // Returns the received code, or an empty code (address 0) if there is none. NEC is checked first, then Panasonic and then the hash
+    static HashIR_data_t read();
+    // Returns true if the code returned by the last read() is a repeat of a held key
+    static bool repeated();
+
+  private:
+    static void interrupt();
+
+    static volatile uint8_t *pinRegister;
+    static uint8_t pinMask;
+    static uint8_t protocols;
+    static bool repeat;
+    static uint32_t necCommand;       // A NEC repeat frame carries no code, so the code of the last frame is kept
+    static uint32_t panasonicCommand; // The last Panasonic code and when it was received
+    static uint32_t panasonicEvent;
+};
+
+#endif
@@ -35,6 +35,13 @@ char *MenuManager::getParentItemName(char *buf)
   return buf;
 }
 
+unsigned char MenuManager::getParentItemIndex()
+{
+  MenuStackItem *msi = peekMenuItemOnStack();
+
+  return (msi != 0) ? msi->itemIndexPos : 0;
+}
+
 // ---------------------------------------------------
 char *MenuManager::getItemName(char *buf, unsigned char idx)
 {
@@ -51,6 +51,8 @@ class MenuManager
 
     // Gets the menu item name of the parent. Caller needs to first check if currentMenuHasParent().
     char *getParentItemName(char *buf);
+    // Gets the item index of the parent in its menu (i.e. which of the items sharing a child menu was selected). Caller needs to first check if currentMenuHasParent().
+    unsigned char getParentItemIndex();
     
     // Gets the menu item name, given item index position
     char *getItemName(char *buf, unsigned char idx);
@@ -23,6 +23,7 @@
 
 #include "Muses72320.h"
 #include <SPI.h>
+#include "Profiler.h"
 
 typedef Muses72320 Self;
 
@@ -42,8 +43,20 @@ static const data_t s_state_bit_zero_crossing = 5;
 static const data_t s_state_bit_gain          = 6;
 static const data_t s_state_bit_attenuation   = 7;
 
+// marks a cached register as unknown, no valid data has this value.
+static const data_t s_data_unknown = 0xff;
+
+// lowest volume level, the level the chip is considered to be at when muted.
+static const volume_t s_volume_min = -223;
+
 static const int s_slave_select_pin = 10;
-static const SPISettings s_muses_spi_settings(250000, MSBFIRST, SPI_MODE2);
+// the datasheet allows a clock cycle time of 1 us (1 MHz).
+static const SPISettings s_muses_spi_settings(1000000, MSBFIRST, SPI_MODE2);
+
+// set while a caller holds the bus with beginTransaction(), the bus is only
+// taken by the first transfer so a command the caches drop costs nothing.
+static bool s_in_transaction = false;
+static bool s_bus_taken = false;
 
 static inline data_t volume_to_attenuation(volume_t volume)
 {
@@ -52,7 +65,7 @@ static inline data_t volume_to_attenuation(volume_t volume)
 	// |    0.0 dB | in: [  0] -> 0b00010000 |
 	// | -111.5 dB | in: [223] -> 0b11101111 |
 	// #=====================================#
-	return static_cast<data_t>(min(-volume, 223) + 0x10);
+	return static_cast<data_t>(constrain(-volume, 0, 223) + 0x10);
 }
 
 static inline data_t volume_to_gain(volume_t gain)
@@ -67,8 +80,18 @@ static inline data_t volume_to_gain(volume_t gain)
 
 Self::Muses72320(address_t chip_address) :
 		chip_address(chip_address & 0b0111),
-		states(0)
-{ }
+		states(0),
+		ramping(false),
+		ramp_mute(false)
+{
+	for (uint8_t ch = 0; ch < 2; ch++) {
+		attenuation[ch] = s_data_unknown;
+		gain[ch] = s_data_unknown;
+		level[ch] = s_volume_min;
+		offset[ch] = 0;
+		trim[ch] = 0;
+	}
+}
 
 void Self::begin()
 {
@@ -78,36 +101,86 @@ void Self::begin()
 
 void Self::setVolume(volume_t lch, volume_t rch)
 {
-	if (bitRead(states, s_state_bit_attenuation)) {
-		// interconnected left and right channels.
-		transfer(s_control_attenuation_l, volume_to_attenuation(lch));
-	} else {
-		// independent left and right channels.
-		transfer(s_control_attenuation_l, volume_to_attenuation(lch));
-		transfer(s_control_attenuation_r, volume_to_attenuation(rch));
-	}
+	ramping = false;
+	writeVolume(lch, rch);
 }
 
 void Self::setGain(volume_t lch, volume_t rch)
 {
 	if (bitRead(states, s_state_bit_gain)) {
 		// interconnected left and right channels.
-		transfer(s_control_gain_l, volume_to_gain(lch));
+		writeCached(s_control_gain_l, volume_to_gain(lch), gain[0]);
+		gain[1] = gain[0];
 	} else {
 		// independent left and right channels.
-		transfer(s_control_gain_l, volume_to_gain(lch));
-		transfer(s_control_gain_r, volume_to_gain(rch));
+		writeCached(s_control_gain_l, volume_to_gain(lch), gain[0]);
+		writeCached(s_control_gain_r, volume_to_gain(rch), gain[1]);
 	}
 }
 
+void Self::setOffset(volume_t lch, volume_t rch)
+{
+	offset[0] = lch;
+	offset[1] = rch;
+	// only a channel whose offset changed is written again, a muted chip or a
+	// ramp in progress picks up the offsets on its next write.
+	if (attenuation[0] != 0 && attenuation[0] != s_data_unknown && !ramping)
+		writeVolume(level[0], level[1]);
+}
+
+void Self::setTrim(volume_t lch, volume_t rch)
+{
+	trim[0] = lch;
+	trim[1] = rch;
+	if (attenuation[0] != 0 && attenuation[0] != s_data_unknown && !ramping)
+		writeVolume(level[0], level[1]);
+}
+
 void Self::mute()
 {
-  if (bitRead(states, s_state_bit_attenuation)) {
-    transfer(s_control_attenuation_l, 0);
-  } else {
-    transfer(s_control_attenuation_l, 0);
-    transfer(s_control_attenuation_r, 0);
-  }
+	ramping = false;
+	level[0] = level[1] = s_volume_min;
+	if (bitRead(states, s_state_bit_attenuation)) {
+		writeCached(s_control_attenuation_l, 0, attenuation[0]);
+		attenuation[1] = attenuation[0];
+	} else {
+		writeCached(s_control_attenuation_l, 0, attenuation[0]);
+		writeCached(s_control_attenuation_r, 0, attenuation[1]);
+	}
+}
+
+void Self::rampTo(volume_t volume, uint16_t duration, bool muteWhenDone)
+{
+	ramp_from[0] = level[0];
+	ramp_from[1] = level[1];
+	ramp_to = volume;
+	ramp_start = millis();
+	ramp_duration = duration;
+	ramp_mute = muteWhenDone;
+	ramping = true;
+	service();
+}
+
+void Self::service()
+{
+	if (!ramping)
+		return;
+
+	unsigned long elapsed = millis() - ramp_start;
+	if (elapsed >= ramp_duration) {
+		if (ramp_mute)
+			mute();
+		else
+			setVolume(ramp_to);
+		return;
+	}
+
+	// intermediate levels are written as they are reached, the cache drops
+	// the calls that fall on the same 0.5 dB step as the previous one.
+	volume_t v[2];
+	for (uint8_t ch = 0; ch < 2; ch++)
+		v[ch] = ramp_from[ch] + (int32_t)(ramp_to - ramp_from[ch]) * (int32_t)elapsed / ramp_duration;
+	writeVolume(v[0], v[1]);
 }
 
 void Self::setZeroCrossing(bool enabled)
@@ -122,6 +195,8 @@ void Self::setAttenuationLink(bool enabled)
 	// 1 is enabled, 0 is disabled.
 	bitWrite(states, s_state_bit_attenuation, enabled);
 	transfer(s_control_states, states);
+	// the right channel register no longer follows what was written to it.
+	attenuation[1] = s_data_unknown;
 }
 
 void Self::setGainLink(bool enabled)
@@ -129,14 +204,58 @@ void Self::setGainLink(bool enabled)
 	// 1 is enabled, 0 is disabled.
 	bitWrite(states, s_state_bit_gain, enabled);
 	transfer(s_control_states, states);
+	gain[1] = s_data_unknown;
+}
+
+void Self::beginTransaction()
+{
+	s_in_transaction = true;
+}
+
+void Self::endTransaction()
+{
+	s_in_transaction = false;
+	if (s_bus_taken) {
+		s_bus_taken = false;
+		SPI.endTransaction();
+	}
+}
+
+void Self::writeVolume(volume_t lch, volume_t rch)
+{
+	level[0] = lch;
+	level[1] = rch;
+	if (bitRead(states, s_state_bit_attenuation)) {
+		// interconnected left and right channels.
+		writeCached(s_control_attenuation_l, volume_to_attenuation(lch + offset[0] + trim[0]), attenuation[0]);
+		attenuation[1] = attenuation[0];
+	} else {
+		// independent left and right channels.
+		writeCached(s_control_attenuation_l, volume_to_attenuation(lch + offset[0] + trim[0]), attenuation[0]);
+		writeCached(s_control_attenuation_r, volume_to_attenuation(rch + offset[1] + trim[1]), attenuation[1]);
+	}
+}
+
+void Self::writeCached(address_t address, data_t data, data_t &cache)
+{
+	if (cache == data)
+		return;
+	cache = data;
+	transfer(address, data);
 }
 
 void Self::transfer(address_t address, data_t data)
 {
-  SPI.beginTransaction(s_muses_spi_settings);
+  if (!s_bus_taken)
+    SPI.beginTransaction(s_muses_spi_settings);
+  s_bus_taken = s_in_transaction;
+  // every chip on the bus shifts the frame in, the one whose address matches
+  // latches it on the rising edge of the select line.
   digitalWrite(s_slave_select_pin, LOW);
   SPI.transfer(data);
   SPI.transfer(address | chip_address);
   digitalWrite(s_slave_select_pin, HIGH);
-  SPI.endTransaction();
+  if (!s_bus_taken)
+    SPI.endTransaction();
+  PROFILE_SPI(2);
 }
@@ -52,15 +52,40 @@ public:
 	void setGain(volume_t left, volume_t right);
 	inline void setGain(volume_t volume) { setGain(volume, volume); }
 
+	// attenuation added to each channel on top of the volume, in the same
+	// 0.5 dB units as the volume (0 or negative). used for balance.
+	void setOffset(volume_t left, volume_t right);
+
+	// fixed attenuation of this chip on top of the offset, same units. levels
+	// the chips of a group against each other.
+	void setTrim(volume_t left, volume_t right);
+
   void mute();
 
+	// move both channels from their current level to volume over duration ms.
+	// the ramp is non-blocking, service() writes the intermediate steps.
+	// if muteWhenDone is set the chip is muted when the ramp is completed.
+	// setVolume() and mute() cancel a ramp in progress.
+	void rampTo(volume_t volume, uint16_t duration, bool muteWhenDone = false);
+	inline bool isRamping() { return ramping; }
+
+	// advance a ramp in progress, call it from the main loop.
+	void service();
+
 	// enable or disable zero crossing.
 	// enabling zero crossing only works if the zero crossing terminal is set low.
 	void setZeroCrossing(bool enabled);
 	void setAttenuationLink(bool enabled);
 	void setGainLink(bool enabled);
 
+	// hold the spi bus between the two calls, the transfers of every chip in
+	// between go out back to back without setting up the bus again.
+	static void beginTransaction();
+	static void endTransaction();
+
 private:
+  void writeVolume(volume_t lch, volume_t rch);
+  void writeCached(address_t address, data_t data, data_t &cache);
   void transfer(address_t address, data_t data);
 
 private:
@@ -73,6 +98,22 @@ private:
 	//   5:     disable zero crossing
 	//   [4-0]: not used
 	data_t states;
+
+	// last data written to the attenuation and gain registers, the chip is
+	// write only so these let us skip transfers that would change nothing.
+	data_t attenuation[2];
+	data_t gain[2];
+
+	volume_t level[2];
+	volume_t offset[2];
+	volume_t trim[2];
+
+	volume_t ramp_from[2];
+	volume_t ramp_to;
+	unsigned long ramp_start;
+	uint16_t ramp_duration;
+	bool ramping;
+	bool ramp_mute;
 };
 
 #endif // INCLUDED_MUSES_72320
@@ -0,0 +1,80 @@
+/*
+**
+** Muses72320 group for MezmerizeB1Buffer
+**
+** Copyright (c) 2020 Carsten Grønning, Jan Abkjer Tofft
+**
+*/
+
+#include "Muses72320Group.h"
+
+Muses72320Group::Muses72320Group(Muses72320 *chips, uint8_t count) : chips(chips), chipCount(count)
+{
+}
+
+void Muses72320Group::begin()
+{
+  chips[0].begin();
+}
+
+// ---------------------------------------------------
+void Muses72320Group::setVolume(volume_t volume)
+{
+  Muses72320::beginTransaction();
+  for (uint8_t i = 0; i < chipCount; i++)
+    chips[i].setVolume(volume);
+  Muses72320::endTransaction();
+}
+
+void Muses72320Group::setOffset(volume_t left, volume_t right)
+{
+  Muses72320::beginTransaction();
+  for (uint8_t i = 0; i < chipCount; i++)
+    chips[i].setOffset(left, right);
+  Muses72320::endTransaction();
+}
+
+void Muses72320Group::mute()
+{
+  Muses72320::beginTransaction();
+  for (uint8_t i = 0; i < chipCount; i++)
+    chips[i].mute();
+  Muses72320::endTransaction();
+}
+
+// ---------------------------------------------------
+void Muses72320Group::rampTo(volume_t volume, uint16_t duration, bool muteWhenDone)
+{
+  Muses72320::beginTransaction();
+  for (uint8_t i = 0; i < chipCount; i++)
+    chips[i].rampTo(volume, duration, muteWhenDone);
+  Muses72320::endTransaction();
+}
+
+void Muses72320Group::service()
+{
+  // Called from the main loop, so the bus is only taken when there is a ramp to advance
+  if (!isRamping())
+    return;
+  Muses72320::beginTransaction();
+  for (uint8_t i = 0; i < chipCount; i++)
+    chips[i].service();
+  Muses72320::endTransaction();
+}
+
+bool Muses72320Group::isRamping()
+{
+  for (uint8_t i = 0; i < chipCount; i++)
+    if (chips[i].isRamping())
+      return true;
+  return false;
+}
+
+// ---------------------------------------------------
+void Muses72320Group::setZeroCrossing(bool enabled)
+{
+  Muses72320::beginTransaction();
+  for (uint8_t i = 0; i < chipCount; i++)
+    chips[i].setZeroCrossing(enabled);
+  Muses72320::endTransaction();
+}
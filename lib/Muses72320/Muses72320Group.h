@@ -0,0 +1,52 @@
+/*
+**
+** Muses72320 group for MezmerizeB1Buffer
+**
+** Drives the Muses72320 chips of a multi-channel build as one volume control.
+** The chips share the SPI bus and the select line and are told apart by their
+** address (the ADR pins). Every command is fanned out to all chips while the
+** bus is held, so the frames go out back to back and with zero crossing
+** enabled all chips pick up the new level within the same zero crossing
+** window. The trim of each chip (Muses72320::setTrim) levels the channels of
+** the chips against each other.
+**
+** The chips are owned by the caller, the group only keeps a pointer to them.
+**
+** Copyright (c) 2020 Carsten Grønning, Jan Abkjer Tofft
+**
+*/
+
+#ifndef Muses72320Group_h_
+#define Muses72320Group_h_
+
+#include <Arduino.h>
+#include "Muses72320.h"
+
+class Muses72320Group
+{
+  public:
+    typedef Muses72320::volume_t volume_t;
+
+    Muses72320Group(Muses72320 *chips, uint8_t count);
+
+    // Same as the Muses72320 methods of the same name, applied to every chip of the group
+    void begin();
+    void setVolume(volume_t volume);
+    void setOffset(volume_t left, volume_t right);
+    void mute();
+    void rampTo(volume_t volume, uint16_t duration, bool muteWhenDone = false);
+    void service();
+    void setZeroCrossing(bool enabled);
+
+    // True while any chip of the group is ramping
+    bool isRamping();
+
+    uint8_t count() { return chipCount; }
+    Muses72320 &chip(uint8_t index) { return chips[index]; }
+
+  private:
+    Muses72320 *chips;
+    uint8_t chipCount;
+};
+
+#endif
@@ -10,31 +10,128 @@ Adapted and expanded by Jan Tofft, jan@tofft.dk, 2017
 Inheritance of Print functions added, jan@tofft.dk, 2020
 Possibility to flip the display added (search for "Set Entry Mode (invert)" in OLedI2C.cpp), jan@tofft.dk, 2020
 BlinkingCursorOn/Off added, jan@tofft.dk, 2020
+Frame buffer added - output is kept in RAM and only changed cells are sent to the display by flush()
+Data is sent in bursts of up to I2C_BUS_BUFFER bytes per I2C transmission and the flat 10 ms delay after each command is replaced by the execution time of the command
+Glyph cache added - the custom characters of the large digits are uploaded to CGRAM when a number needs them, instead of the full character set every time the digit style changes
+Power up split into steps - beginPowerUp()/continuePowerUp() let the caller do other work during the power stabilization delays. Output is kept in the frame buffer until the display is up
+Sent through the shared I2CBus - the transactions are queued with the lowest priority and sent by the TWI interrupt
 */
 
 #include "OLedI2C.h"
-#include "Wire.h"
+#include "Profiler.h"
 #define OLED_Address 0x3c
 #define OLED_Command_Mode 0x80
-#define OLED_Data_Mode 0x40
-
-OLedI2C::OLedI2C() {}
+#define OLED_Data_Mode 0x40 // Co = 0: all bytes following the control byte in the transmission are data
+
+// Execution time of Clear Display and Return Home - the rest of the commands are done before the address and control byte of the next transmission are on the wire
+#define OLED_Clear_Delay_us 2000
+
+// Power stabilization delays of the power up sequence
+#define OLED_Vdd_Delay_ms 100
+#define OLED_Vcc_Delay_ms 100
+
+// Unchanged cells between two changed ones are resent as part of the same run if there are no more than this number of them - it is cheaper than setting the DDRAM address again
+#define OLED_Max_Run_Gap 2
+
+// The custom characters used by the large digits - glyph 0-7 is the 3x3 set, the 4x4 set shares glyph 2 and 7 with it and adds glyph 8-13
+// CGRAM only has room for 8 of them, so glyphSlot() uploads the glyphs as the numbers printed need them
+#define OLED_Glyph_Count 14
+#define OLED_Glyph_None 0xFF
+static const uint8_t glyphBitmaps[OLED_Glyph_Count][8] PROGMEM = {
+    {B11111, B11111, B01111, B00111, B00011, B00000, B00000, B00000},
+    {B00000, B10000, B11000, B11100, B11110, B11111, B11111, B11111},
+    {B11111, B11111, B11111, B11111, B11111, B00000, B00000, B00000},
+    {B11111, B11111, B11111, B11111, B11111, B11110, B11100, B11000},
+    {B11111, B11111, B11111, B11111, B11111, B01111, B00111, B00011},
+    {B00011, B00111, B01111, B11111, B11111, B11111, B11111, B11111},
+    {B11000, B11100, B11110, B11111, B11111, B11111, B11111, B11111},
+    {B00000, B00000, B00000, B11111, B11111, B11111, B11111, B11111},
+    {B00000, B00000, B00000, B00001, B00011, B00111, B01111, B11111},
+    {B10000, B11000, B11100, B11110, B11111, B11111, B11111, B11111},
+    {B11111, B11111, B11111, B11111, B01111, B00111, B00011, B00001},
+    {B00001, B00011, B00111, B01111, B11111, B11111, B11111, B11111},
+    {B00000, B00000, B00000, B10000, B11000, B11100, B11110, B11111},
+    {B11111, B11111, B11111, B11111, B11110, B11100, B11000, B10000},
+};
+
+// The glyph of each of the codes 0-7 used by the digit tables of print3x3Number() and print4x4Number()
+static const uint8_t glyphs3x3[8] PROGMEM = {0, 1, 2, 3, 4, 5, 6, 7};
+static const uint8_t glyphs4x4[8] PROGMEM = {8, 9, 2, 7, 10, 11, 12, 13};
+
+OLedI2C::OLedI2C()
+{
+  memset(frameBuffer, ' ', sizeof(frameBuffer));
+  memset(dirtyCells, 0, sizeof(dirtyCells));
+  memset(cgramGlyph, OLED_Glyph_None, sizeof(cgramGlyph));
+  clearGlyphUses();
+}
 OLedI2C::~OLedI2C() {}
 
 void OLedI2C::begin()
 {
+  // The contents of CGRAM is unknown after power up
+  memset(cgramGlyph, OLED_Glyph_None, sizeof(cgramGlyph));
   PowerUp();
 }
 
+// Only moves the cursor in the frame buffer - the display is addressed when flush() is called
 void OLedI2C::setCursor(uint8_t col, uint8_t row)
 {
-  int row_offsets[] = {0x00, 0x20, 0x40, 0x60};
+  cursorCol = col;
+  cursorRow = row;
+}
+
+void OLedI2C::setDDRAMAddress(uint8_t col, uint8_t row)
+{
+  static const uint8_t row_offsets[] = {0x00, 0x20, 0x40, 0x60};
   sendCommand(0x80 | (col + row_offsets[row]));
 }
 
 void OLedI2C::clear()
 {
-  sendCommand(0x01);
+  sendCommand(0x01, true);
+  // The display is blank now, so is the frame buffer and nothing is waiting to be sent
+  memset(frameBuffer, ' ', sizeof(frameBuffer));
+  memset(dirtyCells, 0, sizeof(dirtyCells));
+  clearGlyphUses();
+  cursorCol = 0;
+  cursorRow = 0;
+}
+
+// Send the changed cells to the display. Changed cells in a row are merged into runs so each run only costs one DDRAM address command
+void OLedI2C::flush()
+{
+  if (!ready())
+    return;
+  for (uint8_t row = 0; row < LCD_ROWS; row++)
+  {
+    uint32_t dirty = dirtyCells[row];
+    uint8_t col = 0;
+    while (dirty != 0 && col < LCD_COLS)
+    {
+      if (!(dirty & (1UL << col)))
+      {
+        col++;
+        continue;
+      }
+
+      // Find the last changed cell of the run
+      uint8_t first = col;
+      uint8_t last = col;
+      for (col++; col < LCD_COLS && col - last <= OLED_Max_Run_Gap; col++)
+      {
+        if (dirty & (1UL << col))
+          last = col;
+      }
+
+      setDDRAMAddress(first, row);
+      sendData(&frameBuffer[row][first], last - first + 1);
+      col = last + 1;
+    }
+    dirtyCells[row] = 0;
+  }
+  // The display shows what the frame buffer holds now
+  memset(glyphUsesShown, 0, sizeof(glyphUsesShown));
 }
 
 void OLedI2C::lcdOff()
@@ -49,6 +146,9 @@ void OLedI2C::lcdOn()
 
 void OLedI2C::BlinkingCursorOn()
 {
+  // The cursor is shown at the current DDRAM address, so bring the display up to date and move the address to the cursor of the frame buffer
+  flush();
+  setDDRAMAddress(cursorCol, cursorRow);
   sendCommand(0x0D);
 }
 
@@ -63,78 +163,168 @@ void OLedI2C::createChar(uint8_t location, uint8_t charmap[])
   location &= 0x7; // we only have 8 locations 0-7
 
   sendCommand(0x40 | (location << 3));
-  delayMicroseconds(30);
+  sendData(charmap, 8);
+  cgramGlyph[location] = OLED_Glyph_None; // Not one of the glyphs known by glyphSlot()
+}
+
+// Return the CGRAM location holding glyph - the glyph is uploaded if it is not there already. OLED_Glyph_None is returned if there is no room for it
+// A location holding a glyph used by the number being printed (glyphsPinned) is never replaced. Neither is one shown elsewhere on the screen (i.e. by another
+// number) or still shown by a cell waiting for the next flush(), as the cells showing it would change shape at once - unless all of them are shown. The others are replaced round robin
+uint8_t OLedI2C::glyphSlot(uint8_t glyph)
+{
+  uint8_t slot;
+
+  for (slot = 0; slot < 8; slot++)
+  {
+    if (cgramGlyph[slot] == glyph)
+    {
+      glyphsPinned |= 1 << slot;
+      return slot;
+    }
+  }
 
-  for (int i = 0; i < 8; i++)
+  if (glyphsPinned == 0xFF)
+    return OLED_Glyph_None;
+  uint8_t inUse = glyphsPinned | glyphsShown();
+  if (inUse == 0xFF)
+    inUse = glyphsPinned;
+  for (uint8_t i = 0; i < 8; i++)
   {
-    sendData(charmap[i]); // call the virtual write method
-    delayMicroseconds(40);
+    slot = (glyphVictim + i) & 0x7;
+    if (!(inUse & (1 << slot)))
+      break;
   }
+  glyphVictim = (slot + 1) & 0x7;
+
+  uint8_t bitmap[8];
+  memcpy_P(bitmap, glyphBitmaps[glyph], sizeof(bitmap));
+  sendCommand(0x40 | (slot << 3));
+  sendData(bitmap, 8);
+  cgramGlyph[slot] = glyph;
+  glyphsPinned |= 1 << slot;
+  return slot;
+}
+
+// Return one bit per CGRAM location - set if a cell of the frame buffer holds it or the display still shows it in a cell waiting for the next flush()
+uint8_t OLedI2C::glyphsShown()
+{
+  uint8_t shown = 0;
+
+  for (uint8_t slot = 0; slot < 8; slot++)
+  {
+    if (glyphUses[slot] != 0 || glyphUsesShown[slot] != 0)
+      shown |= 1 << slot;
+  }
+  return shown;
+}
+
+// The frame buffer and the display hold no CGRAM locations
+void OLedI2C::clearGlyphUses()
+{
+  memset(glyphUses, 0, sizeof(glyphUses));
+  memset(glyphUsesShown, 0, sizeof(glyphUsesShown));
+}
+
+// Write a cell of a large digit - codes 0-7 are looked up in glyphs (the glyphs of the digit style), the others are characters of the character ROM
+// A cell is left blank if there is no room in CGRAM for its glyph
+void OLedI2C::writeGlyph(uint8_t code, const uint8_t *glyphs)
+{
+  if (code < 8)
+  {
+    uint8_t slot = glyphSlot(pgm_read_byte(&glyphs[code]));
+    write(slot == OLED_Glyph_None ? ' ' : slot);
+  }
+  else
+    write(code);
 }
 
 void OLedI2C::PowerUp()
 {
-  // PowerUp function by Rafael Camacho Jan/2014 Brazil
+  for (uint8_t wait = beginPowerUp(); wait != 0; wait = continuePowerUp())
+    delay(wait);
+}
 
+uint8_t OLedI2C::beginPowerUp()
+{
   // Vdd/Vcc off State
   // Power up Vdd
 
   // Power Stabilized (100ms Delay Minimum)
-  delay(100);
+  powerUpStep = 1;
+  powerUpDue = millis() + OLED_Vdd_Delay_ms;
+  return OLED_Vdd_Delay_ms;
+}
 
-  // Initialized State (Parameters as Default)
+uint8_t OLedI2C::continuePowerUp()
+{
+  // PowerUp function by Rafael Camacho Jan/2014 Brazil
+  uint8_t step = powerUpStep;
+  long wait = (long)(powerUpDue - millis());
 
-  // Enable Internal Regulator
-  sendCommand(0x2A); // Set "RE" = 1
-  sendCommand(0x08);
-  sendCommand(0x71); // Function Selection A
-  sendData(0x5C);    // 0x00 - Disable        0x5C - Enable       Internal Vdd regulator at 5V I/O application mode
+  if (step == 0)
+    return 0;
+  if (wait > 0)
+    return wait;
+  powerUpStep = 0; // The commands of the power up must reach the display
 
-  // Set Display OFF
-  sendCommand(0x08);
+  if (step == 1)
+  {
+    // Initialized State (Parameters as Default)
 
-  // Initial Settings Configuration
+    // Enable Internal Regulator
+    sendCommand(0x2A); // Set "RE" = 1
+    sendCommand(0x08);
+    sendCommand(0x71); // Function Selection A
+    sendData(0x5C);    // 0x00 - Disable        0x5C - Enable       Internal Vdd regulator at 5V I/O application mode
 
-  // Set Display Clock Divide Ratio Oscilator Frequency
-  sendCommand(0x2A); // Set "RE" = 1
-  sendCommand(0x79); // Set "SD" = 1
-  sendCommand(0xD5);
-  sendCommand(0x70);
-  sendCommand(0x78);
+    // Set Display OFF
+    sendCommand(0x08);
 
-  // Set Display Mode
-  sendCommand(0x09); // Extended Function Set = Set 5-dot width -> 3 or 4 line(0x09), 1 or 2 line(0x08)
+    // Initial Settings Configuration
 
-  // Flip display with these two lines, comment out the 0x06 write below
-  //sendCommand(0x2A);
-  //sendCommand(0x05);   // Set Entry Mode (invert)
-  sendCommand(0x06); // Set Entry Mode (normal)
+    // Set Display Clock Divide Ratio Oscilator Frequency
+    sendCommand(0x2A); // Set "RE" = 1
+    sendCommand(0x79); // Set "SD" = 1
+    sendCommand(0xD5);
+    sendCommand(0x70);
+    sendCommand(0x78);
 
-  // CGROM/CGRAM Management
-  sendCommand(0x72); // Function Selection B
-  sendData(0x01);
+    // Set Display Mode
+    sendCommand(0x09); // Extended Function Set = Set 5-dot width -> 3 or 4 line(0x09), 1 or 2 line(0x08)
 
-  // Set OLED Characterization
-  sendCommand(0x79); // Set "SD" = 1
+    // Flip display with these two lines, comment out the 0x06 write below
+    //sendCommand(0x2A);
+    //sendCommand(0x05);   // Set Entry Mode (invert)
+    sendCommand(0x06); // Set Entry Mode (normal)
 
-  // Set PEG Pins Hardware Configuration
-  sendCommand(0xDA);
-  sendCommand(0x10);
+    // CGROM/CGRAM Management
+    sendCommand(0x72); // Function Selection B
+    sendData(0x01);
 
-  // Set Segment Low Voltage and GPIO
-  sendCommand(0xDC); // Function Selection C
-  sendCommand(0x03);
+    // Set OLED Characterization
+    sendCommand(0x79); // Set "SD" = 1
 
-  // Set Fade Out and Fade In / Out
-  sendCommand(0x23);
-  sendCommand(0x00);
+    // Set PEG Pins Hardware Configuration
+    sendCommand(0xDA);
+    sendCommand(0x10);
 
-  // Vcc Power Stabilized (100ms Delay Recommended)
-  delay(100);
+    // Set Segment Low Voltage and GPIO
+    sendCommand(0xDC); // Function Selection C
+    sendCommand(0x03);
+
+    // Set Fade Out and Fade In / Out
+    sendCommand(0x23);
+    sendCommand(0x00);
+
+    // Vcc Power Stabilized (100ms Delay Recommended)
+    powerUpStep = 2;
+    powerUpDue = millis() + OLED_Vcc_Delay_ms;
+    return OLED_Vcc_Delay_ms;
+  }
 
   // Set Contrast Control
   sendCommand(0x81);
-  sendCommand(0xFF);
+  sendCommand(contrast);
 
   // Set Pre-Charge Period
   sendCommand(0xD9);
@@ -152,13 +342,29 @@ void OLedI2C::PowerUp()
   sendCommand(0x08);
 
   // Clear Display
-  sendCommand(0x01);
+  sendCommand(0x01, true);
 
   // Set DDRAM Address
   sendCommand(0x80);
 
   // Set Display ON
   sendCommand(0x0C);
+
+  // Upload the glyphs of what has been printed meanwhile and draw all of the frame buffer on the cleared display with the next flush()
+  for (uint8_t slot = 0; slot < 8; slot++)
+  {
+    if (cgramGlyph[slot] < OLED_Glyph_Count)
+    {
+      uint8_t bitmap[8];
+      memcpy_P(bitmap, glyphBitmaps[cgramGlyph[slot]], sizeof(bitmap));
+      sendCommand(0x40 | (slot << 3));
+      sendData(bitmap, 8);
+    }
+  }
+  for (uint8_t row = 0; row < LCD_ROWS; row++)
+    dirtyCells[row] = (1UL << LCD_COLS) - 1;
+  memset(glyphUsesShown, 0, sizeof(glyphUsesShown));
+  return 0;
 }
 
 void OLedI2C::PowerDown()
@@ -183,17 +389,25 @@ void OLedI2C::PowerDown()
   // Vdd/Vcc off State
 }
 
-void OLedI2C::sendCommand(uint8_t command)
+// The slow flag is given by the caller - the same byte values are also sent as arguments of other commands (i.e. a contrast value), which execute at once
+void OLedI2C::sendCommand(uint8_t command, bool slow)
 {
-  Wire.beginTransmission(OLED_Address); // **** Start I2C
-  Wire.write(OLED_Command_Mode);        // **** Set OLED Command mode
-  Wire.write(command);
-  Wire.endTransmission(); // **** End I2C
-  delay(10);
+  if (!ready())
+    return;
+
+  i2cBus.beginTransmission(OLED_Address, I2C_PRIORITY_LOW); // **** Start I2C
+  i2cBus.write(OLED_Command_Mode);                           // **** Set OLED Command mode
+  i2cBus.write(command);
+  i2cBus.endTransmission(slow); // **** End I2C - only the slow commands wait for the transmission, to time their execution
+  PROFILE_I2C(OLED_Address, 2);
+  if (slow)
+    delayMicroseconds(OLED_Clear_Delay_us);
 }
 
 void OLedI2C::backlight(uint8_t contrast) // contrast as 0x00 to 0xFF
 {
+  this->contrast = contrast;
+
   //Set OLED Command set
   sendCommand(0x2A);
   sendCommand(0x79);
@@ -205,18 +419,62 @@ void OLedI2C::backlight(uint8_t contrast) // contrast as 0x00 to 0xFF
 }
 
 /* The write function is needed for derivation from the Print class. */
+/* Characters are written to the frame buffer and marked for the next flush() if they differ from what is already there */
 inline size_t OLedI2C::write(uint8_t ch)
 {
-  sendData(ch);
+  if (cursorRow < LCD_ROWS && cursorCol < LCD_COLS && frameBuffer[cursorRow][cursorCol] != ch)
+  {
+    uint8_t old = frameBuffer[cursorRow][cursorCol];
+    // Keep count of the cells using each CGRAM location - the display keeps showing the old character of a cell until it is flushed
+    if (old < 8)
+    {
+      glyphUses[old]--;
+      if (!(dirtyCells[cursorRow] & (1UL << cursorCol)))
+        glyphUsesShown[old]++;
+    }
+    if (ch < 8)
+      glyphUses[ch]++;
+    frameBuffer[cursorRow][cursorCol] = ch;
+    dirtyCells[cursorRow] |= 1UL << cursorCol;
+  }
+  cursorCol++;
   return 1; // assume sucess
 } // write()
 
+size_t OLedI2C::write(const uint8_t *buffer, size_t size)
+{
+  for (size_t i = 0; i < size; i++)
+    OLedI2C::write(buffer[i]);
+  return size;
+}
+
 void OLedI2C::sendData(uint8_t data)
 {
-  Wire.beginTransmission(OLED_Address); // **** Start I2C
-  Wire.write(OLED_Data_Mode);           // **** Set OLED Data mode
-  Wire.write(data);
-  Wire.endTransmission(); // **** End I2C
+  if (!ready())
+    return;
+  i2cBus.beginTransmission(OLED_Address, I2C_PRIORITY_LOW); // **** Start I2C
+  i2cBus.write(OLED_Data_Mode);                              // **** Set OLED Data mode
+  i2cBus.write(data);
+  i2cBus.endTransmission(); // **** End I2C
+  PROFILE_I2C(OLED_Address, 2);
+}
+
+void OLedI2C::sendData(const uint8_t *data, size_t length)
+{
+  if (!ready())
+    return;
+  while (length > 0)
+  {
+    // A transaction holds I2C_BUS_BUFFER bytes including the control byte
+    size_t count = length < I2C_BUS_BUFFER - 1 ? length : I2C_BUS_BUFFER - 1;
+    i2cBus.beginTransmission(OLED_Address, I2C_PRIORITY_LOW); // **** Start I2C
+    i2cBus.write(OLED_Data_Mode);                              // **** Set OLED Data mode
+    i2cBus.write(data, count);
+    i2cBus.endTransmission(); // **** End I2C
+    PROFILE_I2C(OLED_Address, count + 1);
+    data += count;
+    length -= count;
+  }
 }
 
 // Function for printing up tp three 3x3 digits. Works from 000-999 or 00.0-99.9 if decimalPoint is true
@@ -227,182 +485,85 @@ void OLedI2C::print3x3Number(uint8_t column, uint8_t row, uint16_t number, bool
   uint8_t bn1[] = {5, 2, 6, 32, 5, 32, 2, 2, 6, 2, 2, 6, 31, 32, 31, 31, 2, 2, 5, 2, 2, 2, 2, 6, 5, 2, 6, 5, 2, 6};
   uint8_t bn2[] = {31, 32, 31, 32, 31, 32, 5, 2, 2, 32, 2, 31, 0, 2, 31, 0, 2, 1, 31, 2, 1, 32, 32, 31, 31, 2, 31, 0, 2, 31};
   uint8_t bn3[] = {4, 7, 3, 32, 31, 32, 4, 7, 7, 7, 7, 3, 32, 32, 31, 7, 7, 3, 4, 7, 3, 32, 32, 3, 4, 7, 3, 7, 7, 3};
+  const uint8_t *glyphs = glyphs3x3;
 
   firstdigit = (number / 100) * 3;
   seconddigit = ((number % 100) / 10) * 3;
   thirddigit = ((number % 100) % 10) * 3;
 
-  if (charSet != 1)
-  {
-    defineCustomChar3x3();
-    charSet = 1;
-  }
+  glyphsPinned = 0;
 
   setCursor(column, row);
   if (firstdigit == 0)
     print("   ");
   else
   {
-    sendData(bn1[firstdigit]);
-    sendData(bn1[firstdigit + 1]);
-    sendData(bn1[firstdigit + 2]);
+    writeGlyph(bn1[firstdigit], glyphs);
+    writeGlyph(bn1[firstdigit + 1], glyphs);
+    writeGlyph(bn1[firstdigit + 2], glyphs);
   }
 
   if (firstdigit == 0 && seconddigit == 0 && decimalPoint == false)
     print("   ");
   else
   {
-    sendData(bn1[seconddigit]);
-    sendData(bn1[seconddigit + 1]);
-    sendData(bn1[seconddigit + 2]);
+    writeGlyph(bn1[seconddigit], glyphs);
+    writeGlyph(bn1[seconddigit + 1], glyphs);
+    writeGlyph(bn1[seconddigit + 2], glyphs);
   }
   if (decimalPoint)
-    sendData(32);
-  sendData(bn1[thirddigit]);
-  sendData(bn1[thirddigit + 1]);
-  sendData(bn1[thirddigit + 2]);
+    write(32);
+  writeGlyph(bn1[thirddigit], glyphs);
+  writeGlyph(bn1[thirddigit + 1], glyphs);
+  writeGlyph(bn1[thirddigit + 2], glyphs);
 
   setCursor(column, row + 1);
   if (firstdigit == 0)
     print("   ");
   else
   {
-    sendData(bn2[firstdigit]);
-    sendData(bn2[firstdigit + 1]);
-    sendData(bn2[firstdigit + 2]);
+    writeGlyph(bn2[firstdigit], glyphs);
+    writeGlyph(bn2[firstdigit + 1], glyphs);
+    writeGlyph(bn2[firstdigit + 2], glyphs);
   }
   if (firstdigit == 0 && seconddigit == 0 && decimalPoint == false)
     print("   ");
   else
   {
-    sendData(bn2[seconddigit]);
-    sendData(bn2[seconddigit + 1]);
-    sendData(bn2[seconddigit + 2]);
+    writeGlyph(bn2[seconddigit], glyphs);
+    writeGlyph(bn2[seconddigit + 1], glyphs);
+    writeGlyph(bn2[seconddigit + 2], glyphs);
   }
   if (decimalPoint)
-    sendData(32);
-  sendData(bn2[thirddigit]);
-  sendData(bn2[thirddigit + 1]);
-  sendData(bn2[thirddigit + 2]);
+    write(32);
+  writeGlyph(bn2[thirddigit], glyphs);
+  writeGlyph(bn2[thirddigit + 1], glyphs);
+  writeGlyph(bn2[thirddigit + 2], glyphs);
 
   setCursor(column, row + 2);
   if (firstdigit == 0)
     print("   ");
   else
   {
-    sendData(bn3[firstdigit]);
-    sendData(bn3[firstdigit + 1]);
-    sendData(bn3[firstdigit + 2]);
+    writeGlyph(bn3[firstdigit], glyphs);
+    writeGlyph(bn3[firstdigit + 1], glyphs);
+    writeGlyph(bn3[firstdigit + 2], glyphs);
   }
   if (firstdigit == 0 && seconddigit == 0 && decimalPoint == false)
     print("   ");
   else
   {
-    sendData(bn3[seconddigit]);
-    sendData(bn3[seconddigit + 1]);
-    sendData(bn3[seconddigit + 2]);
+    writeGlyph(bn3[seconddigit], glyphs);
+    writeGlyph(bn3[seconddigit + 1], glyphs);
+    writeGlyph(bn3[seconddigit + 2], glyphs);
   }
   if (decimalPoint)
-    sendData(46);
-  sendData(bn3[thirddigit]);
-  sendData(bn3[thirddigit + 1]);
-  sendData(bn3[thirddigit + 2]);
+    write(46);
+  writeGlyph(bn3[thirddigit], glyphs);
+  writeGlyph(bn3[thirddigit + 1], glyphs);
+  writeGlyph(bn3[thirddigit + 2], glyphs);
 }
 
-void OLedI2C::defineCustomChar3x3()
-{
-
-  // 3x3 charset
-
-  uint8_t cc0[8] = {// Custom Character 0
-                    B11111,
-                    B11111,
-                    B01111,
-                    B00111,
-                    B00011,
-                    B00000,
-                    B00000,
-                    B00000};
-
-  uint8_t cc1[8] = {// Custom Character 1
-                    B00000,
-                    B10000,
-                    B11000,
-                    B11100,
-                    B11110,
-                    B11111,
-                    B11111,
-                    B11111};
-
-  uint8_t cc2[8] = {// Custom Character 2
-                    B11111,
-                    B11111,
-                    B11111,
-                    B11111,
-                    B11111,
-                    B00000,
-                    B00000,
-                    B00000};
-
-  uint8_t cc3[8] = {// Custom Character 3
-                    B11111,
-                    B11111,
-                    B11111,
-                    B11111,
-                    B11111,
-                    B11110,
-                    B11100,
-                    B11000};
-
-  uint8_t cc4[8] = {// Custom Character 4
-                    B11111,
-                    B11111,
-                    B11111,
-                    B11111,
-                    B11111,
-                    B01111,
-                    B00111,
-                    B00011};
-
-  uint8_t cc5[8] = {// Custom Character 5
-                    B00011,
-                    B00111,
-                    B01111,
-                    B11111,
-                    B11111,
-                    B11111,
-                    B11111,
-                    B11111};
-
-  uint8_t cc6[8] = {// Custom Character 6
-                    B11000,
-                    B11100,
-                    B11110,
-                    B11111,
-                    B11111,
-                    B11111,
-                    B11111,
-                    B11111};
-
-  uint8_t cc7[8] = {// Custom Character 7
-                    B00000,
-                    B00000,
-                    B00000,
-                    B11111,
-                    B11111,
-                    B11111,
-                    B11111,
-                    B11111};
-  createChar(0, cc0);
-  createChar(1, cc1);
-  createChar(2, cc2);
-  createChar(3, cc3);
-  createChar(4, cc4);
-  createChar(5, cc5);
-  createChar(6, cc6);
-  createChar(7, cc7);
-  charSet = 1;
-}
 
 // Function for printing two 4x4 digits. Works from 00-99
 void OLedI2C::print4x4Number(uint8_t column, uint8_t number)
@@ -413,131 +574,46 @@ void OLedI2C::print4x4Number(uint8_t column, uint8_t number)
   uint8_t bn2[] = {31, 32, 32, 31, 32, 32, 31, 32, 0, 3, 3, 7, 32, 3, 3, 31, 4, 3, 3, 31, 4, 3, 3, 6, 31, 3, 3, 6, 32, 32, 0, 7, 31, 3, 3, 31, 4, 3, 3, 31};
   uint8_t bn3[] = {31, 32, 32, 31, 32, 32, 31, 32, 31, 32, 32, 32, 32, 32, 32, 31, 32, 32, 32, 31, 32, 32, 32, 31, 31, 32, 32, 31, 32, 32, 31, 32, 31, 32, 32, 31, 32, 32, 32, 31};
   uint8_t bn4[] = {4, 3, 3, 7, 32, 3, 31, 3, 4, 3, 3, 3, 4, 3, 3, 7, 32, 32, 32, 31, 4, 3, 3, 7, 4, 3, 3, 7, 32, 32, 31, 32, 4, 3, 3, 7, 4, 3, 3, 7};
-  if (charSet != 2)
-    defineCustomChar4x4();
+  const uint8_t *glyphs = glyphs4x4;
+  glyphsPinned = 0;
   setCursor(column, 0);
-  sendData(bn1[firstdigit]);
-  sendData(bn1[firstdigit + 1]);
-  sendData(bn1[firstdigit + 2]);
-  sendData(bn1[firstdigit + 3]);
-  sendData(32); // Blank
-  sendData(bn1[seconddigit]);
-  sendData(bn1[seconddigit + 1]);
-  sendData(bn1[seconddigit + 2]);
-  sendData(bn1[seconddigit + 3]);
+  writeGlyph(bn1[firstdigit], glyphs);
+  writeGlyph(bn1[firstdigit + 1], glyphs);
+  writeGlyph(bn1[firstdigit + 2], glyphs);
+  writeGlyph(bn1[firstdigit + 3], glyphs);
+  write(32); // Blank
+  writeGlyph(bn1[seconddigit], glyphs);
+  writeGlyph(bn1[seconddigit + 1], glyphs);
+  writeGlyph(bn1[seconddigit + 2], glyphs);
+  writeGlyph(bn1[seconddigit + 3], glyphs);
   setCursor(column, 1);
-  sendData(bn2[firstdigit]);
-  sendData(bn2[firstdigit + 1]);
-  sendData(bn2[firstdigit + 2]);
-  sendData(bn2[firstdigit + 3]);
-  sendData(32); // Blank
-  sendData(bn2[seconddigit]);
-  sendData(bn2[seconddigit + 1]);
-  sendData(bn2[seconddigit + 2]);
-  sendData(bn2[seconddigit + 3]);
+  writeGlyph(bn2[firstdigit], glyphs);
+  writeGlyph(bn2[firstdigit + 1], glyphs);
+  writeGlyph(bn2[firstdigit + 2], glyphs);
+  writeGlyph(bn2[firstdigit + 3], glyphs);
+  write(32); // Blank
+  writeGlyph(bn2[seconddigit], glyphs);
+  writeGlyph(bn2[seconddigit + 1], glyphs);
+  writeGlyph(bn2[seconddigit + 2], glyphs);
+  writeGlyph(bn2[seconddigit + 3], glyphs);
   setCursor(column, 2);
-  sendData(bn3[firstdigit]);
-  sendData(bn3[firstdigit + 1]);
-  sendData(bn3[firstdigit + 2]);
-  sendData(bn3[firstdigit + 3]);
-  sendData(32); // Blank
-  sendData(bn3[seconddigit]);
-  sendData(bn3[seconddigit + 1]);
-  sendData(bn3[seconddigit + 2]);
-  sendData(bn3[seconddigit + 3]);
+  writeGlyph(bn3[firstdigit], glyphs);
+  writeGlyph(bn3[firstdigit + 1], glyphs);
+  writeGlyph(bn3[firstdigit + 2], glyphs);
+  writeGlyph(bn3[firstdigit + 3], glyphs);
+  write(32); // Blank
+  writeGlyph(bn3[seconddigit], glyphs);
+  writeGlyph(bn3[seconddigit + 1], glyphs);
+  writeGlyph(bn3[seconddigit + 2], glyphs);
+  writeGlyph(bn3[seconddigit + 3], glyphs);
   setCursor(column, 3);
-  sendData(bn4[firstdigit]);
-  sendData(bn4[firstdigit + 1]);
-  sendData(bn4[firstdigit + 2]);
-  sendData(bn4[firstdigit + 3]);
-  sendData(32); // Blank
-  sendData(bn4[seconddigit]);
-  sendData(bn4[seconddigit + 1]);
-  sendData(bn4[seconddigit + 2]);
-  sendData(bn4[seconddigit + 3]);
+  writeGlyph(bn4[firstdigit], glyphs);
+  writeGlyph(bn4[firstdigit + 1], glyphs);
+  writeGlyph(bn4[firstdigit + 2], glyphs);
+  writeGlyph(bn4[firstdigit + 3], glyphs);
+  write(32); // Blank
+  writeGlyph(bn4[seconddigit], glyphs);
+  writeGlyph(bn4[seconddigit + 1], glyphs);
+  writeGlyph(bn4[seconddigit + 2], glyphs);
+  writeGlyph(bn4[seconddigit + 3], glyphs);
 }
-void OLedI2C::defineCustomChar4x4()
-{
-  // 4x4 charset
-  uint8_t cc0[8] = {// Custom Character 0
-                    B00000,
-                    B00000,
-                    B00000,
-                    B00001,
-                    B00011,
-                    B00111,
-                    B01111,
-                    B11111};
-  uint8_t cc1[8] = {// Custom Character 1
-                    B10000,
-                    B11000,
-                    B11100,
-                    B11110,
-                    B11111,
-                    B11111,
-                    B11111,
-                    B11111};
-  uint8_t cc2[8] = {// Custom Character 2
-                    B11111,
-                    B11111,
-                    B11111,
-                    B11111,
-                    B11111,
-                    B00000,
-                    B00000,
-                    B00000};
-  uint8_t cc3[8] = {// Custom Character 3
-                    B00000,
-                    B00000,
-                    B00000,
-                    B11111,
-                    B11111,
-                    B11111,
-                    B11111,
-                    B11111};
-  uint8_t cc4[8] = {// Custom Character 4
-                    B11111,
-                    B11111,
-                    B11111,
-                    B11111,
-                    B01111,
-                    B00111,
-                    B00011,
-                    B00001};
-  uint8_t cc5[8] = {// Custom Character 5
-                    B00001,
-                    B00011,
-                    B00111,
-                    B01111,
-                    B11111,
-                    B11111,
-                    B11111,
-                    B11111};
-  uint8_t cc6[8] = {// Custom Character 6
-                    B00000,
-                    B00000,
-                    B00000,
-                    B10000,
-                    B11000,
-                    B11100,
-                    B11110,
-                    B11111};
-  uint8_t cc7[8] = {// Custom Character 7
-                    B11111,
-                    B11111,
-                    B11111,
-                    B11111,
-                    B11110,
-                    B11100,
-                    B11000,
-                    B10000};
-  createChar(0, cc0);
-  createChar(1, cc1);
-  createChar(2, cc2);
-  createChar(3, cc3);
-  createChar(4, cc4);
-  createChar(5, cc5);
-  createChar(6, cc6);
-  createChar(7, cc7);
-  charSet = 2;
-}
\ No newline at end of file
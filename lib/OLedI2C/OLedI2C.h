@@ -10,6 +10,11 @@ Adapted and expanded by Jan Tofft, jan@tofft.dk, 2017
 Inheritance of Print functions added, jan@tofft.dk, 2020
 Possibility to flip the display added (search for "Set Entry Mode (invert)" in OLedI2C.cpp), jan@tofft.dk, 2020
 BlinkingCursorOn/Off added, jan@tofft.dk, 2020
+Frame buffer added - output is kept in RAM and only changed cells are sent to the display by flush()
+Data is sent in bursts of up to I2C_BUS_BUFFER bytes per I2C transmission and the flat 10 ms delay after each command is replaced by the execution time of the command
+Glyph cache added - the custom characters of the large digits are uploaded to CGRAM when a number needs them, instead of the full character set every time the digit style changes
+Power up split into steps - beginPowerUp()/continuePowerUp() let the caller do other work during the power stabilization delays. Output is kept in the frame buffer until the display is up
+Sent through the shared I2CBus - the transactions are queued with the lowest priority and sent by the TWI interrupt
 */
 #ifndef OLedI2C_h
 #define OLedI2C_h
@@ -17,7 +22,7 @@ BlinkingCursorOn/Off added, jan@tofft.dk, 2020
 #include "Print.h"
 #include <stddef.h>
 #include <stdint.h>
-#include "Wire.h"
+#include "I2CBus.h"
 #include <stdarg.h>
 
 #define LCD_ROWS  4
@@ -32,28 +37,52 @@ public:
 	OLedI2C();
 	~OLedI2C();
 	void begin();
-	void sendCommand(uint8_t command);
+	void sendCommand(uint8_t command, bool slow = false); // slow must be set for Clear Display and Return Home - the execution time of them is waited for
 	void sendData(uint8_t data);
+	void sendData(const uint8_t *data, size_t length); // Burst of data bytes, split into as few I2C transmissions as possible
 	void createChar(uint8_t, uint8_t[]);
 	void clear();
 	void setCursor(uint8_t, uint8_t); // Column, Row
+	void flush(); // Send the cells changed since the last flush to the display
 	void lcdOff();
 	void lcdOn();
 	void BlinkingCursorOn();
     void BlinkingCursorOff();
 	void PowerDown();
 	void PowerUp();
+	// Non-blocking power up: beginPowerUp() returns the ms to wait before calling continuePowerUp(), which returns the ms to wait before calling it again - 0 when the display is up
+	// Until then nothing is sent to the display, what is printed is drawn by the first flush() after it is up
+	uint8_t beginPowerUp();
+	uint8_t continuePowerUp();
+	bool ready() { return powerUpStep == 0; }
 	void backlight(uint8_t contrast); // contrast should be the hex value between 0x00 and 0xFF
  	void print3x3Number(uint8_t column, uint8_t row, uint16_t number, bool decimalPoint); // prints large number 3x3 char per digit. Leading 0's are not displayed
-	void defineCustomChar3x3();
 	void print4x4Number(uint8_t column, uint8_t number); // prints large number
-	void defineCustomChar4x4();
-
-    byte charSet = 0; // 0 = no custom chars defined, 1 = 3x3 chars defined, 2 = 4x4 chars defined
 
 	// support of Print class
 	virtual size_t write(uint8_t ch);
+	virtual size_t write(const uint8_t *buffer, size_t size);
 	using Print::write;
+
+private:
+	void setDDRAMAddress(uint8_t col, uint8_t row);
+	uint8_t glyphSlot(uint8_t glyph);
+	uint8_t glyphsShown();
+	void clearGlyphUses();
+	void writeGlyph(uint8_t code, const uint8_t *glyphs);
+
+	uint8_t frameBuffer[LCD_ROWS][LCD_COLS]; // The characters the display should show
+	uint32_t dirtyCells[LCD_ROWS];           // One bit per column - set if the cell has changed since the last flush
+	uint8_t cursorCol = 0;
+	uint8_t cursorRow = 0;
+	uint8_t cgramGlyph[8];    // The glyph held by each CGRAM location (0xFF if unknown)
+	uint8_t glyphsPinned = 0; // One bit per CGRAM location - set if used by the number being printed
+	uint8_t glyphUses[8];     // Number of cells of the frame buffer holding each CGRAM location
+	uint8_t glyphUsesShown[8]; // Number of cells changed since the last flush that still show each CGRAM location on the display
+	uint8_t glyphVictim = 0;  // The CGRAM location to be replaced next
+	uint8_t powerUpStep = 0;  // The next step of the power up (0 when the display is up)
+	unsigned long powerUpDue; // millis when the next step of the power up may be done
+	uint8_t contrast = 0xFF;  // Set by the power up, so backlight() called before the display is up is not lost
 };
 #endif
 
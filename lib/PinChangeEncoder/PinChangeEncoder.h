@@ -0,0 +1,168 @@
+/*
+**
+** Pin change interrupt driven rotary encoder for MezmerizeB1Buffer
+**
+** A replacement of ClickEncoder (same decoder, acceleration and button
+** handling) that doesn't need to be serviced every millisecond:
+** - the pins are given as template parameters and read directly from the
+**   PINx registers, so reading a pin is a single instruction
+** - the quadrature signal is decoded from the pin change interrupt of pin A
+**   and B: update() must be called from ISR(PCINTx_vect) of their ports
+** - the button and the deceleration are handled by service(), which only needs
+**   to be called every PIN_CHANGE_ENCODER_TICK ms
+** Only the pins of the ATmega328P (Arduino pin 0-19) are supported.
+**
+** Copyright (c) 2020 Carsten Grønning, Jan Abkjer Tofft
+**
+*/
+
+#ifndef PinChangeEncoder_h_
+#define PinChangeEncoder_h_
+
+#include <Arduino.h>
+#include "ClickEncoder.h"
+
+#define PIN_CHANGE_ENCODER_TICK 10          // ms between calls of service() - also the debounce time of the button
+#define PIN_CHANGE_ENCODER_DOUBLECLICK 600  // Second click within 600 ms
+#define PIN_CHANGE_ENCODER_HOLD 1200        // Report held button after 1.2 s
+#define PIN_CHANGE_ENCODER_ACCEL_TOP 3072   // Max. acceleration: *12 (acceleration >> 8)
+#define PIN_CHANGE_ENCODER_ACCEL_INC 25     // Per step of the quadrature signal
+#define PIN_CHANGE_ENCODER_ACCEL_DEC (2 * PIN_CHANGE_ENCODER_TICK) // Per call of service()
+
+// Direct access to an Arduino pin known at compile time - all the expressions are folded by the compiler
+template <uint8_t PIN>
+struct FastPin
+{
+  static_assert(PIN < 20, "Only the pins of the ATmega328P are supported");
+
+  static inline uint8_t mask() { return _BV(PIN < 8 ? PIN : (PIN < 14 ? PIN - 8 : PIN - 14)); }
+  static inline bool read() { return ((PIN < 8) ? PIND : (PIN < 14 ? PINB : PINC)) & mask(); }
+  // Enables the pin change interrupt of the pin (PCINT2_vect for pin 0-7, PCINT0_vect for pin 8-13, PCINT1_vect for pin 14-19)
+  static inline void enablePinChangeInterrupt()
+  {
+    if (PIN < 8)
+      PCMSK2 |= mask();
+    else if (PIN < 14)
+      PCMSK0 |= mask();
+    else
+      PCMSK1 |= mask();
+    PCICR |= _BV(PIN < 8 ? PCIE2 : (PIN < 14 ? PCIE0 : PCIE1));
+  }
+};
+
+template <uint8_t PIN_A, uint8_t PIN_B, uint8_t PIN_BTN, uint8_t STEPS_PER_NOTCH = 1>
+class PinChangeEncoder
+{
+  public:
+    PinChangeEncoder() : delta(0), last(0), acceleration(0), button(ClickEncoder::Open), keyDownTicks(0), doubleClickTicks(0) {}
+
+    // Enables the pull-ups (the pins are active low) and the pin change interrupts of pin A and B
+    void begin()
+    {
+      pinMode(PIN_A, INPUT_PULLUP);
+      pinMode(PIN_B, INPUT_PULLUP);
+      pinMode(PIN_BTN, INPUT_PULLUP);
+      last = current();
+      FastPin<PIN_A>::enablePinChangeInterrupt();
+      FastPin<PIN_B>::enablePinChangeInterrupt();
+    }
+
+    // Call from the pin change interrupt of pin A and B - it does nothing if they haven't changed (i.e. if the interrupt was caused by another pin of the port)
+    inline void update()
+    {
+      int8_t curr = current();
+      int8_t diff = last - curr;
+
+      if (diff & 1) // bit 0 = step
+      {
+        last = curr;
+        delta += (diff & 2) - 1; // bit 1 = direction (+/-)
+        if (acceleration <= PIN_CHANGE_ENCODER_ACCEL_TOP - PIN_CHANGE_ENCODER_ACCEL_INC)
+          acceleration += PIN_CHANGE_ENCODER_ACCEL_INC;
+      }
+    }
+
+    // Call every PIN_CHANGE_ENCODER_TICK ms (i.e. from a timer interrupt)
+    void service()
+    {
+      acceleration = (acceleration > PIN_CHANGE_ENCODER_ACCEL_DEC) ? acceleration - PIN_CHANGE_ENCODER_ACCEL_DEC : 0;
+
+      if (!FastPin<PIN_BTN>::read()) // Key is down
+      {
+        keyDownTicks++;
+        if (keyDownTicks > PIN_CHANGE_ENCODER_HOLD / PIN_CHANGE_ENCODER_TICK)
+          button = ClickEncoder::Held;
+      }
+      else // Key is up
+      {
+        if (keyDownTicks)
+        {
+          if (button == ClickEncoder::Held)
+          {
+            button = ClickEncoder::Released;
+            doubleClickTicks = 0;
+          }
+          else if (doubleClickTicks > 1)
+          {
+            button = ClickEncoder::DoubleClicked;
+            doubleClickTicks = 0;
+          }
+          else
+            doubleClickTicks = PIN_CHANGE_ENCODER_DOUBLECLICK / PIN_CHANGE_ENCODER_TICK;
+        }
+        keyDownTicks = 0;
+      }
+
+      if (doubleClickTicks > 0)
+      {
+        doubleClickTicks--;
+        if (--doubleClickTicks == 0)
+          button = ClickEncoder::Clicked;
+      }
+    }
+
+    // Returns the number of notches turned since the last call - plus the acceleration in the direction turned
+    int16_t getValue()
+    {
+      int16_t val;
+      uint8_t oldSREG = SREG; // May be called from an interrupt routine, so the interrupt state is restored instead of enabled
+
+      cli();
+      val = delta;
+      delta = val % STEPS_PER_NOTCH;
+      SREG = oldSREG;
+
+      val /= STEPS_PER_NOTCH;
+      if (val == 0)
+        return 0;
+      int16_t accel = acceleration >> 8;
+      return (val < 0) ? val - accel : val + accel;
+    }
+
+    ClickEncoder::Button getButton()
+    {
+      ClickEncoder::Button ret = button;
+      if (button != ClickEncoder::Held)
+        button = ClickEncoder::Open;
+      return ret;
+    }
+
+  private:
+    volatile int16_t delta;
+    volatile int8_t last;
+    volatile uint16_t acceleration;
+    volatile ClickEncoder::Button button;
+    uint16_t keyDownTicks;
+    uint8_t doubleClickTicks;
+
+    // Gray code of pin A and B as 0, 1, 2, 3 (like ClickEncoder)
+    static inline int8_t current()
+    {
+      int8_t curr = FastPin<PIN_A>::read() ? 0 : 3;
+      if (!FastPin<PIN_B>::read())
+        curr ^= 1;
+      return curr;
+    }
+};
+
+#endif
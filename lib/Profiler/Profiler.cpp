@@ -0,0 +1,169 @@
+#include "Profiler.h"
+
+#ifdef PROFILING
+
+Profiler profiler;
+
+#ifdef __AVR__
+extern uint8_t _end;
+extern uint8_t __stack;
+
+// Runs before the constructors and main() - the stack is still empty, so all the RAM above .bss can be painted
+void paintStack(void) __attribute__((naked, used, section(".init3")));
+void paintStack(void)
+{
+  for (uint8_t *p = &_end; p <= &__stack; p++)
+    *p = PROFILER_STACK_PAINT;
+}
+#endif
+
+Profiler::Profiler()
+{
+  for (uint8_t i = 0; i < PROFILER_DEVICES - 1; i++)
+    deviceAddress[i] = 0xFF;
+  reset();
+}
+
+void Profiler::reset()
+{
+  loops = 0;
+  loopMin = 0xFFFFFFFF;
+  loopMax = 0;
+  lastLoopStart = 0;
+  memset(histogram, 0, sizeof(histogram));
+  memset(i2c, 0, sizeof(i2c));
+  memset(&spi, 0, sizeof(spi));
+  memset(sections, 0, sizeof(sections));
+}
+
+void Profiler::setDevice(uint8_t index, uint8_t address)
+{
+  if (index < PROFILER_DEVICES - 1)
+    deviceAddress[index] = address;
+}
+
+// ---------------------------------------------------
+void Profiler::loopStart()
+{
+  uint32_t now = micros();
+
+  // The first call after reset() has nothing to measure
+  if (lastLoopStart != 0)
+  {
+    uint32_t time = now - lastLoopStart;
+    loops++;
+    if (time < loopMin)
+      loopMin = time;
+    if (time > loopMax)
+      loopMax = time;
+
+    uint8_t bucket = 0;
+    while (bucket < PROFILER_BUCKETS - 1 && time >= ((uint32_t)PROFILER_BUCKET_US << bucket))
+      bucket++;
+    if (histogram[bucket] != 0xFFFF)
+      histogram[bucket]++;
+  }
+  lastLoopStart = now ? now : 1;
+}
+
+void Profiler::countI2C(uint8_t address, uint8_t bytes)
+{
+  uint8_t device = 0;
+  while (device < PROFILER_DEVICES - 1 && deviceAddress[device] != address)
+    device++;
+  i2c[device].transactions++;
+  i2c[device].bytes += bytes;
+}
+
+void Profiler::countSPI(uint8_t bytes)
+{
+  spi.transactions++;
+  spi.bytes += bytes;
+}
+
+void Profiler::addSection(uint8_t section, uint32_t us)
+{
+  if (section >= PROFILER_SECTIONS)
+    return;
+  sections[section].calls++;
+  sections[section].total += us;
+  if (us > sections[section].max)
+    sections[section].max = us;
+}
+
+// ---------------------------------------------------
+bool Profiler::getRecord(uint8_t index, uint32_t &value)
+{
+  if (index < 3)
+  {
+    value = (index == 0) ? loops : (index == 1) ? (loops ? loopMin : 0) : loopMax;
+    return true;
+  }
+  index -= 3;
+
+  if (index < PROFILER_BUCKETS)
+  {
+    value = histogram[index];
+    return true;
+  }
+  index -= PROFILER_BUCKETS;
+
+  if (index < 3 * PROFILER_DEVICES)
+  {
+    uint8_t device = index / 3;
+    switch (index % 3)
+    {
+      case 0:
+        value = (device < PROFILER_DEVICES - 1) ? deviceAddress[device] : 0xFF;
+        break;
+      case 1:
+        value = i2c[device].transactions;
+        break;
+      default:
+        value = i2c[device].bytes;
+    }
+    return true;
+  }
+  index -= 3 * PROFILER_DEVICES;
+
+  if (index < 2)
+  {
+    value = (index == 0) ? spi.transactions : spi.bytes;
+    return true;
+  }
+  index -= 2;
+
+  if (index < 3 * PROFILER_SECTIONS)
+  {
+    Section &s = sections[index / 3];
+    value = (index % 3 == 0) ? s.calls : (index % 3 == 1) ? s.total : s.max;
+    return true;
+  }
+  index -= 3 * PROFILER_SECTIONS;
+
+  if (index == 0)
+  {
+    value = stackHeadroom();
+    return true;
+  }
+  return false;
+}
+
+uint16_t Profiler::stackHeadroom()
+{
+#ifdef __AVR__
+  const uint8_t *p = &_end;
+  while (p <= &__stack && *p == PROFILER_STACK_PAINT)
+    p++;
+  return p - &_end;
+#else
+  return 0;
+#endif
+}
+
+ProfileSection::~ProfileSection()
+{
+  profiler.addSection(section, micros() - start);
+}
+
+#endif
@@ -0,0 +1,119 @@
+/*
+**
+** Profiler for MezmerizeB1Buffer
+**
+** Only compiled into the firmware when PROFILING is defined (pio run -e
+** nanoatmega328_profiling) - otherwise the PROFILE_... macros are empty and
+** the profiler takes no memory and no time.
+** It records the time of every iteration of loop() (min, max and a histogram),
+** counts the transactions and bytes sent to each I2C device and to the SPI bus
+** and times the sections of code marked with PROFILE_SECTION().
+**
+** The results are read as a list of 32 bit records with getRecord():
+**   0                  loop iterations
+**   1, 2               min and max loop time in us
+**   3 ...              histogram: bucket n counts loop times below PROFILER_BUCKET_US << n
+**                      (the last bucket counts all longer ones, the counts stop at 65535)
+**   for each device:   I2C address, transactions and bytes (the last device counts all
+**                      addresses not given to setDevice())
+**   then:              SPI transactions and bytes
+**   for each section:  calls, total time in us and max time in us
+**   then:              bytes of RAM never reached by the stack since power on (the RAM
+**                      above .bss is painted at startup and the untouched bytes are
+**                      counted - 0 when not built for the AVR)
+**
+** Copyright (c) 2020 Carsten Grønning, Jan Abkjer Tofft
+**
+*/
+
+#ifndef Profiler_h_
+#define Profiler_h_
+
+#include <Arduino.h>
+
+#define PROFILER_BUCKETS 10
+#define PROFILER_BUCKET_US 128
+#define PROFILER_DEVICES 4
+#define PROFILER_SECTIONS 6
+#define PROFILER_RECORDS (3 + PROFILER_BUCKETS + 3 * PROFILER_DEVICES + 2 + 3 * PROFILER_SECTIONS + 1)
+#define PROFILER_STACK_PAINT 0xC5
+
+#ifdef PROFILING
+
+class Profiler
+{
+  public:
+    Profiler();
+
+    // Clears all counters (the device addresses are kept)
+    void reset();
+
+    // Gives I2C address its own counters - index must be below PROFILER_DEVICES - 1
+    void setDevice(uint8_t index, uint8_t address);
+
+    // Called at the start of every iteration of loop() - the time since the previous call is recorded
+    void loopStart();
+    void countI2C(uint8_t address, uint8_t bytes);
+    void countSPI(uint8_t bytes);
+    void addSection(uint8_t section, uint32_t us);
+
+    // Gets record index (see above). Returns false if there is no such record.
+    bool getRecord(uint8_t index, uint32_t &value);
+
+    // Bytes between the end of .bss and the deepest point the stack has reached
+    static uint16_t stackHeadroom();
+
+  private:
+    struct Counter
+    {
+      uint32_t transactions;
+      uint32_t bytes;
+    };
+
+    struct Section
+    {
+      uint32_t calls;
+      uint32_t total;
+      uint32_t max;
+    };
+
+    uint32_t loops;
+    uint32_t loopMin;
+    uint32_t loopMax;
+    uint32_t lastLoopStart;
+    uint16_t histogram[PROFILER_BUCKETS];
+    uint8_t deviceAddress[PROFILER_DEVICES - 1];
+    Counter i2c[PROFILER_DEVICES];
+    Counter spi;
+    Section sections[PROFILER_SECTIONS];
+};
+
+// Times the rest of the scope it is declared in
+class ProfileSection
+{
+  public:
+    ProfileSection(uint8_t section) : section(section), start(micros()) {}
+    ~ProfileSection();
+
+  private:
+    uint8_t section;
+    uint32_t start;
+};
+
+extern Profiler profiler;
+
+#define PROFILE_LOOP() profiler.loopStart()
+#define PROFILE_I2C(address, bytes) profiler.countI2C(address, bytes)
+#define PROFILE_SPI(bytes) profiler.countSPI(bytes)
+#define PROFILE_SECTION(section) ProfileSection profileSection_(section)
+
+#else
+
+#define PROFILE_LOOP()
+#define PROFILE_I2C(address, bytes)
+#define PROFILE_SPI(bytes)
+#define PROFILE_SECTION(section)
+
+#endif
+
+#endif
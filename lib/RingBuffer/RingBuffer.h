@@ -0,0 +1,72 @@
+/*
+**
+** Single producer/single consumer ring buffer for MezmerizeB1Buffer
+**
+** One side (typically an interrupt routine) only pushes and the other side only
+** pops, so no locking is needed: each index is a single byte that is written by
+** one side only.
+**
+** Copyright (c) 2020 Carsten Grønning, Jan Abkjer Tofft
+**
+*/
+
+#ifndef RingBuffer_h_
+#define RingBuffer_h_
+
+#include <Arduino.h>
+
+template <typename T, uint8_t SIZE> // SIZE must be a power of two - the buffer holds up to SIZE - 1 items
+class RingBuffer
+{
+  static_assert((SIZE & (SIZE - 1)) == 0, "SIZE must be a power of two");
+
+  public:
+    RingBuffer() : head(0), tail(0) {}
+
+    // Adds item to the buffer. Producer side only. Returns false if the buffer is full.
+    bool push(const T &item)
+    {
+      uint8_t next = (head + 1) & (SIZE - 1);
+      if (next == tail)
+        return false;
+      buffer[head] = item;
+      __asm__ __volatile__("" ::: "memory"); // The item must be stored before it is published by head
+      head = next;
+      return true;
+    }
+
+    // Removes the oldest item from the buffer. Consumer side only. Returns false if the buffer is empty.
+    bool pop(T &item)
+    {
+      if (tail == head)
+        return false;
+      __asm__ __volatile__("" ::: "memory"); // Don't read the item before head has been checked
+      item = buffer[tail];
+      __asm__ __volatile__("" ::: "memory"); // The item must be copied before its slot is released to the producer by tail
+      tail = (tail + 1) & (SIZE - 1);
+      return true;
+    }
+
+    // Gets the oldest item without removing it. Consumer side only. Returns false if the buffer is empty.
+    bool peek(T &item)
+    {
+      if (tail == head)
+        return false;
+      __asm__ __volatile__("" ::: "memory");
+      item = buffer[tail];
+      return true;
+    }
+
+    bool isEmpty() { return head == tail; }
+    bool isFull() { return ((head + 1) & (SIZE - 1)) == tail; }
+
+    // Removes all items. Consumer side only.
+    void clear() { tail = head; }
+
+  private:
+    T buffer[SIZE];
+    volatile uint8_t head; // Next position to write - only changed by push()
+    volatile uint8_t tail; // Next position to read - only changed by pop() and clear()
+};
+
+#endif
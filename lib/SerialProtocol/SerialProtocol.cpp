@@ -0,0 +1,122 @@
+#include "SerialProtocol.h"
+
+SerialProtocol::SerialProtocol(HardwareSerial &port) : port(port)
+{
+  state = WAIT_SYNC;
+  errorCount = 0;
+}
+
+void SerialProtocol::begin(unsigned long baud)
+{
+  port.begin(baud);
+  state = WAIT_SYNC;
+}
+
+// ---------------------------------------------------
+bool SerialProtocol::poll()
+{
+  if (state != WAIT_SYNC && millis() - lastByte > SERIAL_PROTOCOL_TIMEOUT)
+  {
+    state = WAIT_SYNC;
+    errorCount++;
+  }
+
+  while (port.available() > 0)
+  {
+    uint8_t data = port.read();
+    lastByte = millis();
+
+    switch (state)
+    {
+      case WAIT_SYNC:
+        if (data == SERIAL_PROTOCOL_SYNC)
+        {
+          crc = 0xFF;
+          state = WAIT_LENGTH;
+        }
+        break;
+
+      case WAIT_LENGTH:
+        if (data > SERIAL_PROTOCOL_MAX_PAYLOAD)
+        {
+          state = WAIT_SYNC;
+          errorCount++;
+          break;
+        }
+        frameLength = data;
+        received = 0;
+        crc = crc8(crc, data);
+        state = WAIT_COMMAND;
+        break;
+
+      case WAIT_COMMAND:
+        frameCommand = data;
+        crc = crc8(crc, data);
+        state = frameLength ? WAIT_PAYLOAD : WAIT_CRC;
+        break;
+
+      case WAIT_PAYLOAD:
+        buffer[received++] = data;
+        crc = crc8(crc, data);
+        if (received == frameLength)
+          state = WAIT_CRC;
+        break;
+
+      case WAIT_CRC:
+        state = WAIT_SYNC;
+        if (data == crc)
+          return true;
+        errorCount++;
+        break;
+    }
+  }
+  return false;
+}
+
+uint8_t SerialProtocol::command()
+{
+  return frameCommand;
+}
+
+const uint8_t *SerialProtocol::payload()
+{
+  return buffer;
+}
+
+uint8_t SerialProtocol::length()
+{
+  return frameLength;
+}
+
+// ---------------------------------------------------
+bool SerialProtocol::send(uint8_t command, const uint8_t *payload, uint8_t length)
+{
+  if (length > SERIAL_PROTOCOL_MAX_PAYLOAD || port.availableForWrite() < length + SERIAL_PROTOCOL_OVERHEAD)
+    return false;
+
+  uint8_t frameCrc = crc8(crc8(0xFF, length), command);
+  port.write(SERIAL_PROTOCOL_SYNC);
+  port.write(length);
+  port.write(command);
+  for (uint8_t i = 0; i < length; i++)
+  {
+    port.write(payload[i]);
+    frameCrc = crc8(frameCrc, payload[i]);
+  }
+  port.write(frameCrc);
+  return true;
+}
+
+uint16_t SerialProtocol::errors()
+{
+  return errorCount;
+}
+
+// CRC8 with polynomial 0x31 (the same as used for the journal records in the EEPROM)
+uint8_t SerialProtocol::crc8(uint8_t crc, uint8_t data)
+{
+  crc ^= data;
+  for (uint8_t bit = 0; bit < 8; bit++)
+    crc = (crc & 0x80) ? (crc << 1) ^ 0x31 : crc << 1;
+  return crc;
+}
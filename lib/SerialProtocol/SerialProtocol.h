@@ -0,0 +1,73 @@
+/*
+**
+** Binary serial protocol for MezmerizeB1Buffer
+**
+** Frames are sent both ways as:
+**
+**   SYNC (0xA5) | LENGTH | COMMAND | PAYLOAD (LENGTH bytes) | CRC
+**
+** where CRC is the CRC8 (polynomial 0x31, initial value 0xFF) of LENGTH,
+** COMMAND and PAYLOAD. Received bytes are parsed as they arrive, so poll() never
+** waits for the rest of a frame, and send() only sends a frame if it fits in the
+** transmit buffer of the UART, so it never waits for the UART either.
+** A frame with a bad CRC or a frame not completed within
+** SERIAL_PROTOCOL_TIMEOUT is thrown away and the parser waits for the next SYNC.
+**
+** Copyright (c) 2020 Carsten Grønning, Jan Abkjer Tofft
+**
+*/
+
+#ifndef SerialProtocol_h_
+#define SerialProtocol_h_
+
+#include <Arduino.h>
+
+#define SERIAL_PROTOCOL_SYNC 0xA5
+#define SERIAL_PROTOCOL_MAX_PAYLOAD 8
+#define SERIAL_PROTOCOL_OVERHEAD 4 // SYNC, LENGTH, COMMAND and CRC
+#define SERIAL_PROTOCOL_TIMEOUT 20 // Max. ms between two bytes of a frame
+
+class SerialProtocol
+{
+  public:
+    SerialProtocol(HardwareSerial &port);
+
+    void begin(unsigned long baud);
+
+    // Parses the bytes received since the last call. Returns true when a valid frame has been received - it is available from command(), payload() and length() until the next call of poll().
+    // Bytes following a complete frame are left in the receive buffer for the next call.
+    bool poll();
+    uint8_t command();
+    const uint8_t *payload();
+    uint8_t length();
+
+    // Sends a frame. Returns false (and sends nothing) if the frame doesn't fit in the transmit buffer or length exceeds SERIAL_PROTOCOL_MAX_PAYLOAD.
+    bool send(uint8_t command, const uint8_t *payload, uint8_t length);
+
+    // Number of frames thrown away because of a bad CRC, a bad length or a timeout
+    uint16_t errors();
+
+  private:
+    enum ParserState
+    {
+      WAIT_SYNC,
+      WAIT_LENGTH,
+      WAIT_COMMAND,
+      WAIT_PAYLOAD,
+      WAIT_CRC
+    };
+
+    HardwareSerial &port;
+    uint8_t state;
+    uint8_t frameCommand;
+    uint8_t frameLength;
+    uint8_t received; // Payload bytes received
+    uint8_t crc;
+    uint8_t buffer[SERIAL_PROTOCOL_MAX_PAYLOAD];
+    unsigned long lastByte; // millis when the last byte of the current frame was received
+    uint16_t errorCount;
+
+    static uint8_t crc8(uint8_t crc, uint8_t data);
+};
+
+#endif
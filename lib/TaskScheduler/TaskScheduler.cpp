@@ -0,0 +1,87 @@
+#include "TaskScheduler.h"
+
+TaskScheduler::TaskScheduler()
+{
+  for (unsigned char i = 0; i < TASK_SLOTS; i++)
+    tasks[i].callback = 0;
+}
+
+// ---------------------------------------------------
+bool TaskScheduler::schedule(TaskCallback callback, unsigned long delayMs, unsigned long intervalMs)
+{
+  Task *task = findTask(callback);
+
+  if (task == 0)
+    task = findTask(0); // Get a free slot
+  if (task == 0)
+    return false;
+
+  task->callback = callback;
+  task->due = millis() + delayMs;
+  task->interval = intervalMs;
+  return true;
+}
+
+// ---------------------------------------------------
+void TaskScheduler::cancel(TaskCallback callback)
+{
+  Task *task = findTask(callback);
+
+  if (task != 0)
+    task->callback = 0;
+}
+
+// ---------------------------------------------------
+bool TaskScheduler::isScheduled(TaskCallback callback)
+{
+  return findTask(callback) != 0;
+}
+
+// ---------------------------------------------------
+bool TaskScheduler::idle()
+{
+  for (unsigned char i = 0; i < TASK_SLOTS; i++)
+  {
+    if (tasks[i].callback != 0)
+      return false;
+  }
+  return true;
+}
+
+// ---------------------------------------------------
+void TaskScheduler::run()
+{
+  unsigned long now = millis();
+
+  for (unsigned char i = 0; i < TASK_SLOTS; i++)
+  {
+    Task *task = &tasks[i];
+    TaskCallback callback = task->callback;
+
+    // The difference is evaluated as signed to make the comparison work when millis() wraps
+    if (callback == 0 || (long)(now - task->due) < 0)
+      continue;
+
+    if (task->interval)
+    {
+      task->due += task->interval;
+      if ((long)(now - task->due) >= 0) // We're late by more than one interval - don't try to catch up
+        task->due = now + task->interval;
+    }
+    else
+      task->callback = 0; // Free the slot before the call, so the callback may schedule itself again
+
+    callback();
+  }
+}
+
+// ---------------------------------------------------
+TaskScheduler::Task *TaskScheduler::findTask(TaskCallback callback)
+{
+  for (unsigned char i = 0; i < TASK_SLOTS; i++)
+  {
+    if (tasks[i].callback == callback)
+      return &tasks[i];
+  }
+  return 0;
+}
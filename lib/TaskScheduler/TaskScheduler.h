@@ -0,0 +1,52 @@
+/*
+**
+** Cooperative task scheduler for MezmerizeB1Buffer
+**
+** Runs callbacks from loop() when their millis() deadline has passed.
+** A fixed number of slots is used, so no heap is needed, and a callback can
+** only be scheduled once - scheduling it again moves its deadline.
+**
+** Copyright (c) 2020 Carsten Grønning, Jan Abkjer Tofft
+**
+*/
+
+#ifndef TaskScheduler_h_
+#define TaskScheduler_h_
+
+#include <Arduino.h>
+
+#define TASK_SLOTS 10 // Maximum number of tasks waiting at the same time
+
+typedef void (*TaskCallback)();
+
+class TaskScheduler
+{
+  public:
+    TaskScheduler();
+
+    // Runs callback once after delayMs milliseconds. If intervalMs is not 0 it keeps running every intervalMs milliseconds after that.
+    // If callback is already scheduled, its deadline and interval are replaced. Returns false if all slots are in use.
+    bool schedule(TaskCallback callback, unsigned long delayMs, unsigned long intervalMs = 0);
+    // Removes callback from the schedule (if it is scheduled).
+    void cancel(TaskCallback callback);
+    // Returns true if callback is waiting to run.
+    bool isScheduled(TaskCallback callback);
+    // Returns true if no task is waiting to run.
+    bool idle();
+
+    // Runs the tasks that are due. Must be called as often as possible, i.e. on every pass of loop().
+    void run();
+
+  private:
+    typedef struct Task {
+      TaskCallback callback;
+      unsigned long due;
+      unsigned long interval;
+    } Task;
+
+    Task tasks[TASK_SLOTS];
+
+    Task *findTask(TaskCallback callback);
+};
+
+#endif
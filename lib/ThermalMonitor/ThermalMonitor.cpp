@@ -0,0 +1,119 @@
+#include "ThermalMonitor.h"
+
+ThermalMonitor::ThermalMonitor()
+{
+  interval = 1000;
+  maxRise = 32767;
+  reset();
+}
+
+// ---------------------------------------------------
+void ThermalMonitor::begin(uint16_t interval, int16_t maxRise)
+{
+  this->interval = interval;
+  this->maxRise = maxRise;
+  reset();
+}
+
+// ---------------------------------------------------
+void ThermalMonitor::reset()
+{
+  for (uint8_t s = 0; s < THERMAL_SENSORS; s++)
+  {
+    for (uint8_t i = 0; i < THERMAL_HISTORY; i++)
+      history[s][i] = 0;
+    newest[s] = 0;
+    count[s] = 0;
+    steep[s] = 0;
+  }
+}
+
+// ---------------------------------------------------
+void ThermalMonitor::add(uint8_t sensor, int16_t reading)
+{
+  if (sensor >= THERMAL_SENSORS)
+    return;
+
+  if (reading < 0 || count[sensor] == 0)
+  {
+    // The trend starts over - fill the buffer with the reading, so the average and median are right from the first reading
+    for (uint8_t i = 0; i < THERMAL_HISTORY; i++)
+      history[sensor][i] = reading;
+    newest[sensor] = 0;
+    count[sensor] = (reading < 0) ? 0 : 1;
+    steep[sensor] = 0;
+    return;
+  }
+
+  newest[sensor] = (newest[sensor] + 1) % THERMAL_HISTORY;
+  history[sensor][newest[sensor]] = reading;
+  if (count[sensor] < THERMAL_SETTLE + THERMAL_HISTORY)
+    count[sensor]++;
+
+  if (slope(sensor) <= maxRise)
+    steep[sensor] = 0;
+  else if (steep[sensor] < THERMAL_RISE_COUNT)
+    steep[sensor]++;
+}
+
+// ---------------------------------------------------
+int16_t ThermalMonitor::average(uint8_t sensor)
+{
+  if (sensor >= THERMAL_SENSORS)
+    return 0;
+  if (count[sensor] == 0)
+    return history[sensor][newest[sensor]];
+
+  int32_t sum = 0;
+  for (uint8_t i = 0; i < THERMAL_HISTORY; i++)
+    sum += history[sensor][i];
+  return sum / THERMAL_HISTORY;
+}
+
+// ---------------------------------------------------
+int16_t ThermalMonitor::median(uint8_t sensor)
+{
+  if (sensor >= THERMAL_SENSORS)
+    return 0;
+
+  // Insertion sort of the newest readings - only a few of them
+  int16_t sorted[THERMAL_MEDIAN];
+  for (uint8_t i = 0; i < THERMAL_MEDIAN; i++)
+  {
+    int16_t r = reading(sensor, i);
+    uint8_t j = i;
+    for (; j > 0 && sorted[j - 1] > r; j--)
+      sorted[j] = sorted[j - 1];
+    sorted[j] = r;
+  }
+  return sorted[THERMAL_MEDIAN / 2];
+}
+
+// ---------------------------------------------------
+int16_t ThermalMonitor::slope(uint8_t sensor)
+{
+  if (sensor >= THERMAL_SENSORS || count[sensor] < THERMAL_SETTLE + THERMAL_HISTORY)
+    return 0;
+
+  // The difference between the averages of the newest and the oldest half of the readings, which are THERMAL_HISTORY / 2 intervals apart
+  int32_t rise = 0;
+  for (uint8_t i = 0; i < THERMAL_HISTORY / 2; i++)
+    rise += reading(sensor, i) - reading(sensor, i + THERMAL_HISTORY / 2);
+  rise = rise * 60000L / ((int32_t)(THERMAL_HISTORY / 2) * (THERMAL_HISTORY / 2) * interval);
+  return constrain(rise, -32767L, 32767L);
+}
+
+// ---------------------------------------------------
+bool ThermalMonitor::rising(uint8_t sensor)
+{
+  if (sensor >= THERMAL_SENSORS)
+    return false;
+  return steep[sensor] >= THERMAL_RISE_COUNT;
+}
+
+// ---------------------------------------------------
+// Returns the reading added age readings before the latest one
+int16_t ThermalMonitor::reading(uint8_t sensor, uint8_t age)
+{
+  return history[sensor][(newest[sensor] + THERMAL_HISTORY - age) % THERMAL_HISTORY];
+}
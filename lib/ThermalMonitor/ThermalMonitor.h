@@ -0,0 +1,65 @@
+/*
+**
+** Thermal trend monitor for MezmerizeB1Buffer
+**
+** Keeps the latest readings of every temperature sensor in a small ring buffer,
+** so the temperature protection can look at a trend instead of a single
+** reading: the median of the newest readings ignores a single noisy reading,
+** and the slope over the buffer shows a temperature rising too fast long
+** before the limit is reached. A rise only counts once it has lasted for a
+** number of readings in a row, and not while the sensor is settling after it
+** has been turned on. The display shows the average of the buffer.
+** The readings are taken by the caller - a negative reading means that the
+** sensor is off (i.e. the amplifier is turned off) and restarts its trend.
+**
+** Copyright (c) 2020 Carsten Grønning, Jan Abkjer Tofft
+**
+*/
+
+#ifndef ThermalMonitor_h_
+#define ThermalMonitor_h_
+
+#include <Arduino.h>
+
+#define THERMAL_SENSORS 2
+#define THERMAL_HISTORY 8 // Readings kept per sensor - the slope compares the newest half of them with the oldest half
+#define THERMAL_MEDIAN 3  // Newest readings the median is taken of (odd, at most THERMAL_HISTORY)
+#define THERMAL_SETTLE 10 // Readings after the sensor has been turned on that are left out of the slope - the sensor supply is still settling
+#define THERMAL_RISE_COUNT 5 // Readings in a row the slope must be too steep for before rising() reports it
+
+class ThermalMonitor
+{
+  static_assert(THERMAL_HISTORY % 2 == 0, "THERMAL_HISTORY must be even");
+
+  public:
+    ThermalMonitor();
+
+    // Sets the interval (ms) the readings are added with - used to give the slope per minute - and the rise per minute rising() reports. Forgets all readings.
+    void begin(uint16_t interval, int16_t maxRise);
+    // Forgets all readings (i.e. before the amplifiers are turned on).
+    void reset();
+
+    // Adds the latest reading of sensor.
+    void add(uint8_t sensor, int16_t reading);
+
+    // Returns the average of the readings kept - the latest reading if negative.
+    int16_t average(uint8_t sensor);
+    // Returns the median of the THERMAL_MEDIAN newest readings.
+    int16_t median(uint8_t sensor);
+    // Returns the rise of the readings per minute - 0 until THERMAL_SETTLE + THERMAL_HISTORY non-negative readings in a row have been added.
+    int16_t slope(uint8_t sensor);
+    // Returns true if the slope has been above maxRise for THERMAL_RISE_COUNT readings in a row.
+    bool rising(uint8_t sensor);
+
+  private:
+    int16_t history[THERMAL_SENSORS][THERMAL_HISTORY];
+    uint8_t newest[THERMAL_SENSORS]; // Position of the latest reading
+    uint8_t count[THERMAL_SENSORS];  // Non-negative readings in a row (at most THERMAL_SETTLE + THERMAL_HISTORY) - 0 if the latest reading was negative or there are none
+    uint8_t steep[THERMAL_SENSORS];  // Readings in a row with a slope above maxRise (at most THERMAL_RISE_COUNT)
+    uint16_t interval;
+    int16_t maxRise;
+
+    int16_t reading(uint8_t sensor, uint8_t age);
+};
+
+#endif
@@ -40,20 +40,23 @@
  *    care").                                                                  *
  * 4. An EEPROM contains an integral number of pages.                          *
  *                                                                             *
- * To use the extEEPROM library, the Arduino Wire library must also            *
- * be included.                                                                *
+ * The extEEPROM library uses the I2CBus of MezmerizeB1Buffer, which sets      *
+ * the bus clock once - i2cBus.begin() must be called before begin().          *
  *                                                                             *
  * Jack Christensen 23Mar2013 v1                                               *
  * 29Mar2013 v2 - Updated to span page boundaries (and therefore also          *
  * device boundaries, assuming an integral number of pages per device)         *
  * 08Jul2014 v3 - Generalized for 2kb - 2Mb EEPROMs.                           *
+ * Asynchronous writes (writeAsync/poll) added for MezmerizeB1Buffer.          *
+ * Wire replaced by the shared I2CBus for MezmerizeB1Buffer.                   *
  *                                                                             *
  * External EEPROM Library by Jack Christensen is licensed under CC BY-SA 4.0, *
  * http://creativecommons.org/licenses/by-sa/4.0/                              *
  *-----------------------------------------------------------------------------*/
 
 #include <extEEPROM.h>
-#include <Wire.h>
+#include "I2CBus.h"
+#include "Profiler.h"
 
 // Constructor.
 // - deviceCapacity is the capacity of a single EEPROM device in
@@ -72,6 +75,8 @@ extEEPROM::extEEPROM(eeprom_size_t deviceCapacity, byte nDevice, unsigned int pa
     _eepromAddr = eepromAddr;
     _totalCapacity = _nDevice * _dvcCapacity * 1024UL / 8;
     _nAddrBytes = deviceCapacity > kbits_16 ? 2 : 1;       //two address bytes needed for eeproms > 16kbits
+    _asyncBytes = 0;
+    _asyncWaiting = false;
 
     //determine the bitshift needed to isolate the chip select bits from the address to put into the control byte
     uint16_t kb = _dvcCapacity;
@@ -87,25 +92,22 @@ extEEPROM::extEEPROM(eeprom_size_t deviceCapacity, byte nDevice, unsigned int pa
     }
 }
 
-//initialize the I2C bus and do a dummy write (no data sent)
-//to the device so that the caller can determine whether it is responding.
-//when using a 400kHz bus speed and there are multiple I2C devices on the
-//bus (other than EEPROM), call extEEPROM::begin() after any initialization
-//calls for the other devices to ensure the intended I2C clock speed is set.
-byte extEEPROM::begin(twiClockFreq_t twiFreq)
+//do a dummy write (no data sent) to the device so that the caller
+//can determine whether it is responding. the I2C bus (and its clock)
+//is set up once by i2cBus.begin(), which must be called first.
+byte extEEPROM::begin()
 {
-    Wire.begin();
-    TWBR = ( (F_CPU / twiFreq) - 16) / 2;
-    Wire.beginTransmission(_eepromAddr);
-    if (_nAddrBytes == 2) Wire.write(0);      //high addr byte
-    Wire.write(0);                            //low addr byte
-    return Wire.endTransmission();
+    i2cBus.beginTransmission(_eepromAddr);
+    if (_nAddrBytes == 2) i2cBus.write(0);    //high addr byte
+    i2cBus.write(0);                          //low addr byte
+    PROFILE_I2C(_eepromAddr, _nAddrBytes);
+    return i2cBus.endTransmission(true);
 }
 
 //Write bytes to external EEPROM.
 //If the I/O would extend past the top of the EEPROM address space,
 //a status of EEPROM_ADDR_ERR is returned. For I2C errors, the status
-//from the Arduino Wire library is passed back through to the caller.
+//from I2CBus is passed back through to the caller.
 byte extEEPROM::write(unsigned long addr, byte *values, unsigned int nBytes)
 {
     uint8_t ctrlByte;       //control byte (I2C device address & chip/block select bits)
@@ -116,27 +118,30 @@ byte extEEPROM::write(unsigned long addr, byte *values, unsigned int nBytes)
     if (addr + nBytes > _totalCapacity) {   //will this write go past the top of the EEPROM?
         return EEPROM_ADDR_ERR;             //yes, tell the caller
     }
+    finishAsync();
 
     while (nBytes > 0) {
         nPage = _pageSize - ( addr & (_pageSize - 1) );
-        //find min(nBytes, nPage, BUFFER_LENGTH) -- BUFFER_LENGTH is defined in the Wire library.
+        //find min(nBytes, nPage, I2C_BUS_BUFFER) -- I2C_BUS_BUFFER is defined in I2CBus.h.
         nWrite = nBytes < nPage ? nBytes : nPage;
-        nWrite = BUFFER_LENGTH - _nAddrBytes < nWrite ? BUFFER_LENGTH - _nAddrBytes : nWrite;
+        nWrite = I2C_BUS_BUFFER - _nAddrBytes < nWrite ? I2C_BUS_BUFFER - _nAddrBytes : nWrite;
         ctrlByte = _eepromAddr | (byte) (addr >> _csShift);
-        Wire.beginTransmission(ctrlByte);
-        if (_nAddrBytes == 2) Wire.write( (byte) (addr >> 8) );   //high addr byte
-        Wire.write( (byte) addr );                                //low addr byte
-        Wire.write(values, nWrite);
-        txStatus = Wire.endTransmission();
+        i2cBus.beginTransmission(ctrlByte);
+        if (_nAddrBytes == 2) i2cBus.write( (byte) (addr >> 8) );   //high addr byte
+        i2cBus.write( (byte) addr );                                //low addr byte
+        i2cBus.write(values, nWrite);
+        txStatus = i2cBus.endTransmission(true);
+        PROFILE_I2C(ctrlByte, _nAddrBytes + nWrite);
         if (txStatus != 0) return txStatus;
 
         //wait up to 50ms for the write to complete
         for (uint8_t i=100; i; --i) {
             delayMicroseconds(500);                     //no point in waiting too fast
-            Wire.beginTransmission(ctrlByte);
-            if (_nAddrBytes == 2) Wire.write(0);        //high addr byte
-            Wire.write(0);                              //low addr byte
-            txStatus = Wire.endTransmission();
+            i2cBus.beginTransmission(ctrlByte);
+            if (_nAddrBytes == 2) i2cBus.write(0);        //high addr byte
+            i2cBus.write(0);                              //low addr byte
+            txStatus = i2cBus.endTransmission(true);
+            PROFILE_I2C(ctrlByte, _nAddrBytes);
             if (txStatus == 0) break;
         }
         if (txStatus != 0) return txStatus;
@@ -151,7 +156,7 @@ byte extEEPROM::write(unsigned long addr, byte *values, unsigned int nBytes)
 //Read bytes from external EEPROM.
 //If the I/O would extend past the top of the EEPROM address space,
 //a status of EEPROM_ADDR_ERR is returned. For I2C errors, the status
-//from the Arduino Wire library is passed back through to the caller.
+//from I2CBus is passed back through to the caller.
 byte extEEPROM::read(unsigned long addr, byte *values, unsigned int nBytes)
 {
     byte ctrlByte;
@@ -162,20 +167,23 @@ byte extEEPROM::read(unsigned long addr, byte *values, unsigned int nBytes)
     if (addr + nBytes > _totalCapacity) {   //will this read take us past the top of the EEPROM?
         return EEPROM_ADDR_ERR;             //yes, tell the caller
     }
+    finishAsync();
 
     while (nBytes > 0) {
         nPage = _pageSize - ( addr & (_pageSize - 1) );
         nRead = nBytes < nPage ? nBytes : nPage;
-        nRead = BUFFER_LENGTH < nRead ? BUFFER_LENGTH : nRead;
+        nRead = I2C_BUS_BUFFER < nRead ? I2C_BUS_BUFFER : nRead;
         ctrlByte = _eepromAddr | (byte) (addr >> _csShift);
-        Wire.beginTransmission(ctrlByte);
-        if (_nAddrBytes == 2) Wire.write( (byte) (addr >> 8) );   //high addr byte
-        Wire.write( (byte) addr );                                //low addr byte
-        rxStatus = Wire.endTransmission();
+        i2cBus.beginTransmission(ctrlByte);
+        if (_nAddrBytes == 2) i2cBus.write( (byte) (addr >> 8) );   //high addr byte
+        i2cBus.write( (byte) addr );                                //low addr byte
+        rxStatus = i2cBus.endTransmission(true);
+        PROFILE_I2C(ctrlByte, _nAddrBytes);
         if (rxStatus != 0) return rxStatus;        //read error
 
-        Wire.requestFrom(ctrlByte, nRead);
-        for (byte i=0; i<nRead; i++) values[i] = Wire.read();
+        if (i2cBus.requestFrom(ctrlByte, values, nRead) != nRead) rxStatus = I2C_ERROR;
+        PROFILE_I2C(ctrlByte, nRead);
+        if (rxStatus != 0) return rxStatus;
 
         addr += nRead;          //increment the EEPROM address
         values += nRead;        //increment the input data pointer
@@ -187,7 +195,7 @@ byte extEEPROM::read(unsigned long addr, byte *values, unsigned int nBytes)
 //Write a single byte to external EEPROM.
 //If the I/O would extend past the top of the EEPROM address space,
 //a status of EEPROM_ADDR_ERR is returned. For I2C errors, the status
-//from the Arduino Wire library is passed back through to the caller.
+//from I2CBus is passed back through to the caller.
 byte extEEPROM::write(unsigned long addr, byte value)
 {
     return write(addr, &value, 1);
@@ -196,7 +204,7 @@ byte extEEPROM::write(unsigned long addr, byte value)
 //Read a single byte from external EEPROM.
 //If the I/O would extend past the top of the EEPROM address space,
 //a status of EEPROM_ADDR_ERR is returned. For I2C errors, the status
-//from the Arduino Wire library is passed back through to the caller.
+//from I2CBus is passed back through to the caller.
 //To distinguish error values from valid data, error values are returned as negative numbers.
 int extEEPROM::read(unsigned long addr)
 {
@@ -206,3 +214,83 @@ int extEEPROM::read(unsigned long addr)
     ret = read(addr, &data, 1);
     return ret == 0 ? data : -ret;
 }
+
+//Start writing bytes to external EEPROM without waiting for the write
+//cycles to complete. The first page is sent right away, the remaining
+//pages are sent by poll() as the EEPROM acknowledges the previous one.
+//values must stay unchanged until poll() no longer returns EEPROM_BUSY.
+//An asynchronous write already in progress is completed first.
+//Returns EEPROM_ADDR_ERR or the status of I2CBus like write().
+byte extEEPROM::writeAsync(unsigned long addr, byte *values, unsigned int nBytes)
+{
+    if (addr + nBytes > _totalCapacity) {   //will this write go past the top of the EEPROM?
+        return EEPROM_ADDR_ERR;             //yes, tell the caller
+    }
+    finishAsync();
+
+    _asyncAddr = addr;
+    _asyncValues = values;
+    _asyncBytes = nBytes;
+    return writeNextPage();
+}
+
+//Move an asynchronous write forward. Checks (with a single dummy write)
+//if the EEPROM has completed the page sent last, and if so sends the
+//next page. Returns EEPROM_BUSY while the write is in progress, 0 when
+//it is complete or the status from I2CBus if it failed.
+byte extEEPROM::poll()
+{
+    if (!_asyncWaiting) return 0;
+
+    i2cBus.beginTransmission(_asyncCtrlByte);
+    if (_nAddrBytes == 2) i2cBus.write(0);        //high addr byte
+    i2cBus.write(0);                              //low addr byte
+    uint8_t txStatus = i2cBus.endTransmission(true);
+    PROFILE_I2C(_asyncCtrlByte, _nAddrBytes);
+    if (txStatus != 0) {
+        //give up after 50ms, like write()
+        if (millis() - _asyncStart < 50) return EEPROM_BUSY;
+        _asyncWaiting = false;
+        _asyncBytes = 0;
+        return txStatus;
+    }
+
+    _asyncWaiting = false;
+    if (_asyncBytes == 0) return 0;
+    txStatus = writeNextPage();
+    return txStatus == 0 ? EEPROM_BUSY : txStatus;
+}
+
+//Send the next page of an asynchronous write.
+byte extEEPROM::writeNextPage()
+{
+    uint16_t nPage = _pageSize - ( _asyncAddr & (_pageSize - 1) );
+    uint16_t nWrite = _asyncBytes < nPage ? _asyncBytes : nPage;
+    nWrite = I2C_BUS_BUFFER - _nAddrBytes < nWrite ? I2C_BUS_BUFFER - _nAddrBytes : nWrite;
+    _asyncCtrlByte = _eepromAddr | (byte) (_asyncAddr >> _csShift);
+    i2cBus.beginTransmission(_asyncCtrlByte);
+    if (_nAddrBytes == 2) i2cBus.write( (byte) (_asyncAddr >> 8) );   //high addr byte
+    i2cBus.write( (byte) _asyncAddr );                                //low addr byte
+    i2cBus.write(_asyncValues, nWrite);
+    uint8_t txStatus = i2cBus.endTransmission(true);
+    PROFILE_I2C(_asyncCtrlByte, _nAddrBytes + nWrite);
+    if (txStatus != 0) {
+        _asyncBytes = 0;
+        return txStatus;
+    }
+
+    _asyncAddr += nWrite;
+    _asyncValues += nWrite;
+    _asyncBytes -= nWrite;
+    _asyncStart = millis();
+    _asyncWaiting = true;
+    return 0;
+}
+
+//Wait for an asynchronous write in progress to complete.
+byte extEEPROM::finishAsync()
+{
+    uint8_t status;
+    while ((status = poll()) == EEPROM_BUSY) delayMicroseconds(500);
+    return status;
+}
@@ -40,13 +40,15 @@
  *    care").                                                                  *
  * 4. An EEPROM contains an integral number of pages.                          *
  *                                                                             *
- * To use the extEEPROM library, the Arduino Wire library must also            *
- * be included.                                                                *
+ * The extEEPROM library uses the I2CBus of MezmerizeB1Buffer, which sets      *
+ * the bus clock once - i2cBus.begin() must be called before begin().          *
  *                                                                             *
  * Jack Christensen 23Mar2013 v1                                               *
  * 29Mar2013 v2 - Updated to span page boundaries (and therefore also          *
  * device boundaries, assuming an integral number of pages per device)         *
  * 08Jul2014 v3 - Generalized for 2kb - 2Mb EEPROMs.                           *
+ * Asynchronous writes (writeAsync/poll) added for MezmerizeB1Buffer.          *
+ * Wire replaced by the shared I2CBus for MezmerizeB1Buffer.                   *
  *                                                                             *
  * External EEPROM Library by Jack Christensen is licensed under CC BY-SA 4.0, *
  * http://creativecommons.org/licenses/by-sa/4.0/                              *
@@ -74,18 +76,21 @@ enum eeprom_size_t {
 
 //EEPROM addressing error, returned by write() or read() if upper address bound is exceeded
 const uint8_t EEPROM_ADDR_ERR = 9;
+const uint8_t EEPROM_BUSY = 10;         //returned by poll() while an asynchronous write is in progress
 
 class extEEPROM
 {
     public:
-        //I2C clock frequencies
-        enum twiClockFreq_t { twiClock100kHz = 100000, twiClock400kHz = 400000 };
         extEEPROM(eeprom_size_t deviceCapacity, byte nDevice, unsigned int pageSize, byte eepromAddr = 0x50);
-        byte begin(twiClockFreq_t twiFreq = twiClock100kHz);
+        byte begin();
         byte write(unsigned long addr, byte *values, unsigned int nBytes);
         byte write(unsigned long addr, byte value);
         byte read(unsigned long addr, byte *values, unsigned int nBytes);
         int read(unsigned long addr);
+        byte writeAsync(unsigned long addr, byte *values, unsigned int nBytes);
+        byte poll();
+        byte finishAsync();
+        bool busy() { return _asyncWaiting; }
 
     private:
         uint8_t _eepromAddr;            //eeprom i2c address
@@ -95,6 +100,14 @@ class extEEPROM
         uint8_t _csShift;               //number of bits to shift address for chip select bits in control byte
         uint16_t _nAddrBytes;           //number of address bytes (1 or 2)
         unsigned long _totalCapacity;   //capacity of all EEPROM devices on the bus, in bytes
+
+        byte writeNextPage();
+        unsigned long _asyncAddr;       //next address of an asynchronous write
+        byte *_asyncValues;             //data not yet sent by an asynchronous write
+        uint16_t _asyncBytes;           //number of bytes not yet sent
+        uint8_t _asyncCtrlByte;         //control byte of the page being written
+        unsigned long _asyncStart;      //millis() when the page was sent
+        bool _asyncWaiting;             //a page has been sent and the EEPROM has not acknowledged since
 };
 
 #endif
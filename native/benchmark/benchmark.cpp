@@ -0,0 +1,319 @@
+/*
+**
+** Benchmarks of the native build for MezmerizeB1Buffer
+**
+** The firmware (src/main.cpp and the libraries) runs against the simulated
+** hardware of native/mock and is driven like a user would: by turning and
+** clicking the rotary encoders and by the serial protocol. For each scenario
+** the virtual time it takes and the transactions and bytes sent to each bus
+** device are reported, so changes of the I/O cost show up as numbers.
+**
+**   pio run -e native && .pio/build/native/program
+**
+** Copyright (c) 2020 Carsten Grønning, Jan Abkjer Tofft
+**
+*/
+
+#include <Arduino.h>
+#include "MockHardware.h"
+#include "Muses72320Group.h"
+#include "extEEPROM.h"
+
+void setup();
+void loop();
+
+extern byte appMode;
+extern Muses72320Group muses;
+extern extEEPROM eeprom;
+extern byte pendingInput;
+
+// Values of AppModeValues in main.cpp
+#define APP_NORMAL_MODE 0
+#define APP_MENU_MODE 1
+#define APP_STANDBY_MODE 3
+#define APP_POWERLOSS_STATE 4
+
+// Serial protocol (see main.cpp and SerialProtocol.h)
+#define SERIAL_CMD_SET_VOLUME 0x02
+#define SERIAL_CMD_SET_INPUT 0x03
+#define SERIAL_CMD_SET_MUTE 0x04
+#define SERIAL_CMD_SET_POWER 0x05
+#define SERIAL_EVT_ACK 0x80
+#define SERIAL_EVT_STATE 0x81
+
+// Encoder pins (A, B and button) - see the ClickEncoder instances in main.cpp
+#define ENCODER1_A 8
+#define ENCODER1_B 7
+#define ENCODER1_BUTTON 6
+#define ENCODER2_A 5
+#define ENCODER2_B 4
+#define ENCODER2_BUTTON 3
+
+// Bandgap conversion results giving Vcc = 4.9V and Vcc = 4.4V (inside the power loss window)
+#define VCC_NORMAL 230
+#define VCC_BROWNOUT 256
+
+#define TIMEOUT 30000 // ms - the startup waits for the trigger delays
+
+struct HostState
+{
+  uint8_t power;
+  uint8_t input;
+  uint8_t volume;
+  uint8_t muted;
+};
+
+HostState hostState;
+int16_t lastAck = -1; // Command of the last SERIAL_EVT_ACK received
+
+// ---------------------------------------------------
+static uint8_t crc8(const uint8_t *data, uint8_t length)
+{
+  uint8_t crc = 0xFF;
+  while (length--)
+  {
+    crc ^= *data++;
+    for (uint8_t i = 0; i < 8; i++)
+      crc = (crc & 0x80) ? (crc << 1) ^ 0x31 : crc << 1;
+  }
+  return crc;
+}
+
+// Parse the frames sent by the firmware
+static void receiveFrames()
+{
+  static uint8_t frame[16];
+  static uint8_t received = 0;
+  uint8_t data;
+
+  while (mockSerialOutput(&data, 1))
+  {
+    if (received == 0 && data != 0xA5)
+      continue;
+    frame[received++] = data;
+    if (received >= 2 && (frame[1] > 8 || received == frame[1] + 4))
+    {
+      if (frame[1] <= 8 && crc8(frame + 1, frame[1] + 2) == frame[received - 1])
+      {
+        if (frame[2] == SERIAL_EVT_ACK)
+          lastAck = frame[3];
+        else if (frame[2] == SERIAL_EVT_STATE)
+          memcpy(&hostState, frame + 3, sizeof(hostState));
+      }
+      received = 0;
+    }
+  }
+}
+
+static void sendFrame(uint8_t command, const uint8_t *payload, uint8_t length)
+{
+  uint8_t frame[12] = {0xA5, length, command};
+  memcpy(frame + 3, payload, length);
+  frame[length + 3] = crc8(frame + 1, length + 2);
+  mockSerialInput(frame, length + 4);
+}
+
+// Run loop() for ms of virtual time
+static void run(unsigned long ms)
+{
+  unsigned long end = millis() + ms;
+  while ((long)(millis() - end) < 0)
+  {
+    loop();
+    receiveFrames();
+    mockAdvanceMicros(50);
+  }
+}
+
+// Run loop() until done() returns true or TIMEOUT. Returns false if timed out
+static bool runUntil(bool (*done)())
+{
+  unsigned long start = millis();
+  while (!done())
+  {
+    if (millis() - start > TIMEOUT)
+      return false;
+    loop();
+    receiveFrames();
+    mockAdvanceMicros(50);
+  }
+  return true;
+}
+
+// Send a command and run until it is acknowledged
+static bool command(uint8_t cmd, uint8_t value)
+{
+  lastAck = -1;
+  sendFrame(cmd, &value, 1);
+  unsigned long start = millis();
+  while (lastAck != cmd)
+  {
+    if (millis() - start > TIMEOUT)
+      return false;
+    run(1);
+  }
+  return true;
+}
+
+// Turn an encoder the given number of detents (positive is clockwise) - a detent is four steps of the quadrature signal 2 ms apart
+static void turn(uint8_t pinA, uint8_t pinB, int16_t detents)
+{
+  static const uint8_t phases[4][2] = {{1, 1}, {0, 1}, {0, 0}, {1, 0}};
+  uint8_t phase = 0;
+
+  for (int16_t step = 0; step < 4 * abs(detents); step++)
+  {
+    phase = (phase + (detents > 0 ? 3 : 1)) & 3;
+    mockSetPin(pinA, phases[phase][0]);
+    mockSetPin(pinB, phases[phase][1]);
+    run(2);
+  }
+}
+
+// Click an encoder button and wait until a double click is no longer possible
+static void click(uint8_t pin)
+{
+  mockSetPin(pin, LOW);
+  run(60);
+  mockSetPin(pin, HIGH);
+  run(700);
+}
+
+// ---------------------------------------------------
+unsigned long scenarioStart;
+
+static void startScenario()
+{
+  receiveFrames();
+  mockResetCounters();
+  scenarioStart = mockMicros();
+}
+
+static void report(const char *name, bool ok)
+{
+  MockBusCounters oled = mockI2CCounters(MOCK_OLED_ADDRESS);
+  MockBusCounters mcp = mockI2CCounters(MOCK_MCP23008_ADDRESS);
+  MockBusCounters eeprom = mockI2CCounters(MOCK_EEPROM_ADDRESS);
+  MockBusCounters spi = mockSPICounters();
+
+  printf("%-20s %9.1f %7u %7u %6u %6u %7u %7u %6u %6u%s\n", name, (mockMicros() - scenarioStart) / 1000.0,
+         oled.transactions, oled.bytes, mcp.transactions, mcp.bytes, eeprom.transactions, eeprom.bytes,
+         spi.transactions, spi.bytes, ok ? "" : "  TIMEOUT");
+}
+
+static bool soundOn()
+{
+  return appMode == APP_NORMAL_MODE && !hostState.muted && !muses.isRamping();
+}
+
+// The relays have been switched to the input selected and the volume has ramped up again (INPUT_NONE in main.cpp)
+static bool inputSwitched()
+{
+  return pendingInput == 0xFF && !muses.isRamping();
+}
+
+static bool powerLossSaved()
+{
+  return appMode == APP_POWERLOSS_STATE && !eeprom.busy();
+}
+
+// Boot with an empty EEPROM (the default settings are written) until the volume has ramped up
+static void bootToFirstSound()
+{
+  startScenario();
+  setup();
+  report("boot to first sound", runUntil(soundOn));
+}
+
+// Boot again with the settings saved by the previous scenarios until the volume has ramped up
+static void rebootToFirstSound()
+{
+  startScenario();
+  setup();
+  report("boot with settings", runUntil(soundOn));
+}
+
+// Wake up from standby until the volume has ramped up
+static void wakeToFirstSound()
+{
+  command(SERIAL_CMD_SET_POWER, 0);
+  run(4000);
+  startScenario();
+  bool ok = command(SERIAL_CMD_SET_POWER, 1) && runUntil(soundOn);
+  report("wake to first sound", ok);
+}
+
+// Turn the volume encoder one detent at a time from volume 0 until the volume stops increasing
+static void volumeSweep()
+{
+  command(SERIAL_CMD_SET_MUTE, 0);
+  command(SERIAL_CMD_SET_VOLUME, 0);
+  run(100);
+  startScenario();
+  int8_t unchanged = 0;
+  while (unchanged < 3)
+  {
+    uint8_t volume = hostState.volume;
+    turn(ENCODER1_A, ENCODER1_B, 1);
+    run(10);
+    unchanged = (hostState.volume == volume) ? unchanged + 1 : 0;
+  }
+  report("volume sweep 0-max", hostState.volume > 0);
+}
+
+// Select each of the six inputs in turn
+static void cycleInputs()
+{
+  startScenario();
+  bool ok = true;
+  for (uint8_t i = 1; i <= 6; i++)
+    ok = command(SERIAL_CMD_SET_INPUT, i % 6) && runUntil(inputSwitched) && ok;
+  report("cycle inputs", ok);
+}
+
+// Open the menu, go to the IR menu and scroll through its items
+static void scrollIRMenu()
+{
+  click(ENCODER2_BUTTON); // KEY_BACK: open the menu
+  turn(ENCODER2_A, ENCODER2_B, 2);
+  run(20);
+  click(ENCODER1_BUTTON); // KEY_SELECT: enter the IR menu
+  startScenario();
+  turn(ENCODER2_A, ENCODER2_B, 18);
+  run(10);
+  report("scroll IR menu", appMode == APP_MENU_MODE);
+  click(ENCODER2_BUTTON);
+  click(ENCODER2_BUTTON);
+}
+
+// Let Vcc drop into the power loss window until the RuntimeSettings have been saved
+static void brownoutSave()
+{
+  run(6000); // Let the RuntimeSettings checkpoint of the previous scenarios be written
+  startScenario();
+  mockSetAnalog(14, VCC_BROWNOUT);
+  report("brownout save", runUntil(powerLossSaved));
+  mockSetAnalog(14, VCC_NORMAL);
+  run(3000);
+}
+
+int main()
+{
+  setvbuf(stdout, 0, _IONBF, 0);
+  mockSetAnalog(14, VCC_NORMAL);
+  mockSetAnalog(0, 600); // Temperature sensors
+  mockSetAnalog(1, 600);
+  for (uint8_t pin = ENCODER2_BUTTON; pin <= ENCODER1_A; pin++)
+    mockSetPin(pin, HIGH); // The encoders are active low
+
+  printf("%-20s %9s %7s %7s %6s %6s %7s %7s %6s %6s\n", "scenario", "ms", "OLED tx", "bytes", "MCP tx", "bytes",
+         "EEP tx", "bytes", "SPI tx", "bytes");
+  bootToFirstSound();
+  volumeSweep();
+  cycleInputs();
+  scrollIRMenu();
+  wakeToFirstSound();
+  brownoutSave();
+  rebootToFirstSound();
+  return 0;
+}
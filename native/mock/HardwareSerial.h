@@ -0,0 +1,21 @@
+#pragma once
+
+#include "Stream.h"
+
+// Host serial port: output is captured, input is fed by the test harness
+class HardwareSerial : public Stream
+{
+public:
+  void begin(unsigned long) {}
+  void end() {}
+  int available(void);
+  int read(void);
+  int peek(void);
+  int availableForWrite(void) { return 63; }
+  void flush(void) {}
+  size_t write(uint8_t c);
+  using Print::write;
+  operator bool() { return true; }
+};
+
+extern HardwareSerial Serial;
@@ -0,0 +1,630 @@
+/*
+** Simulated hardware for the native build - see MockHardware.h
+*/
+#include <deque>
+#include <map>
+
+#include "Arduino.h"
+#include "util/twi.h"
+#include "SPI.h"
+#include "TimerOne.h"
+#include "avr/sleep.h"
+#include "MockHardware.h"
+
+MockOLed mockOLed;
+MockMCP23008 mockMCP23008;
+Mock24C64 mockEEPROM;
+
+SPIClass SPI;
+TimerOne Timer1;
+HardwareSerial Serial;
+
+static unsigned long nowMicros = 0;
+// The global interrupt flag is bit 7 of SREG, so code saving and restoring SREG works as on the AVR
+#define interruptsEnabled (SREG & 0x80)
+static struct EnableInterrupts { EnableInterrupts() { SREG |= 0x80; } } enableInterrupts;
+// Interrupt routines run with interrupts disabled, like on the AVR
+#define RUN_ISR(f) do { uint8_t savedSREG = SREG; SREG &= ~0x80; f(); SREG = savedSREG; } while (0)
+
+static void (*timer1Isr)() = 0;
+static unsigned long timer1Period = 1000;
+static unsigned long timer1Next = 0;
+static bool timer1Running = false;
+
+static void (*externalIsr[2])() = {0, 0};
+
+static uint8_t pinLevel[22];
+static uint16_t analogValue[16];
+
+static std::map<uint8_t, MockBusCounters> i2cCounters;
+static MockBusCounters spiCounters = {0, 0};
+static std::deque<uint8_t> serialIn;
+static std::deque<uint8_t> serialOut;
+
+extern "C" void ADC_vect(void) __attribute__((weak));
+extern "C" void PCINT0_vect(void) __attribute__((weak));
+extern "C" void PCINT1_vect(void) __attribute__((weak));
+extern "C" void PCINT2_vect(void) __attribute__((weak));
+extern "C" void TWI_vect(void) __attribute__((weak));
+
+static void runTwi();
+static bool twiStepPending(unsigned long *due);
+
+// --- Virtual clock ---------------------------------------------------------
+
+static void runAdc()
+{
+  // A conversion completes every 104 us with the default prescaler
+  if ((ADCSRA & _BV(ADEN)) && (ADCSRA & _BV(ADSC)))
+  {
+    ADC = analogValue[ADMUX & 0x0F];
+    ADCL = ADC & 0xFF;
+    ADCH = ADC >> 8;
+    if (!(ADCSRA & _BV(ADATE)))
+      ADCSRA &= ~_BV(ADSC);
+    ADCSRA |= _BV(ADIF);
+    if ((ADCSRA & _BV(ADIE)) && interruptsEnabled && ADC_vect)
+    {
+      ADCSRA &= ~_BV(ADIF);
+      RUN_ISR(ADC_vect);
+    }
+  }
+}
+
+void mockAdvanceMicros(unsigned long us)
+{
+  unsigned long end = nowMicros + us;
+  while ((long)(end - nowMicros) > 0)
+  {
+    unsigned long step = end - nowMicros;
+    unsigned long twiDue;
+    if (step > 104)
+      step = 104;
+    // A TWI step completes at its exact time, so the byte rate of the bus is kept
+    if (twiStepPending(&twiDue) && (long)(twiDue - nowMicros) < (long)step)
+      step = (long)(twiDue - nowMicros) > 0 ? twiDue - nowMicros : 1;
+    nowMicros += step;
+    runAdc();
+    runTwi();
+    while (timer1Running && timer1Isr && (long)(nowMicros - timer1Next) >= 0)
+    {
+      timer1Next += timer1Period;
+      if (interruptsEnabled)
+        RUN_ISR(timer1Isr);
+    }
+  }
+}
+
+void mockAdvanceMillis(unsigned long ms) { mockAdvanceMicros(ms * 1000UL); }
+unsigned long mockMicros(void) { return nowMicros; }
+
+unsigned long millis(void) { return nowMicros / 1000UL; }
+unsigned long micros(void) { return nowMicros; }
+void delay(unsigned long ms) { mockAdvanceMillis(ms); }
+void delayMicroseconds(unsigned int us) { mockAdvanceMicros(us); }
+// Busy waits of the firmware call yield() - on the host it lets virtual time pass, so the interrupts can run
+void yield(void) { mockAdvanceMicros(1); }
+
+void cli(void)
+{
+  SREG &= ~0x80;
+}
+
+void sei(void)
+{
+  SREG |= 0x80;
+}
+
+long map(long x, long in_min, long in_max, long out_min, long out_max)
+{
+  return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
+
+// --- Pins ------------------------------------------------------------------
+
+static void updatePortRegisters()
+{
+  uint8_t d = 0, b = 0, c = 0;
+  for (uint8_t pin = 0; pin < 8; pin++)
+    if (pinLevel[pin])
+      d |= _BV(pin);
+  for (uint8_t pin = 8; pin < 14; pin++)
+    if (pinLevel[pin])
+      b |= _BV(pin - 8);
+  for (uint8_t pin = 14; pin < 20; pin++)
+    if (pinLevel[pin])
+      c |= _BV(pin - 14);
+  PIND = d;
+  PINB = b;
+  PINC = c;
+}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+  if (pin < sizeof(pinLevel) && mode == INPUT_PULLUP)
+  {
+    pinLevel[pin] = HIGH;
+    updatePortRegisters();
+  }
+}
+
+void digitalWrite(uint8_t pin, uint8_t val)
+{
+  if (pin < sizeof(pinLevel))
+  {
+    pinLevel[pin] = val;
+    updatePortRegisters();
+  }
+}
+
+int digitalRead(uint8_t pin) { return pin < sizeof(pinLevel) ? pinLevel[pin] : LOW; }
+
+int analogRead(uint8_t pin)
+{
+  if (pin >= A0)
+    pin -= A0;
+  return analogValue[pin & 0x0F];
+}
+
+// Run the pin change interrupt of pin if it is enabled - like on the AVR the interrupt is shared by all the pins of a port
+static void pinChanged(uint8_t pin)
+{
+  void (*isr)(void);
+  uint8_t mask;
+  uint8_t enable;
+
+  if (pin < 8)
+  {
+    isr = PCINT2_vect;
+    mask = PCMSK2 & _BV(pin);
+    enable = PCICR & _BV(PCIE2);
+  }
+  else if (pin < 14)
+  {
+    isr = PCINT0_vect;
+    mask = PCMSK0 & _BV(pin - 8);
+    enable = PCICR & _BV(PCIE0);
+  }
+  else
+  {
+    isr = PCINT1_vect;
+    mask = PCMSK1 & _BV(pin - 14);
+    enable = PCICR & _BV(PCIE1);
+  }
+  if (isr && mask && enable && interruptsEnabled)
+    RUN_ISR(isr);
+}
+
+void mockSetPin(uint8_t pin, uint8_t level)
+{
+  if (pin < sizeof(pinLevel) && pinLevel[pin] != level)
+  {
+    pinLevel[pin] = level;
+    updatePortRegisters();
+    pinChanged(pin);
+  }
+}
+
+void mockSetAnalog(uint8_t channel, uint16_t value)
+{
+  analogValue[channel & 0x0F] = value;
+}
+
+void attachInterrupt(uint8_t interruptNum, void (*userFunc)(void), int)
+{
+  if (interruptNum < 2)
+    externalIsr[interruptNum] = userFunc;
+}
+
+void detachInterrupt(uint8_t interruptNum)
+{
+  if (interruptNum < 2)
+    externalIsr[interruptNum] = 0;
+}
+
+void mockTriggerInterrupt(uint8_t interruptNum)
+{
+  if (interruptNum < 2 && externalIsr[interruptNum] && interruptsEnabled)
+    RUN_ISR(externalIsr[interruptNum]);
+}
+
+// --- Sleep -----------------------------------------------------------------
+
+static bool sleepEnabled = false;
+static uint32_t sleeps = 0;
+
+void set_sleep_mode(uint8_t) {}
+void sleep_enable(void) { sleepEnabled = true; }
+void sleep_disable(void) { sleepEnabled = false; }
+void sleep_bod_disable(void) {}
+void sleep_cpu(void)
+{
+  if (sleepEnabled)
+    sleeps++;
+}
+
+uint32_t mockSleepCount(void) { return sleeps; }
+
+// --- Timer1 ----------------------------------------------------------------
+
+void TimerOne::initialize(unsigned long microseconds) { setPeriod(microseconds); }
+void TimerOne::setPeriod(unsigned long microseconds) { timer1Period = microseconds ? microseconds : 1; }
+void TimerOne::start()
+{
+  timer1Next = nowMicros + timer1Period;
+  timer1Running = true;
+}
+void TimerOne::stop() { timer1Running = false; }
+void TimerOne::restart() { start(); }
+void TimerOne::resume() { timer1Running = true; }
+void TimerOne::attachInterrupt(void (*isr)())
+{
+  timer1Isr = isr;
+  start();
+}
+void TimerOne::attachInterrupt(void (*isr)(), unsigned long microseconds)
+{
+  setPeriod(microseconds);
+  attachInterrupt(isr);
+}
+void TimerOne::detachInterrupt() { timer1Isr = 0; }
+
+// --- Serial ----------------------------------------------------------------
+
+int HardwareSerial::available(void) { return serialIn.size(); }
+
+int HardwareSerial::read(void)
+{
+  if (serialIn.empty())
+    return -1;
+  uint8_t c = serialIn.front();
+  serialIn.pop_front();
+  return c;
+}
+
+int HardwareSerial::peek(void) { return serialIn.empty() ? -1 : serialIn.front(); }
+
+size_t HardwareSerial::write(uint8_t c)
+{
+  serialOut.push_back(c);
+  return 1;
+}
+
+void mockSerialInput(const uint8_t *data, size_t length)
+{
+  while (length--)
+    serialIn.push_back(*data++);
+}
+
+size_t mockSerialOutput(uint8_t *data, size_t max)
+{
+  size_t n = 0;
+  while (n < max && !serialOut.empty())
+  {
+    data[n++] = serialOut.front();
+    serialOut.pop_front();
+  }
+  return n;
+}
+
+size_t Print::print(const String &s) { return write(s.c_str()); }
+
+// --- SPI -------------------------------------------------------------------
+
+void SPIClass::beginTransaction(SPISettings) { spiCounters.transactions++; }
+void SPIClass::endTransaction(void) {}
+uint8_t SPIClass::transfer(uint8_t)
+{
+  spiCounters.bytes++;
+  // A byte takes 8 clock periods; the exact rate is irrelevant for the models
+  return 0;
+}
+
+// --- I2C -------------------------------------------------------------------
+
+static MockI2CDevice *deviceAt(uint8_t address)
+{
+  switch (address)
+  {
+  case MOCK_OLED_ADDRESS:
+    return &mockOLed;
+  case MOCK_MCP23008_ADDRESS:
+    return &mockMCP23008;
+  case MOCK_EEPROM_ADDRESS:
+    return &mockEEPROM;
+  }
+  return 0;
+}
+
+// The TWI is simulated on the register level: a write of TWCR with TWINT set starts the next step of the transaction (START, address, data byte or STOP)
+// and clears TWINT. The step completes after its time on the wire at 400 kHz - then TWSR holds the status, TWINT is set and TWI_vect runs if TWIE is set
+#define TWI_START_US 3
+#define TWI_BYTE_US 22 // 9 clocks at 400 kHz
+
+static struct
+{
+  bool pending; // A step is on the wire
+  unsigned long due;
+  uint8_t status; // TWSR when the step is done
+  uint8_t received;
+  bool active; // Between START and STOP
+  bool addressNext;
+  uint8_t address; // Address and R/W bit
+  MockI2CDevice *device;
+  uint8_t data[256];
+  size_t length;
+} twi;
+
+static void twiStep(uint8_t status, unsigned long us)
+{
+  twi.pending = true;
+  twi.status = status;
+  twi.due = nowMicros + us;
+}
+
+static bool twiStepPending(unsigned long *due)
+{
+  *due = twi.due;
+  return twi.pending;
+}
+
+// A transaction ends at a STOP or a repeated START - the data written is delivered to the device
+static void twiEndTransaction()
+{
+  if (!twi.active)
+    return;
+  MockBusCounters &c = i2cCounters[twi.address >> 1];
+  c.transactions++;
+  c.bytes += twi.length;
+  if (!(twi.address & TW_READ) && twi.device)
+    twi.device->onWrite(twi.data, twi.length);
+  twi.active = false;
+}
+
+MockTWCR &MockTWCR::operator=(uint8_t v)
+{
+  // Like on the AVR, writing 1 to TWINT clears the flag and writing 0 leaves it
+  bool go = v & _BV(TWINT);
+  value = go ? (v & ~_BV(TWINT)) : ((v & ~_BV(TWINT)) | (value & _BV(TWINT)));
+  if (!(v & _BV(TWEN)))
+  {
+    twi.pending = false;
+    twi.active = false;
+    return *this;
+  }
+  if (!go)
+    return *this;
+
+  if (v & _BV(TWSTO))
+  {
+    twiEndTransaction();
+    value &= ~_BV(TWSTO);
+    if (!(v & _BV(TWSTA)))
+      return *this;
+  }
+  if (v & _BV(TWSTA))
+  {
+    uint8_t status = twi.active ? TW_REP_START : TW_START;
+    twiEndTransaction();
+    twi.active = true;
+    twi.addressNext = true;
+    twi.length = 0;
+    twiStep(status, TWI_START_US);
+  }
+  else if (twi.addressNext)
+  {
+    twi.addressNext = false;
+    twi.address = TWDR;
+    twi.device = deviceAt(twi.address >> 1);
+    bool read = twi.address & TW_READ;
+    bool ack = twi.device && twi.device->onAddress(read);
+    if (!ack)
+      twi.device = 0;
+    if (read)
+      twiStep(ack ? TW_MR_SLA_ACK : TW_MR_SLA_NACK, TWI_BYTE_US);
+    else
+      twiStep(ack ? TW_MT_SLA_ACK : TW_MT_SLA_NACK, TWI_BYTE_US);
+  }
+  else if (!(twi.address & TW_READ))
+  {
+    if (twi.length < sizeof(twi.data))
+      twi.data[twi.length++] = TWDR;
+    twiStep(TW_MT_DATA_ACK, TWI_BYTE_US);
+  }
+  else
+  {
+    uint8_t b = 0xFF;
+    if (twi.device && twi.device->onRead(&b, 1) != 1)
+      b = 0xFF;
+    twi.length++;
+    twi.received = b;
+    twiStep((v & _BV(TWEA)) ? TW_MR_DATA_ACK : TW_MR_DATA_NACK, TWI_BYTE_US);
+  }
+  return *this;
+}
+
+static void runTwi()
+{
+  if (twi.pending && (long)(nowMicros - twi.due) >= 0)
+  {
+    twi.pending = false;
+    TWSR = (TWSR & ~TW_STATUS_MASK) | twi.status;
+    if (twi.status == TW_MR_DATA_ACK || twi.status == TW_MR_DATA_NACK)
+      TWDR = twi.received;
+    TWCR.value |= _BV(TWINT);
+  }
+  if ((TWCR.value & _BV(TWINT)) && (TWCR.value & _BV(TWIE)) && interruptsEnabled && TWI_vect)
+    RUN_ISR(TWI_vect);
+}
+
+MockBusCounters mockI2CCounters(uint8_t address) { return i2cCounters[address]; }
+MockBusCounters mockSPICounters(void) { return spiCounters; }
+
+void mockResetCounters(void)
+{
+  i2cCounters.clear();
+  spiCounters.transactions = 0;
+  spiCounters.bytes = 0;
+  mockOLed.commands = 0;
+  mockMCP23008.gpioChanges = 0;
+  memset(mockEEPROM.pageWrites, 0, sizeof(mockEEPROM.pageWrites));
+}
+
+// --- SSD1311 ---------------------------------------------------------------
+
+MockOLed::MockOLed() : address(0), displayOn(false), cgramMode(false), commands(0)
+{
+  memset(cgram, 0, sizeof(cgram));
+  memset(ddram, ' ', sizeof(ddram));
+}
+
+void MockOLed::command(uint8_t cmd)
+{
+  commands++;
+  if (cmd & 0x80)
+  {
+    address = cmd & 0x7F;
+    cgramMode = false;
+  }
+  else if (cmd & 0x40)
+  {
+    address = cmd & 0x3F;
+    cgramMode = true;
+  }
+  else if (cmd == 0x01)
+  {
+    memset(ddram, ' ', sizeof(ddram));
+    address = 0;
+    cgramMode = false;
+  }
+  else if ((cmd & 0xF8) == 0x08)
+    displayOn = cmd & 0x04;
+}
+
+void MockOLed::data(uint8_t d)
+{
+  if (cgramMode)
+    cgram[address++ & 0x3F] = d;
+  else
+    ddram[address++ & 0x7F] = d;
+}
+
+void MockOLed::onWrite(const uint8_t *data, size_t length)
+{
+  size_t i = 0;
+  while (i + 1 < length)
+  {
+    uint8_t control = data[i++];
+    bool isData = control & 0x40;
+    if (control & 0x80) // Continuation: exactly one byte follows
+    {
+      isData ? this->data(data[i]) : command(data[i]);
+      i++;
+    }
+    else // Last control byte: the rest of the transaction is a stream
+    {
+      for (; i < length; i++)
+        isData ? this->data(data[i]) : command(data[i]);
+    }
+  }
+}
+
+size_t MockOLed::onRead(uint8_t *data, size_t length)
+{
+  for (size_t i = 0; i < length; i++)
+    data[i] = address & 0x7F; // Busy flag is never set
+  return length;
+}
+
+char MockOLed::charAt(uint8_t col, uint8_t row) const { return ddram[(row * 0x20 + col) & 0x7F]; }
+
+const char *MockOLed::line(uint8_t row) const
+{
+  for (uint8_t col = 0; col < 20; col++)
+    lineBuf[col] = charAt(col, row);
+  lineBuf[20] = 0;
+  return lineBuf;
+}
+
+// --- MCP23008 --------------------------------------------------------------
+
+MockMCP23008::MockMCP23008() : pointer(0), gpioChanges(0)
+{
+  memset(reg, 0, sizeof(reg));
+  reg[0] = 0xFF; // IODIR
+}
+
+void MockMCP23008::onWrite(const uint8_t *data, size_t length)
+{
+  if (length == 0)
+    return;
+  pointer = data[0] % 11;
+  for (size_t i = 1; i < length; i++)
+  {
+    uint8_t r = pointer;
+    if (r == 0x09) // Writing GPIO writes the output latch
+      r = 0x0A;
+    if (r == 0x0A && reg[r] != data[i])
+      gpioChanges++;
+    reg[r] = data[i];
+    if (r == 0x0A)
+      reg[0x09] = data[i] & ~reg[0];
+    if (!(reg[0x05] & 0x20)) // IOCON.SEQOP = 0: address pointer increments
+      pointer = (pointer + 1) % 11;
+  }
+}
+
+size_t MockMCP23008::onRead(uint8_t *data, size_t length)
+{
+  for (size_t i = 0; i < length; i++)
+  {
+    data[i] = reg[pointer];
+    if (!(reg[0x05] & 0x20))
+      pointer = (pointer + 1) % 11;
+  }
+  return length;
+}
+
+// --- 24C64 -----------------------------------------------------------------
+
+Mock24C64::Mock24C64() : pointer(0), busyUntil(0)
+{
+  memset(memory, 0xFF, sizeof(memory));
+  memset(pageWrites, 0, sizeof(pageWrites));
+}
+
+// The address is not acknowledged during the internal write cycle
+bool Mock24C64::onAddress(bool)
+{
+  return (long)(busyUntil - nowMicros) <= 0;
+}
+
+void Mock24C64::onWrite(const uint8_t *data, size_t length)
+{
+  if (length < 2)
+    return;
+  pointer = ((data[0] << 8) | data[1]) & 0x1FFF;
+  if (length > 2)
+  {
+    uint16_t page = pointer & ~31;
+    for (size_t i = 2; i < length; i++)
+    {
+      memory[pointer] = data[i];
+      pointer = page | ((pointer + 1) & 31); // Writes wrap inside the page
+    }
+    pageWrites[page / 32]++;
+    busyUntil = nowMicros + 5000;
+  }
+}
+
+size_t Mock24C64::onRead(uint8_t *data, size_t length)
+{
+  if ((long)(busyUntil - nowMicros) > 0)
+    return 0;
+  for (size_t i = 0; i < length; i++)
+  {
+    data[i] = memory[pointer];
+    pointer = (pointer + 1) & 0x1FFF;
+  }
+  return length;
+}
@@ -0,0 +1,106 @@
+/*
+** Simulated hardware for the native build
+**
+** A virtual clock drives millis()/micros(), the Timer1 callback and the ADC.
+** The TWI is simulated on the register level and its transactions are routed
+** to small behavioural models of the devices on the controller board (SSD1311 OLED, MCP23008, 24C64) and every bus access
+** is counted so the benchmarks (native/benchmark) can report transactions and
+** bytes per device.
+*/
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MOCK_OLED_ADDRESS 0x3c
+#define MOCK_MCP23008_ADDRESS 0x20
+#define MOCK_EEPROM_ADDRESS 0x50
+
+struct MockBusCounters
+{
+  uint32_t transactions;
+  uint32_t bytes;
+};
+
+class MockI2CDevice
+{
+public:
+  virtual ~MockI2CDevice() {}
+  // Address of a transaction; return false to NACK it
+  virtual bool onAddress(bool) { return true; }
+  // Data of one write transaction
+  virtual void onWrite(const uint8_t *data, size_t length) = 0;
+  // Fill data for a read transaction; return the number of bytes supplied
+  virtual size_t onRead(uint8_t *data, size_t length) = 0;
+};
+
+class MockOLed : public MockI2CDevice
+{
+public:
+  MockOLed();
+  void onWrite(const uint8_t *data, size_t length);
+  size_t onRead(uint8_t *data, size_t length);
+  char charAt(uint8_t col, uint8_t row) const;
+  const char *line(uint8_t row) const; // 20 characters of the row, null terminated
+  uint8_t cgram[64];
+  uint8_t ddram[128];
+  uint8_t address;
+  bool displayOn;
+  bool cgramMode;
+  uint32_t commands;
+
+private:
+  void command(uint8_t cmd);
+  void data(uint8_t d);
+  mutable char lineBuf[21];
+};
+
+class MockMCP23008 : public MockI2CDevice
+{
+public:
+  MockMCP23008();
+  void onWrite(const uint8_t *data, size_t length);
+  size_t onRead(uint8_t *data, size_t length);
+  uint8_t reg[11];
+  uint8_t pointer;
+  uint32_t gpioChanges;
+};
+
+class Mock24C64 : public MockI2CDevice
+{
+public:
+  Mock24C64();
+  bool onAddress(bool read);
+  void onWrite(const uint8_t *data, size_t length);
+  size_t onRead(uint8_t *data, size_t length);
+  uint8_t memory[8192];
+  uint16_t pageWrites[8192 / 32];
+  uint16_t pointer;
+  unsigned long busyUntil;
+};
+
+extern MockOLed mockOLed;
+extern MockMCP23008 mockMCP23008;
+extern Mock24C64 mockEEPROM;
+
+// Virtual time
+void mockAdvanceMicros(unsigned long us);
+void mockAdvanceMillis(unsigned long ms);
+unsigned long mockMicros(void);
+
+// Bus statistics
+MockBusCounters mockI2CCounters(uint8_t address);
+MockBusCounters mockSPICounters(void);
+void mockResetCounters(void);
+
+// Inputs
+void mockSetPin(uint8_t pin, uint8_t level); // digital pin level seen by digitalRead()/PINx
+void mockSetAnalog(uint8_t channel, uint16_t value); // ADC result for a mux channel (14 = bandgap)
+void mockSerialInput(const uint8_t *data, size_t length);
+size_t mockSerialOutput(uint8_t *data, size_t max); // drains captured output
+
+// Raise an external interrupt (the IR receiver) now
+void mockTriggerInterrupt(uint8_t interruptNum);
+
+// Number of times sleep_cpu() has been called with sleep enabled
+uint32_t mockSleepCount(void);
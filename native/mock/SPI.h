@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifndef LSBFIRST
+#define LSBFIRST 0
+#endif
+#ifndef MSBFIRST
+#define MSBFIRST 1
+#endif
+
+#define SPI_MODE0 0x00
+#define SPI_MODE1 0x04
+#define SPI_MODE2 0x08
+#define SPI_MODE3 0x0C
+
+class SPISettings
+{
+public:
+  SPISettings() : clock(4000000), bitOrder(MSBFIRST), dataMode(SPI_MODE0) {}
+  SPISettings(uint32_t clock, uint8_t bitOrder, uint8_t dataMode) : clock(clock), bitOrder(bitOrder), dataMode(dataMode) {}
+  uint32_t clock;
+  uint8_t bitOrder;
+  uint8_t dataMode;
+};
+
+// Host SPI: every transfer is recorded by MockHardware.h
+class SPIClass
+{
+public:
+  static void begin() {}
+  static void end() {}
+  static void beginTransaction(SPISettings settings);
+  static void endTransaction(void);
+  static uint8_t transfer(uint8_t data);
+};
+
+extern SPIClass SPI;
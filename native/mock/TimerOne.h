@@ -0,0 +1,20 @@
+#pragma once
+
+#include <stdint.h>
+
+// Host replacement of TimerOne: the callback is run from the simulated clock
+class TimerOne
+{
+public:
+  void initialize(unsigned long microseconds = 1000000);
+  void setPeriod(unsigned long microseconds);
+  void start();
+  void stop();
+  void restart();
+  void resume();
+  void attachInterrupt(void (*isr)());
+  void attachInterrupt(void (*isr)(), unsigned long microseconds);
+  void detachInterrupt();
+};
+
+extern TimerOne Timer1;
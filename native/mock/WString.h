@@ -0,0 +1,40 @@
+#pragma once
+
+#include <string>
+
+class __FlashStringHelper;
+
+// Small subset of the Arduino String class
+class String
+{
+public:
+  String(const char *s = "") : s_(s ? s : "") {}
+  String(char c) : s_(1, c) {}
+  String &operator=(const char *s)
+  {
+    s_ = s ? s : "";
+    return *this;
+  }
+  unsigned int length() const { return s_.length(); }
+  char charAt(unsigned int i) const { return i < s_.length() ? s_[i] : 0; }
+  String substring(unsigned int from, unsigned int to) const { return String(s_.substr(from, to - from).c_str()); }
+  void trim()
+  {
+    size_t b = s_.find_first_not_of(" \t\r\n");
+    size_t e = s_.find_last_not_of(" \t\r\n");
+    s_ = (b == std::string::npos) ? "" : s_.substr(b, e - b + 1);
+  }
+  const char *c_str() const { return s_.c_str(); }
+  bool operator==(const char *o) const { return s_ == o; }
+  friend String operator+(const String &a, const String &b)
+  {
+    String r(a);
+    r.s_ += b.s_;
+    return r;
+  }
+  friend String operator+(const String &a, const char *b) { return a + String(b); }
+  friend String operator+(const String &a, char c) { return a + String(c); }
+
+private:
+  std::string s_;
+};
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <stdint.h>
+
+// Interrupt vectors become plain functions that the host harness may call
+#define ISR(vector, ...) extern "C" void vector(void); extern "C" void vector(void)
+#define EMPTY_INTERRUPT(vector) extern "C" void vector(void) {}
+
+void cli(void);
+void sei(void);
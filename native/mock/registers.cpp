@@ -0,0 +1,54 @@
+#include "avr/io.h"
+
+volatile uint8_t ADMUX;
+volatile uint8_t ADCSRA;
+volatile uint8_t ADCSRB;
+volatile uint8_t ADCL;
+volatile uint8_t ADCH;
+volatile uint8_t DIDR0;
+volatile uint8_t ACSR;
+volatile uint8_t TWBR;
+volatile uint8_t TWSR;
+MockTWCR TWCR;
+volatile uint8_t TWDR;
+volatile uint8_t TWAR;
+volatile uint8_t TWAMR;
+volatile uint8_t PINB;
+volatile uint8_t PINC;
+volatile uint8_t PIND;
+volatile uint8_t PORTB;
+volatile uint8_t PORTC;
+volatile uint8_t PORTD;
+volatile uint8_t DDRB;
+volatile uint8_t DDRC;
+volatile uint8_t DDRD;
+volatile uint8_t PCICR;
+volatile uint8_t PCIFR;
+volatile uint8_t PCMSK0;
+volatile uint8_t PCMSK1;
+volatile uint8_t PCMSK2;
+volatile uint8_t EICRA;
+volatile uint8_t EIMSK;
+volatile uint8_t EIFR;
+volatile uint8_t SREG;
+volatile uint8_t SMCR;
+volatile uint8_t MCUCR;
+volatile uint8_t MCUSR;
+volatile uint8_t PRR;
+volatile uint8_t TCCR1A;
+volatile uint8_t TCCR1B;
+volatile uint8_t TCCR1C;
+volatile uint8_t TIMSK1;
+volatile uint8_t TIFR1;
+volatile uint8_t TCCR0A;
+volatile uint8_t TCCR0B;
+volatile uint8_t TIMSK0;
+volatile uint8_t WDTCSR;
+volatile uint8_t SPCR;
+volatile uint8_t SPSR;
+volatile uint8_t SPDR;
+volatile uint16_t ADC;
+volatile uint16_t ICR1;
+volatile uint16_t OCR1A;
+volatile uint16_t OCR1B;
+volatile uint16_t TCNT1;
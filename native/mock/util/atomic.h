@@ -0,0 +1,16 @@
+#pragma once
+
+#include "avr/io.h"
+#include "avr/interrupt.h"
+
+// The global interrupt flag (bit 7 of SREG) is restored at the end of the block - ATOMIC_FORCEON is treated as ATOMIC_RESTORESTATE
+static inline uint8_t mockAtomicEnter(void)
+{
+  uint8_t sreg = SREG;
+  cli();
+  return sreg;
+}
+
+#define ATOMIC_RESTORESTATE
+#define ATOMIC_FORCEON
+#define ATOMIC_BLOCK(type) for (uint8_t _atomic_sreg = mockAtomicEnter(), _atomic_done = 1; _atomic_done; _atomic_done = 0, SREG = _atomic_sreg)
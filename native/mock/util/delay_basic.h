@@ -0,0 +1,6 @@
+#pragma once
+
+#include <stdint.h>
+
+static inline void _delay_loop_1(uint8_t) {}
+static inline void _delay_loop_2(uint16_t) {}
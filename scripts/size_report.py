@@ -0,0 +1,54 @@
+# Post-build RAM report of the AVR firmware (see extra_scripts in platformio.ini)
+#
+# Prints the size of .data and .bss, the RAM left for the stack and the largest
+# stack frames found in the .su files written by -fstack-usage. The peak stack
+# actually used is measured at runtime by the profiler (see Profiler.h).
+
+import os
+import subprocess
+
+Import("env")
+
+RAM_SIZE = int(env.BoardConfig().get("upload.maximum_ram_size", 2048))
+LARGEST_FRAMES = 8
+
+
+def section_sizes(elf):
+    output = subprocess.check_output([env.subst("$SIZETOOL"), "-A", elf]).decode()
+    sizes = {}
+    for line in output.splitlines():
+        fields = line.split()
+        if len(fields) >= 2 and fields[0].startswith(".") and fields[1].isdigit():
+            sizes[fields[0]] = int(fields[1])
+    return sizes
+
+
+def stack_frames(build_dir):
+    frames = []
+    for root, _, files in os.walk(build_dir):
+        for name in files:
+            if not name.endswith(".su"):
+                continue
+            with open(os.path.join(root, name)) as su:
+                for line in su:
+                    # file:line:column:function<TAB>bytes<TAB>static|dynamic|bounded
+                    fields = line.rstrip("\n").split("\t")
+                    if len(fields) == 3 and fields[1].isdigit():
+                        frames.append((int(fields[1]), fields[0].split(":")[-1], fields[2]))
+    return sorted(frames, reverse=True)[:LARGEST_FRAMES]
+
+
+def size_report(source, target, env):
+    sizes = section_sizes(str(target[0]))
+    data = sizes.get(".data", 0)
+    bss = sizes.get(".bss", 0)
+    print("RAM: .data %d + .bss %d = %d of %d bytes, %d left for the stack"
+          % (data, bss, data + bss, RAM_SIZE, RAM_SIZE - data - bss))
+    frames = stack_frames(env.subst("$BUILD_DIR"))
+    if frames:
+        print("Largest stack frames:")
+        for size, function, kind in frames:
+            print("  %5d %-8s %s" % (size, kind, function))
+
+
+env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", size_report)
@@ -23,37 +23,13 @@ enum ctlMenuCommandId
   mnuCmdMAX_START_VOL,
   mnuCmdMUTE_LVL,
   mnuCmdSTORE_LVL,
+  mnuCmdBALANCE,
   mnuCmdINPUT_MENU,
-  mnuCmdINPUT1_MENU,
-  mnuCmdINPUT1_ACTIVE,
-  mnuCmdINPUT1_NAME,
-  mnuCmdINPUT1_MAX_VOL,
-  mnuCmdINPUT1_MIN_VOL,
-  mnuCmdINPUT2_MENU,
-  mnuCmdINPUT2_ACTIVE,
-  mnuCmdINPUT2_NAME,
-  mnuCmdINPUT2_MAX_VOL,
-  mnuCmdINPUT2_MIN_VOL,
-  mnuCmdINPUT3_MENU,
-  mnuCmdINPUT3_ACTIVE,
-  mnuCmdINPUT3_NAME,
-  mnuCmdINPUT3_MAX_VOL,
-  mnuCmdINPUT3_MIN_VOL,
-  mnuCmdINPUT4_MENU,
-  mnuCmdINPUT4_ACTIVE,
-  mnuCmdINPUT4_NAME,
-  mnuCmdINPUT4_MAX_VOL,
-  mnuCmdINPUT4_MIN_VOL,
-  mnuCmdINPUT5_MENU,
-  mnuCmdINPUT5_ACTIVE,
-  mnuCmdINPUT5_NAME,
-  mnuCmdINPUT5_MAX_VOL,
-  mnuCmdINPUT5_MIN_VOL,
-  mnuCmdINPUT6_MENU,
-  mnuCmdINPUT6_ACTIVE,
-  mnuCmdINPUT6_NAME,
-  mnuCmdINPUT6_MAX_VOL,
-  mnuCmdINPUT6_MIN_VOL,
+  mnuCmdINPUTn_MENU,   // Every input - the input is the index of the item in the Inputs menu
+  mnuCmdINPUT_ACTIVE,  // Items of the menu shared by the inputs
+  mnuCmdINPUT_NAME,
+  mnuCmdINPUT_MAX_VOL,
+  mnuCmdINPUT_MIN_VOL,
   mnuCmdIR_MENU,
   mnuCmdIR_ONOFF,
   mnuCmdIR_UP,
@@ -65,12 +41,7 @@ enum ctlMenuCommandId
   mnuCmdIR_BACK,
   mnuCmdIR_MUTE,
   mnuCmdIR_PREV,
-  mnuCmdIR_1,
-  mnuCmdIR_2,
-  mnuCmdIR_3,
-  mnuCmdIR_4,
-  mnuCmdIR_5,
-  mnuCmdIR_6,
+  mnuCmdIR_INPUT,      // The key of every input - KEY_1 + the index of the item counted from the first of them
   mnuCmdPWR_CTL_MENU,
   mnuCmdTRIG1_MENU,
   mnuCmdTRIGGER1_ACTIVE,
@@ -104,41 +75,16 @@ enum ctlMenuCommandId
 PROGMEM const char ctlMenu_back[] = "Back";
 PROGMEM const char ctlMenu_exit[] = "Exit";
 
-PROGMEM const char ctlMenu_2_1_1[] = "Active";
-PROGMEM const char ctlMenu_2_1_2[] = "Name";
-PROGMEM const char ctlMenu_2_1_3[] = "Max. volume";
-PROGMEM const char ctlMenu_2_1_4[] = "Min. volume";
-PROGMEM const MenuItem ctlMenu_List_2_1[] = {{mnuCmdINPUT1_ACTIVE, ctlMenu_2_1_1}, {mnuCmdINPUT1_NAME, ctlMenu_2_1_2}, {mnuCmdINPUT1_MAX_VOL, ctlMenu_2_1_3}, {mnuCmdINPUT1_MIN_VOL, ctlMenu_2_1_4}, {mnuCmdBack, ctlMenu_back}};
+#if INPUTS < 1 || INPUTS > 12
+#error "The menus have room for 1 to 12 inputs"
+#endif
 
-PROGMEM const char ctlMenu_2_2_1[] = "Active";
-PROGMEM const char ctlMenu_2_2_2[] = "Name";
-PROGMEM const char ctlMenu_2_2_3[] = "Max. volume";
-PROGMEM const char ctlMenu_2_2_4[] = "Min. volume";
-PROGMEM const MenuItem ctlMenu_List_2_2[] = {{mnuCmdINPUT2_ACTIVE, ctlMenu_2_2_1}, {mnuCmdINPUT2_NAME, ctlMenu_2_2_2}, {mnuCmdINPUT2_MAX_VOL, ctlMenu_2_2_3}, {mnuCmdINPUT2_MIN_VOL, ctlMenu_2_2_4}, {mnuCmdBack, ctlMenu_back}};
-
-PROGMEM const char ctlMenu_2_3_1[] = "Active";
-PROGMEM const char ctlMenu_2_3_2[] = "Name";
-PROGMEM const char ctlMenu_2_3_3[] = "Max. volume";
-PROGMEM const char ctlMenu_2_3_4[] = "Min. volume";
-PROGMEM const MenuItem ctlMenu_List_2_3[] = {{mnuCmdINPUT3_ACTIVE, ctlMenu_2_3_1}, {mnuCmdINPUT3_NAME, ctlMenu_2_3_2}, {mnuCmdINPUT3_MAX_VOL, ctlMenu_2_3_3}, {mnuCmdINPUT3_MIN_VOL, ctlMenu_2_3_4}, {mnuCmdBack, ctlMenu_back}};
-
-PROGMEM const char ctlMenu_2_4_1[] = "Active";
-PROGMEM const char ctlMenu_2_4_2[] = "Name";
-PROGMEM const char ctlMenu_2_4_3[] = "Max. volume";
-PROGMEM const char ctlMenu_2_4_4[] = "Min. volume";
-PROGMEM const MenuItem ctlMenu_List_2_4[] = {{mnuCmdINPUT4_ACTIVE, ctlMenu_2_4_1}, {mnuCmdINPUT4_NAME, ctlMenu_2_4_2}, {mnuCmdINPUT4_MAX_VOL, ctlMenu_2_4_3}, {mnuCmdINPUT4_MIN_VOL, ctlMenu_2_4_4}, {mnuCmdBack, ctlMenu_back}};
-
-PROGMEM const char ctlMenu_2_5_1[] = "Active";
-PROGMEM const char ctlMenu_2_5_2[] = "Name";
-PROGMEM const char ctlMenu_2_5_3[] = "Max. volume";
-PROGMEM const char ctlMenu_2_5_4[] = "Min. volume";
-PROGMEM const MenuItem ctlMenu_List_2_5[] = {{mnuCmdINPUT5_ACTIVE, ctlMenu_2_5_1}, {mnuCmdINPUT5_NAME, ctlMenu_2_5_2}, {mnuCmdINPUT5_MAX_VOL, ctlMenu_2_5_3}, {mnuCmdINPUT5_MIN_VOL, ctlMenu_2_5_4}, {mnuCmdBack, ctlMenu_back}};
-
-PROGMEM const char ctlMenu_2_6_1[] = "Active";
-PROGMEM const char ctlMenu_2_6_2[] = "Name";
-PROGMEM const char ctlMenu_2_6_3[] = "Max. volume";
-PROGMEM const char ctlMenu_2_6_4[] = "Min. volume";
-PROGMEM const MenuItem ctlMenu_List_2_6[] = {{mnuCmdINPUT6_ACTIVE, ctlMenu_2_6_1}, {mnuCmdINPUT6_NAME, ctlMenu_2_6_2}, {mnuCmdINPUT6_MAX_VOL, ctlMenu_2_6_3}, {mnuCmdINPUT6_MIN_VOL, ctlMenu_2_6_4}, {mnuCmdBack, ctlMenu_back}};
+// The inputs share one menu
+PROGMEM const char ctlMenu_2_n_1[] = "Active";
+PROGMEM const char ctlMenu_2_n_2[] = "Name";
+PROGMEM const char ctlMenu_2_n_3[] = "Max. volume";
+PROGMEM const char ctlMenu_2_n_4[] = "Min. volume";
+PROGMEM const MenuItem ctlMenu_List_2_n[] = {{mnuCmdINPUT_ACTIVE, ctlMenu_2_n_1}, {mnuCmdINPUT_NAME, ctlMenu_2_n_2}, {mnuCmdINPUT_MAX_VOL, ctlMenu_2_n_3}, {mnuCmdINPUT_MIN_VOL, ctlMenu_2_n_4}, {mnuCmdBack, ctlMenu_back}};
 
 PROGMEM const char ctlMenu_4_1_1[] = "Active";
 PROGMEM const char ctlMenu_4_1_2[] = "Moment./Latch";
@@ -160,15 +106,59 @@ PROGMEM const char ctlMenu_1_3[] = "Max attenuation";
 PROGMEM const char ctlMenu_1_4[] = "Max start vol";
 PROGMEM const char ctlMenu_1_5[] = "Mute level";
 PROGMEM const char ctlMenu_1_6[] = "Vol. memory";
-PROGMEM const MenuItem ctlMenu_List_1[] = {{mnuCmdVOL_STEPS, ctlMenu_1_1}, {mnuCmdMIN_ATT, ctlMenu_1_2}, {mnuCmdMAX_ATT, ctlMenu_1_3}, {mnuCmdMAX_START_VOL, ctlMenu_1_4}, {mnuCmdMUTE_LVL, ctlMenu_1_5}, {mnuCmdSTORE_LVL, ctlMenu_1_6}, {mnuCmdBack, ctlMenu_back}};
+PROGMEM const char ctlMenu_1_7[] = "Balance";
+PROGMEM const MenuItem ctlMenu_List_1[] = {{mnuCmdVOL_STEPS, ctlMenu_1_1}, {mnuCmdMIN_ATT, ctlMenu_1_2}, {mnuCmdMAX_ATT, ctlMenu_1_3}, {mnuCmdMAX_START_VOL, ctlMenu_1_4}, {mnuCmdMUTE_LVL, ctlMenu_1_5}, {mnuCmdSTORE_LVL, ctlMenu_1_6}, {mnuCmdBALANCE, ctlMenu_1_7}, {mnuCmdBack, ctlMenu_back}};
 
+// One item per input (INPUTS)
 PROGMEM const char ctlMenu_2_1[] = "Input 1";
 PROGMEM const char ctlMenu_2_2[] = "Input 2";
 PROGMEM const char ctlMenu_2_3[] = "Input 3";
 PROGMEM const char ctlMenu_2_4[] = "Input 4";
 PROGMEM const char ctlMenu_2_5[] = "Input 5";
 PROGMEM const char ctlMenu_2_6[] = "Input 6";
-PROGMEM const MenuItem ctlMenu_List_2[] = {{mnuCmdINPUT1_MENU, ctlMenu_2_1, ctlMenu_List_2_1, menuCount(ctlMenu_List_2_1)}, {mnuCmdINPUT2_MENU, ctlMenu_2_2, ctlMenu_List_2_2, menuCount(ctlMenu_List_2_2)}, {mnuCmdINPUT3_MENU, ctlMenu_2_3, ctlMenu_List_2_3, menuCount(ctlMenu_List_2_3)}, {mnuCmdINPUT4_MENU, ctlMenu_2_4, ctlMenu_List_2_4, menuCount(ctlMenu_List_2_4)}, {mnuCmdINPUT5_MENU, ctlMenu_2_5, ctlMenu_List_2_5, menuCount(ctlMenu_List_2_5)}, {mnuCmdINPUT6_MENU, ctlMenu_2_6, ctlMenu_List_2_6, menuCount(ctlMenu_List_2_6)}, {mnuCmdBack, ctlMenu_back}};
+PROGMEM const char ctlMenu_2_7[] = "Input 7";
+PROGMEM const char ctlMenu_2_8[] = "Input 8";
+PROGMEM const char ctlMenu_2_9[] = "Input 9";
+PROGMEM const char ctlMenu_2_10[] = "Input 10";
+PROGMEM const char ctlMenu_2_11[] = "Input 11";
+PROGMEM const char ctlMenu_2_12[] = "Input 12";
+#define ctlMenu_Input(n) {mnuCmdINPUTn_MENU, ctlMenu_2_##n, ctlMenu_List_2_n, menuCount(ctlMenu_List_2_n)}
+PROGMEM const MenuItem ctlMenu_List_2[] = {
+  ctlMenu_Input(1),
+#if INPUTS >= 2
+  ctlMenu_Input(2),
+#endif
+#if INPUTS >= 3
+  ctlMenu_Input(3),
+#endif
+#if INPUTS >= 4
+  ctlMenu_Input(4),
+#endif
+#if INPUTS >= 5
+  ctlMenu_Input(5),
+#endif
+#if INPUTS >= 6
+  ctlMenu_Input(6),
+#endif
+#if INPUTS >= 7
+  ctlMenu_Input(7),
+#endif
+#if INPUTS >= 8
+  ctlMenu_Input(8),
+#endif
+#if INPUTS >= 9
+  ctlMenu_Input(9),
+#endif
+#if INPUTS >= 10
+  ctlMenu_Input(10),
+#endif
+#if INPUTS >= 11
+  ctlMenu_Input(11),
+#endif
+#if INPUTS >= 12
+  ctlMenu_Input(12),
+#endif
+  {mnuCmdBack, ctlMenu_back}};
 
 PROGMEM const char ctlMenu_3_1[] = "On/Off";
 PROGMEM const char ctlMenu_3_2[] = "Up";
@@ -180,13 +170,55 @@ PROGMEM const char ctlMenu_3_7[] = "Select";
 PROGMEM const char ctlMenu_3_8[] = "Back";
 PROGMEM const char ctlMenu_3_9[] = "Mute";
 PROGMEM const char ctlMenu_3_10[] = "Previous";
-PROGMEM const char ctlMenu_3_11[] = "1";
-PROGMEM const char ctlMenu_3_12[] = "2";
-PROGMEM const char ctlMenu_3_13[] = "3";
-PROGMEM const char ctlMenu_3_14[] = "4";
-PROGMEM const char ctlMenu_3_15[] = "5";
-PROGMEM const char ctlMenu_3_16[] = "6";
-PROGMEM const MenuItem ctlMenu_List_3[] = {{mnuCmdIR_ONOFF, ctlMenu_3_1}, {mnuCmdIR_UP, ctlMenu_3_2}, {mnuCmdIR_DOWN, ctlMenu_3_3}, {mnuCmdIR_REPEAT, ctlMenu_3_4}, {mnuCmdIR_LEFT, ctlMenu_3_5}, {mnuCmdIR_RIGHT, ctlMenu_3_6}, {mnuCmdIR_SELECT, ctlMenu_3_7}, {mnuCmdIR_BACK, ctlMenu_3_8}, {mnuCmdIR_MUTE, ctlMenu_3_9}, {mnuCmdIR_PREV, ctlMenu_3_10}, {mnuCmdIR_1, ctlMenu_3_11}, {mnuCmdIR_2, ctlMenu_3_12}, {mnuCmdIR_3, ctlMenu_3_13}, {mnuCmdIR_4, ctlMenu_3_14}, {mnuCmdIR_5, ctlMenu_3_15}, {mnuCmdIR_6, ctlMenu_3_16}, {mnuCmdBack, ctlMenu_back}};
+PROGMEM const char ctlMenu_3_i1[] = "1";
+PROGMEM const char ctlMenu_3_i2[] = "2";
+PROGMEM const char ctlMenu_3_i3[] = "3";
+PROGMEM const char ctlMenu_3_i4[] = "4";
+PROGMEM const char ctlMenu_3_i5[] = "5";
+PROGMEM const char ctlMenu_3_i6[] = "6";
+PROGMEM const char ctlMenu_3_i7[] = "7";
+PROGMEM const char ctlMenu_3_i8[] = "8";
+PROGMEM const char ctlMenu_3_i9[] = "9";
+PROGMEM const char ctlMenu_3_i10[] = "10";
+PROGMEM const char ctlMenu_3_i11[] = "11";
+PROGMEM const char ctlMenu_3_i12[] = "12";
+#define ctlMenu_IRInput(n) {mnuCmdIR_INPUT, ctlMenu_3_i##n}
+PROGMEM const MenuItem ctlMenu_List_3[] = {{mnuCmdIR_ONOFF, ctlMenu_3_1}, {mnuCmdIR_UP, ctlMenu_3_2}, {mnuCmdIR_DOWN, ctlMenu_3_3}, {mnuCmdIR_REPEAT, ctlMenu_3_4}, {mnuCmdIR_LEFT, ctlMenu_3_5}, {mnuCmdIR_RIGHT, ctlMenu_3_6}, {mnuCmdIR_SELECT, ctlMenu_3_7}, {mnuCmdIR_BACK, ctlMenu_3_8}, {mnuCmdIR_MUTE, ctlMenu_3_9}, {mnuCmdIR_PREV, ctlMenu_3_10},
+  ctlMenu_IRInput(1),
+#if INPUTS >= 2
+  ctlMenu_IRInput(2),
+#endif
+#if INPUTS >= 3
+  ctlMenu_IRInput(3),
+#endif
+#if INPUTS >= 4
+  ctlMenu_IRInput(4),
+#endif
+#if INPUTS >= 5
+  ctlMenu_IRInput(5),
+#endif
+#if INPUTS >= 6
+  ctlMenu_IRInput(6),
+#endif
+#if INPUTS >= 7
+  ctlMenu_IRInput(7),
+#endif
+#if INPUTS >= 8
+  ctlMenu_IRInput(8),
+#endif
+#if INPUTS >= 9
+  ctlMenu_IRInput(9),
+#endif
+#if INPUTS >= 10
+  ctlMenu_IRInput(10),
+#endif
+#if INPUTS >= 11
+  ctlMenu_IRInput(11),
+#endif
+#if INPUTS >= 12
+  ctlMenu_IRInput(12),
+#endif
+  {mnuCmdBack, ctlMenu_back}};
 
 PROGMEM const char ctlMenu_4_1[] = "Trigger 1";
 PROGMEM const char ctlMenu_4_2[] = "Trigger 2";
@@ -230,53 +262,13 @@ case mnuCmdMUTE_LVL :
 	break;
 case mnuCmdSTORE_LVL :
 	break;
-case mnuCmdINPUT1_ACTIVE :
-	break;
-case mnuCmdINPUT1_NAME :
-	break;
-case mnuCmdINPUT1_MAX_VOL :
-	break;
-case mnuCmdINPUT1_MIN_VOL :
-	break;
-case mnuCmdINPUT2_ACTIVE :
-	break;
-case mnuCmdINPUT2_NAME :
-	break;
-case mnuCmdINPUT2_MAX_VOL :
-	break;
-case mnuCmdINPUT2_MIN_VOL :
-	break;
-case mnuCmdINPUT3_ACTIVE :
-	break;
-case mnuCmdINPUT3_NAME :
-	break;
-case mnuCmdINPUT3_MAX_VOL :
-	break;
-case mnuCmdINPUT3_MIN_VOL :
-	break;
-case mnuCmdINPUT4_ACTIVE :
-	break;
-case mnuCmdINPUT4_NAME :
-	break;
-case mnuCmdINPUT4_MAX_VOL :
-	break;
-case mnuCmdINPUT4_MIN_VOL :
-	break;
-case mnuCmdINPUT5_ACTIVE :
-	break;
-case mnuCmdINPUT5_NAME :
-	break;
-case mnuCmdINPUT5_MAX_VOL :
+case mnuCmdINPUT_ACTIVE :
 	break;
-case mnuCmdINPUT5_MIN_VOL :
+case mnuCmdINPUT_NAME :
 	break;
-case mnuCmdINPUT6_ACTIVE :
+case mnuCmdINPUT_MAX_VOL :
 	break;
-case mnuCmdINPUT6_NAME :
-	break;
-case mnuCmdINPUT6_MAX_VOL :
-	break;
-case mnuCmdINPUT6_MIN_VOL :
+case mnuCmdINPUT_MIN_VOL :
 	break;
 case mnuCmdIR_ONOFF :
 	break;
@@ -298,17 +290,7 @@ case mnuCmdIR_MUTE :
 	break;
 case mnuCmdIR_PREV :
 	break;
-case mnuCmdIR_1 :
-	break;
-case mnuCmdIR_2 :
-	break;
-case mnuCmdIR_3 :
-	break;
-case mnuCmdIR_4 :
-	break;
-case mnuCmdIR_5 :
-	break;
-case mnuCmdIR_6 :
+case mnuCmdIR_INPUT :
 	break;
 case mnuCmdTRIGGER1_ACTIVE :
 	break;
@@ -372,56 +354,17 @@ case mnuCmdLOAD_DEFAULT :
                 <Item Id="MAX_START_VOL" Name="Max start vol"/>
                 <Item Id="MUTE_LVL" Name="Mute level"/>
                 <Item Id="STORE_LVL" Name="Vol. memory"/>
+                <Item Id="BALANCE" Name="Balance"/>
             </MenuItems>
         </Item>
         <Item Id="INPUT_MENU" Name="Inputs">
             <MenuItems>
-                <Item Id="INPUT1_MENU" Name="Input 1">
-                    <MenuItems>
-                        <Item Id="INPUT1_ACTIVE" Name="Active"/>
-                        <Item Id="INPUT1_NAME" Name="Name"/>
-                        <Item Id="INPUT1_MAX_VOL" Name="Max. volume"/>
-                        <Item Id="INPUT1_MIN_VOL" Name="Min. volume"/>
-                    </MenuItems>
-                </Item>
-                <Item Id="INPUT2_MENU" Name="Input 2">
-                    <MenuItems>
-                        <Item Id="INPUT2_ACTIVE" Name="Active"/>
-                        <Item Id="INPUT2_NAME" Name="Name"/>
-                        <Item Id="INPUT2_MAX_VOL" Name="Max. volume"/>
-                        <Item Id="INPUT2_MIN_VOL" Name="Min. volume"/>
-                    </MenuItems>
-                </Item>
-                <Item Id="INPUT3_MENU" Name="Input 3">
-                    <MenuItems>
-                        <Item Id="INPUT3_ACTIVE" Name="Active"/>
-                        <Item Id="INPUT3_NAME" Name="Name"/>
-                        <Item Id="INPUT3_MAX_VOL" Name="Max. volume"/>
-                        <Item Id="INPUT3_MIN_VOL" Name="Min. volume"/>
-                    </MenuItems>
-                </Item>
-                <Item Id="INPUT4_MENU" Name="Input 4">
-                    <MenuItems>
-                        <Item Id="INPUT4_ACTIVE" Name="Active"/>
-                        <Item Id="INPUT4_NAME" Name="Name"/>
-                        <Item Id="INPUT4_MAX_VOL" Name="Max. volume"/>
-                        <Item Id="INPUT4_MIN_VOL" Name="Min. volume"/>
-                    </MenuItems>
-                </Item>
-                <Item Id="INPUT5_MENU" Name="Input 5">
-                    <MenuItems>
-                        <Item Id="INPUT5_ACTIVE" Name="Active"/>
-                        <Item Id="INPUT5_NAME" Name="Name"/>
-                        <Item Id="INPUT5_MAX_VOL" Name="Max. volume"/>
-                        <Item Id="INPUT5_MIN_VOL" Name="Min. volume"/>
-                    </MenuItems>
-                </Item>
-                <Item Id="INPUT6_MENU" Name="Input 6">
+                <Item Id="INPUTn_MENU" Name="Input n">
                     <MenuItems>
-                        <Item Id="INPUT6_ACTIVE" Name="Active"/>
-                        <Item Id="INPUT6_NAME" Name="Name"/>
-                        <Item Id="INPUT6_MAX_VOL" Name="Max. volume"/>
-                        <Item Id="INPUT6_MIN_VOL" Name="Min. volume"/>
+                        <Item Id="INPUT_ACTIVE" Name="Active"/>
+                        <Item Id="INPUT_NAME" Name="Name"/>
+                        <Item Id="INPUT_MAX_VOL" Name="Max. volume"/>
+                        <Item Id="INPUT_MIN_VOL" Name="Min. volume"/>
                     </MenuItems>
                 </Item>
             </MenuItems>
@@ -438,12 +381,7 @@ case mnuCmdLOAD_DEFAULT :
                 <Item Id="IR_BACK" Name="Back"/>
                 <Item Id="IR_MUTE" Name="Mute"/>
                 <Item Id="IR_PREV" Name="Previous"/>
-                <Item Id="IR_1" Name="1"/>
-                <Item Id="IR_2" Name="2"/>
-                <Item Id="IR_3" Name="3"/>
-                <Item Id="IR_4" Name="4"/>
-                <Item Id="IR_5" Name="5"/>
-                <Item Id="IR_6" Name="6"/>
+                <Item Id="IR_INPUT" Name="n"/>
             </MenuItems>
         </Item>
         <Item Id="PWR_CTL_MENU" Name="Triggers">
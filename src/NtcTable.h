@@ -0,0 +1,32 @@
+#ifndef _NtcTable_
+#define _NtcTable_
+#include <avr/pgmspace.h>
+
+/*
+
+Temperature of the 4.7K NTC in the divider with the 4.7K reference resistor
+
+Entry n is the temperature in tenths of degrees Celcius at the 10 bit conversion
+result n * NTC_TABLE_STEP, calculated by the formula derived from the datasheet
+of the NTC: T = -25.37 * ln(Rntc) + 239.43 where Rntc = 4700 * ADC / (1024 - ADC).
+The formula goes towards +/- infinity at the ends, so the first entry is
+calculated at 1 and the last entry at 1023.
+
+*/
+
+#define NTC_TABLE_STEP 16
+#define NTC_TABLE_SIZE (1024 / NTC_TABLE_STEP + 1)
+
+const int16_t ntcTable[NTC_TABLE_SIZE] PROGMEM = {
+   2007,  1300,  1120,  1013,   936,   875,   825,   781, // 0-112
+    743,   708,   677,   648,   621,   596,   572,   550, // 128-240
+    528,   507,   487,   468,   449,   431,   413,   396, // 256-368
+    379,   362,   345,   329,   313,   297,   281,   265, // 384-496
+    249,   233,   217,   201,   185,   169,   153,   136, // 512-624
+    120,   103,    85,    67,    49,    30,    11,    -9, // 640-752
+    -30,   -51,   -74,   -98,  -123,  -150,  -179,  -210, // 768-880
+   -244,  -283,  -326,  -377,  -438,  -515,  -622,  -802, // 896-1008
+  -1509 // 1024
+};
+
+#endif
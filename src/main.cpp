@@ -8,60 +8,108 @@
 **
 */
 
-#define VERSION 0.94
+#define VERSION 0.96
 
-#include "Wire.h"
+#define INPUTS 6 // Number of inputs (1-12) - see inputRelays. The menus and the layout of the settings in the EEPROM follow it, so do a factory reset after changing it
+
+#include <stddef.h>
+#include <avr/sleep.h>
+#include "I2CBus.h"
 #include <Adafruit_MCP23008.h>
 #include "OLedI2C.h"
 #include "extEEPROM.h"
-#include "ClickEncoder.h"
+#include "PinChangeEncoder.h"
 #include "TimerOne.h"
-#include "IRLremote.h"
+#include "IRReceiver.h"
 #include "Muses72320.h"
+#include "Muses72320Group.h"
 #include "MenuManager.h"
 #include "MenuData.h"
+#include "NtcTable.h"
+#include "TaskScheduler.h"
+#include "AdcSampler.h"
+#include "ThermalMonitor.h"
+#include "RingBuffer.h"
+#include "SerialProtocol.h"
+#include "Profiler.h"
 
 // Declarations
 void startUp(void);
-void setTrigger1On(void);
-void setTrigger2On(void);
-void setTrigger1Off(void);
-void setTrigger2Off(void);
+void powerUpDisplay(void);
+void loadSettings(void);
+void startUpCountdown(void);
+void finishStartUp(void);
+bool startTriggers(void);
+void stopTriggers(void);
+bool triggerNeeded(byte, bool);
+void switchTriggers(byte, bool);
+void sequenceTriggers(void);
+void sampleTemperatures(void);
+void clearPowerLossMessage(void);
 void displayTemperatures(void);
-void displayTempDetails(float, uint8_t, uint8_t, uint8_t);
-float getTemperature(uint8_t);
+void markDisplayDirty(byte);
+void renderDisplay(void);
+void displayTempDetails(int16_t, uint8_t, uint8_t, uint8_t);
+int16_t getTemperature(uint8_t);
 void displayInput(void);
 void displayVolume(void);
 void displayMute(void);
-uint8_t getAttenuation(uint8_t, uint8_t, uint8_t, uint8_t);
-void setVolume(int16_t);
+void buildAttenuationTable(void);
+uint8_t getAttenuation(uint8_t);
+void setVolume(int16_t, uint16_t = 0);
+void setBalance(void);
 void mute(void);
 void unmute(void);
-boolean setInput(uint8_t);
+boolean setInput(uint8_t, bool = true);
+void switchInput(void);
+byte selectedInput(void);
+void switchInputRelays(byte, byte);
+void handleSerialCommands(void);
+byte checkSerialCommand(byte);
+byte limitSerialVolume(byte, byte);
+bool applySerialState(byte, byte, bool);
+void pushSerialState(void);
+void pushProfileRecords(void);
 void readSettingsFromEEPROM(void);
 void writeSettingsToEEPROM(void);
+void markSettingsDirty(const void *, uint16_t);
+void writeNextSettingsPage(void);
+void pollEEPROM(void);
 void writeDefaultSettingsToEEPROM(void);
 void readRuntimeSettingsFromEEPROM(void);
 void writeRuntimeSettingsToEEPROM(void);
-void readUserSettingsFromEEPROM(void);
+void checkpointRuntimeSettings(void);
+uint16_t readJournalSequence(uint8_t slot);
+byte crc8(const byte *, uint8_t);
+bool readUserSettingsFromEEPROM(void);
 void writeUserSettingsToEEPROM(void);
 void editInputName(uint8_t InputNumber);
 void drawEditInputNameScreen(bool isUpperCase);
 bool editNumericValue(byte &Value, byte MinValue, byte MaxValue, const char Unit[5]);
-bool editOptionValue(byte &Value, byte NumOptions, const char Option1[9], const char Option2[9], const char Option3[9], const char Option4[9]);
-bool editIRCode(HashIR_data_t &Value);
+bool editOptionValue(byte &Value, byte NumOptions, const char *const Options[]);
+bool editIRCode(byte Key);
+bool serviceMenuCommand();
+void holdMessage(unsigned long duration);
 void drawMenu();
+void printPadded(byte col, byte row, const char *text, byte width);
 void refreshMenuDisplay(byte refreshMode);
 byte processMenuCommand(byte cmdId);
 byte getNavAction();
 
-byte menuIndex = 0;
+byte menuIndex = 0; // The row (0-2) of the current menu item in the three rows showing menu items
+
+#define MENU_NAME_WIDTH 18 // Columns of a menu item - longer names are cut
 
 unsigned long mil_On = millis(); // Holds the millis from last power on (or restart)
 
 #define INPUT_HT_PASSTHROUGH 0
 #define INPUT_NORMAL 1
 #define INPUT_INACTIVATED 2
+#define INPUT_NONE 0xFF
+
+// An input change is pending from setInput() until switchInput() has switched the relays
+byte pendingInput = INPUT_NONE;
+bool pendingInputUnmute;
 
 #define ABANDON 99
 
@@ -73,6 +121,25 @@ struct InputSettings
   byte MinVol;
 };
 
+#define TRIGGERS 2 // Number of triggers - see triggerPins
+
+struct TriggerSettings
+{
+  byte Active;  // 0 = the trigger is not active, 1 = the trigger is active
+  byte Type;    // 0 = momentary, 1 = latching
+  byte Mode;    // 0 = standard, 1 = intelligent/SmartON (with measurement of NTC+LDR value)
+  byte OnDelay; // Seconds from controller power up to activation of trigger. The default delay allows time for the output relay of the Mezmerize to be activated before we turn on the power amps. The selection of an input of the Mezmerize will also be delayed.
+  byte Temp;    // Temperature protection: if the temperature is measured to the set number of degrees Celcius (via the LDRs), the controller will attempt to trigger a shutdown of the connected power amp (if set to 0, the temperature protection is not active)
+};
+
+#define IR_BINDINGS 24 // Maximum number of IR codes that can be bound to keys (more than one code may be bound to the same key, i.e. to use more than one remote)
+
+struct IRBinding
+{
+  HashIR_data_t Code;
+  byte Key; // The UserInput value the code is interpreted as (KEY_UP, KEY_DOWN etc.)
+};
+
 // This holds all the settings of the controller
 // It is saved to the I2C EEPROM on the first run and read back into memory on subsequent runs
 // The settings can be changed from the menu and the user can also chose to reset to default values if something goes wrong
@@ -87,33 +154,11 @@ typedef union {
     byte MaxStartVolume;           // If StoreSetLevel is true, then limit the volume to the specified value when the controller is powered on
     byte MuteLevel;                // The level to be set when Mute is activated by the user. The Mute function of the Muses72320 is activated if 0 is specified
     byte RecallSetLevel;           // Remember/store the volume level for each separate input
-    HashIR_data_t IR_ONOFF;        // IR data to be interpreted as ON/OFF - switch between running and suspend mode (and turn triggers off)
-    HashIR_data_t IR_UP;           // IR data to be interpreted as UP
-    HashIR_data_t IR_DOWN;         // IR data to be interpreted as DOWN
-    HashIR_data_t IR_REPEAT;       // IR data to be interpreted as REPEAT (ie Apple remotes sends a specific code, if a key is held down to indicate repeat of the previously sent code
-    HashIR_data_t IR_LEFT;         // IR data to be interpreted as LEFT
-    HashIR_data_t IR_RIGHT;        // IR data to be interpreted as RIGHT
-    HashIR_data_t IR_SELECT;       // IR data to be interpreted as SELECT
-    HashIR_data_t IR_BACK;         // IR data to be interpreted as BACK
-    HashIR_data_t IR_MUTE;         // IR data to be interpreted as MUTE
-    HashIR_data_t IR_PREVIOUS;     // IR data to be interpreted as "switch to previous selected input"
-    HashIR_data_t IR_1;            // IR data to be interpreted as 1 (to select input 1 directly)
-    HashIR_data_t IR_2;            // IR data to be interpreted as 2
-    HashIR_data_t IR_3;            // IR data to be interpreted as 3
-    HashIR_data_t IR_4;            // IR data to be interpreted as 4
-    HashIR_data_t IR_5;            // IR data to be interpreted as 5
-    HashIR_data_t IR_6;            // IR data to be interpreted as 6
-    struct InputSettings Input[6]; // Settings for all 6 inputs
-    byte Trigger1Active;           // 0 = the trigger is not active, 1 = the trigger is active
-    byte Trigger1Type;             // 0 = momentary, 1 = latching
-    byte Trigger1Mode;             // 0 = standard, 1 = intelligent/SmartON (with measurement of NTC+LDR value)
-    byte Trigger1OnDelay;          // Seconds from controller power up to activation of trigger. The default delay allows time for the output relay of the Mezmerize to be activated before we turn on the power amps. The selection of an input of the Mezmerize will also be delayed.
-    byte Trigger1Temp;             // Temperature protection: if the temperature is measured to the set number of degrees Celcius (via the LDRs), the controller will attempt to trigger a shutdown of the connected power amps (if set to 0, the temperature protection is not active
-    byte Trigger2Active;           // 0 = the trigger is not active, 1 = the trigger is active
-    byte Trigger2Type;             // 0 = momentary, 1 = latching
-    byte Trigger2Mode;             // 0 = standard, 1 = intelligent (with measurement of NTC+LDR value)
-    byte Trigger2OnDelay;          // Seconds from controller power up to activation of trigger. The default delay allows time for the output relay of the Mezmerize to be activated before we turn on the power amps. The selection of an input of the Mezmerize will also be delayed.
-    byte Trigger2Temp;             // Temperature protection: if the temperature is measured to the set number of degrees Celcius (via the LDRs), the controller will attempt to trigger a shutdown of the connected power amps (if set to 0, the temperature protection is not active)
+    byte Balance;                  // 0-20 where 10 is centre. Each step below 10 attenuates the right channel 1 dB, each step above 10 attenuates the left channel 1 dB
+    byte IRBindingCount;           // Number of IR codes in IR
+    struct IRBinding IR[IR_BINDINGS]; // IR codes and the keys they are interpreted as. Kept sorted by code (see sortIRBindings()), so a received code can be found by binary search
+    struct InputSettings Input[INPUTS]; // Settings for all inputs
+    struct TriggerSettings Trigger[TRIGGERS]; // Settings for the triggers
     byte TriggerInactOffTimer;     // Hours without user interaction before automatic power down (0 = never)
     byte ScreenSaverActive;        // 0 = the display will stay on/not be dimmed, 1 = the display will be dimmed to the specified level after a specified period of time with no user input
     byte DisplayOnLevel;           // The contrast level of the display when it is on, 0 = 25%, 1 = 50%, 2 = 75%, 3 = 100%
@@ -125,7 +170,7 @@ typedef union {
     byte DisplayTemperature2;      // 0 = do not display the temperature measured by NTC 2, 1 = display in number of degrees Celcious, 2 = display as graphical representation, 3 = display both
     float Version;                 // Used to check if data read from the EEPROM is valid with the compiled version of the compiled code - if not a reset to defaults is necessary and they must be written to the EEPROM
   };
-  byte data[]; // Allows us to be able to write/read settings from EEPROM byte-by-byte (to avoid specific serialization/deserialization code)
+  byte data[0]; // Allows us to be able to write/read settings from EEPROM byte-by-byte (to avoid specific serialization/deserialization code)
 } mySettings;
 
 mySettings Settings; // Holds all the current settings
@@ -137,49 +182,173 @@ typedef union {
     byte CurrentInput;      // The number of the currently set input
     byte CurrentVolume;     // The currently set volume
     bool Muted;             // Indicates if we are in mute mode or not
-    byte InputLastVol[6];   // The last volume set for each input
+    byte InputLastVol[INPUTS]; // The last volume set for each input
     byte PrevSelectedInput; // Holds the input selected before the current one
     float Version;          // Used to check if data read from the EEPROM is valid with the compiled version of the compiled code - if not a reset to defaults is necessary and they must be written to the EEPROM
   };
-  byte data[]; // Allows us to be able to write/read settings from EEPROM byte-by-byte (to avoid specific serialization/deserialization code)
+  byte data[0]; // Allows us to be able to write/read settings from EEPROM byte-by-byte (to avoid specific serialization/deserialization code)
 } myRuntimeSettings;
 
 myRuntimeSettings RuntimeSettings;
 
+// Attenuation in 0.5 dB steps (the resolution of the Muses72320) for each volume step. Built by buildAttenuationTable() when VolumeSteps, MinAttenuation or MaxAttenuation changes
+uint8_t attenuationTable[180];
+
 // Setup Rotary encoders ------------------------------------------------------
-ClickEncoder *encoder1 = new ClickEncoder(8, 7, 6, 4);
-ClickEncoder::Button button1;
-int16_t e1last, e1value;
+// The steps of the encoders are decoded by the pin change interrupts of their pins, the buttons are checked by timerIsr() every PIN_CHANGE_ENCODER_TICK ms
+PinChangeEncoder<8, 7, 6, 4> encoder1;
+int16_t e1pending; // Steps of encoder 1 not yet queued (only used by queueUserInput())
+
+PinChangeEncoder<5, 4, 3, 4> encoder2;
+int16_t e2pending; // Steps of encoder 2 not yet queued (only used by queueUserInput())
 
-ClickEncoder *encoder2 = new ClickEncoder(5, 4, 3, 4);
-ClickEncoder::Button button2;
-int16_t e2last, e2value;
+void queueUserInput(void);
 
 void timerIsr()
 {
-  encoder1->service();
-  encoder2->service();
+  encoder1.service();
+  encoder2.service();
+  queueUserInput();
+}
+
+// Pin 8 (PB0): A of encoder 1
+ISR(PCINT0_vect)
+{
+  encoder1.update();
+}
+
+// Pin 7 (PD7): B of encoder 1, pin 5 and 4 (PD5, PD4): encoder 2 - and the pins waking the MCU from sleep in standby (see sleepUntilWoken())
+ISR(PCINT2_vect)
+{
+  encoder1.update();
+  encoder2.update();
 }
 
 void setupRotaryEncoders()
 {
-  Timer1.initialize(1000);
+  encoder1.begin();
+  encoder2.begin();
+  Timer1.initialize(PIN_CHANGE_ENCODER_TICK * 1000L);
   Timer1.attachInterrupt(timerIsr);
 }
 
 // Setup IR -------------------------------------------------------------------
 #define pinIR 2
-CHashIR IRLremote;
+// NEC and Panasonic remotes are decoded, other remotes are recognised by the hash of their frames. Remove a protocol to learn its remotes by hash instead
+#define IR_PROTOCOLS (IR_PROTOCOL_NEC | IR_PROTOCOL_PANASONIC | IR_PROTOCOL_HASH)
+IRReceiver irReceiver;
+
+// Input events ----------------------------------------------------------------
+// All user input is queued by timerIsr() and taken from the queue by getUserInput(), so no input is lost and the order is kept no matter how long a pass of loop() takes
+RingBuffer<byte, 32> inputEvents;
+// Received IR codes - for every code an EVENT_IR, EVENT_IR_QUICK or EVENT_IR_REPEAT is put in inputEvents, so the code is handled in the order it was received
+RingBuffer<HashIR_data_t, 4> IRCodes;
+#define EVENT_IR_REPEAT 0xFD // A NEC or Panasonic code has been received again because the key is held
+#define EVENT_IR 0xFE        // An IR code has been received
+#define EVENT_IR_QUICK 0xFF  // A hash code has been received less than 100 ms after the previous one
+unsigned long mil_LastIRCode; // Only used by queueUserInput()
 
 // Setup Muses72320 -----------------------------------------------------------
-Muses72320 muses(0);
+// One chip per stereo pair - a multi-channel build adds a chip (with its address set by the ADR pins) and a trim for each further pair. All chips follow the volume, balance and mute of the controller
+#define MUSES_CHIPS 1
+Muses72320 musesChips[MUSES_CHIPS] = {Muses72320(0)};
+// Fixed attenuation of the left and right channel of each chip in 0.5 dB steps (0 or negative)
+const Muses72320::volume_t musesTrims[MUSES_CHIPS][2] PROGMEM = {{0, 0}};
+Muses72320Group muses(musesChips, MUSES_CHIPS);
+// Time in ms used to ramp the volume down/up when muting, unmuting and changing input
+#define VOLUME_RAMP_TIME 50
 
 // Setup Relay Controller------------------------------------------------------
-Adafruit_MCP23008 relayController;
+// The relays are driven by one or more MCP23008 - expander n has address n (A0-A2). The triggers are on the first one
+#define RELAY_EXPANDERS 1
+Adafruit_MCP23008 relayControllers[RELAY_EXPANDERS];
+struct RelayPin
+{
+  byte Expander; // Index in relayControllers
+  byte Pin;      // Pin of the expander
+};
+// The relay of each input
+const RelayPin inputRelays[INPUTS] PROGMEM = {{0, 0}, {0, 1}, {0, 2}, {0, 3}, {0, 4}, {0, 5}};
+#define inputRelayExpander(i) pgm_read_byte(&inputRelays[i].Expander)
+#define inputRelayPin(i) pgm_read_byte(&inputRelays[i].Pin)
 
 // Setup EEPROM ---------------------------------------------------------------
 #define EEPROM_Address 0x50
-extEEPROM eeprom(kbits_64, 1, 32); // Set to use 24C64 Eeprom - if you use another type look in the datasheet for capacity in kbits (kbits_64) and page size in bytes (32)
+#define EEPROM_PAGE_SIZE 32
+extEEPROM eeprom(kbits_64, 1, EEPROM_PAGE_SIZE); // Set to use 24C64 Eeprom - if you use another type look in the datasheet for capacity in kbits (kbits_64) and page size in bytes (32)
+
+// Settings is stored from address 0, so EEPROM page n holds Settings.data[n * EEPROM_PAGE_SIZE] onwards
+// Changes are marked with markSettingsDirty() (bit n = page n) and writeSettingsToEEPROM() only writes the marked pages
+#define SETTINGS_PAGES ((sizeof(mySettings) + EEPROM_PAGE_SIZE - 1) / EEPROM_PAGE_SIZE)
+static_assert(SETTINGS_PAGES <= 16, "settingsDirtyPages has a bit per page of Settings");
+uint16_t settingsDirtyPages = 0;
+// The EEPROM writes are asynchronous - pollEEPROM() is run with this interval (ms) while a write is in progress
+#define EEPROM_POLL_INTERVAL 1
+
+// The RuntimeSettings are saved as a journal of records in the part of the EEPROM not used by Settings and the user defined settings
+// Each record has its own page (so it is written in a single page write) and the records are written round robin to spread the wear over all the pages
+// The sequence numbers of the records are consecutive, so the newest record is the last one of the run of sequence numbers starting in slot 0
+#define JOURNAL_START 0x400
+#define JOURNAL_SLOT_SIZE EEPROM_PAGE_SIZE
+#define JOURNAL_SLOTS ((8192 - JOURNAL_START) / JOURNAL_SLOT_SIZE)
+// Time in ms without changes of volume or input before the RuntimeSettings are saved
+#define RUNTIME_CHECKPOINT_DELAY 5000
+
+struct JournalRecord
+{
+  uint16_t Sequence;
+  byte Data[sizeof(myRuntimeSettings)];
+  byte CRC; // CRC8 of Sequence and Data
+};
+
+static_assert(sizeof(JournalRecord) <= JOURNAL_SLOT_SIZE, "A journal record must fit in one EEPROM page");
+static_assert(2 * sizeof(mySettings) + sizeof(myRuntimeSettings) + 1 <= JOURNAL_START, "The journal overlaps the settings in EEPROM");
+
+uint16_t journalSequence = 0; // Sequence number of the next record written
+uint8_t journalSlot = 0;      // Slot the next record is written to
+JournalRecord journalRecord;  // The record being written (asynchronously, so it must stay unchanged until the EEPROM has got it)
+
+// Setup serial control -------------------------------------------------------
+// The controller can be controlled with binary frames on the serial port (see SerialProtocol.h) and it pushes a SERIAL_EVT_STATE frame whenever power, input, volume or mute changes
+SerialProtocol serialControl(Serial);
+#define SERIAL_BAUD 115200
+// Commands received
+#define SERIAL_CMD_GET_STATE 0x01  // No payload - answered with SERIAL_EVT_STATE
+#define SERIAL_CMD_SET_VOLUME 0x02 // Volume step
+#define SERIAL_CMD_SET_INPUT 0x03  // Input (0 to INPUTS - 1)
+#define SERIAL_CMD_SET_MUTE 0x04   // 1 = mute, 0 = unmute
+#define SERIAL_CMD_SET_POWER 0x05  // 1 = on, 0 = standby
+#define SERIAL_CMD_SET_STATE 0x06  // Input, volume step and mute (1/0) - applied with a single ramp of the volume
+// Frames sent
+#define SERIAL_EVT_ACK 0x80   // Command and status (SERIAL_STATUS_...) - sent for every command except SERIAL_CMD_GET_STATE
+#define SERIAL_EVT_STATE 0x81 // Power (SERIAL_POWER_...), input, volume step and mute (1/0)
+#define SERIAL_STATUS_OK 0
+#define SERIAL_STATUS_UNKNOWN 1 // Unknown command or wrong payload length
+#define SERIAL_STATUS_BUSY 2    // Not possible right now (the menu is in use or the controller is starting up)
+#define SERIAL_STATUS_INVALID 3 // Value out of range or inactivated input
+#define SERIAL_POWER_STANDBY 0
+#define SERIAL_POWER_ON 1
+#define SERIAL_POWER_STARTING 2
+byte serialState[4];            // The state last sent in SERIAL_EVT_STATE
+bool serialStateUnsent = true;  // Set if the state could not be sent or has been asked for
+byte serialAck[2];              // The last SERIAL_EVT_ACK
+bool serialAckUnsent = false;   // Set if serialAck could not be sent
+
+// Profiling -------------------------------------------------------------------
+// Built with PROFILING defined (pio run -e nanoatmega328_profiling) the loop time, the bus traffic and the time of the sections below are recorded by profiler (see Profiler.h)
+// SERIAL_CMD_GET_PROFILE sends all the records as SERIAL_EVT_PROFILE frames: the record index followed by the 32 bit value (least significant byte first)
+#define SERIAL_CMD_GET_PROFILE 0x10
+#define SERIAL_CMD_RESET_PROFILE 0x11
+#define SERIAL_EVT_PROFILE 0x90
+#define PROFILE_SET_VOLUME 0
+#define PROFILE_SET_INPUT 1
+#define PROFILE_DRAW_MENU 2 // drawMenu() - full draws and scrolling
+#define PROFILE_DISPLAY_FLUSH 3
+#define PROFILE_RUNTIME_SAVE 4
+#define PROFILE_SERIAL 5
+#ifdef PROFILING
+byte profileRecordsUnsent = 0; // Records of the dump in progress not yet sent
+#endif
 
 // Setup Display ---------------------------------------------------------------
 OLedI2C oled;
@@ -187,11 +356,43 @@ OLedI2C oled;
 bool ScreenSaverIsOn = false;
 // Used to keep track of the time of the last user interaction (part of the screen saver timing)
 unsigned long mil_LastUserInput = millis();
-// Used to time how often the display of temperatures is updated
-unsigned long mil_onRefreshTemperatureDisplay;
 // Update interval for the display of temperatures
 #define TEMP_REFRESH_INTERVAL 5000
 
+// Setup Task scheduler -------------------------------------------------------
+// Everything that must happen some time from now (end of trigger pulses, the startup countdown, display off in standby etc.) is done by tasks run from loop() - so we never have to block in delay()
+TaskScheduler scheduler;
+
+// Setup triggers --------------------------------------------------------------
+// Every trigger is a relay on the relay board and the NTC sensor of the power amplifier it turns on - a negative temperature means that the amplifier is off (used by SmartON)
+struct TriggerPins
+{
+  byte Relay;  // Pin of the first relay expander
+  byte Sensor; // Analog pin sampled by adcSampler
+};
+const TriggerPins triggerPins[TRIGGERS] PROGMEM = {{6, A0}, {7, A1}};
+#define triggerRelay(t) pgm_read_byte(&triggerPins[t].Relay)
+#define triggerSensor(t) pgm_read_byte(&triggerPins[t].Sensor)
+// Length of the pulses sent to amplifiers with momentary triggers
+#define TRIGGER_ON_PULSE 100
+#define TRIGGER_OFF_PULSE 50
+// Time the relay is kept LOW between two pulses, so a pulse requested while the trigger is in the middle of one becomes a second edge
+#define TRIGGER_PULSE_GAP 100
+// While the amplifiers are on, the temperatures are sampled into thermalMonitor every TEMP_SAMPLE_INTERVAL - the temperature protection acts on
+// the median of the newest samples (or on a rise faster than TEMP_MAX_RISE for THERMAL_RISE_COUNT samples in a row), and the display shows the average of them
+#define TEMP_SAMPLE_INTERVAL 1000
+#define TEMP_MAX_RISE 50 // Tenths of degrees Celcius per minute
+ThermalMonitor thermalMonitor;
+byte temperatureSamples = 0; // Samples since the display of temperatures was refreshed
+#if TRIGGERS > THERMAL_SENSORS
+#error "ThermalMonitor has fewer sensors than there are triggers"
+#endif
+// The triggers are sequenced by the sequenceTriggers task from these deadlines (0 = nothing pending) - triggers with the same deadline are switched together in one write to the relays
+unsigned long triggerOnAt[TRIGGERS];      // millis when the trigger must be turned on
+unsigned long triggerReleaseAt[TRIGGERS]; // millis when the pulse of a momentary trigger ends
+unsigned long triggerPulseAt[TRIGGERS];   // millis when a pulse queued behind the current pulse of a momentary trigger starts
+byte triggerPulseLength[TRIGGERS];        // Length of the queued pulse
+
 //  Initialize the menu
 enum AppModeValues
 {
@@ -199,48 +400,26 @@ enum AppModeValues
   APP_MENU_MODE,
   APP_PROCESS_MENU_CMD,
   APP_STANDBY_MODE,
-  APP_POWERLOSS_STATE
+  APP_POWERLOSS_STATE,
+  APP_STARTUP_MODE
 };
 
 byte appMode = APP_NORMAL_MODE;
 
 MenuManager Menu1(ctlMenu_Root, menuCount(ctlMenu_Root));
 
-// Return null terminated string containing a specific number (count) of specified character (chr) ---
-char *padc(char chr, unsigned char count)
-{
-  static char strbuf[LCD_COLS + 1];
+// Scratch buffer for one line of the display - shared by the screens, which only need it while they draw
+char lineBuf[LCD_COLS + 1];
 
-  count = (count > LCD_COLS) ? LCD_COLS : count;
-
-  int i;
-  for (i = 0; i < count; i++)
-  {
-    strbuf[i] = chr;
-  }
-  strbuf[i] = 0;
-
-  return strbuf;
-}
-
-// Return a string (*dest) that contains the contents of *str padded with a specific character up to a specific length (width but with a maximum of LCD_COLS)
-char *rpad(char *dest, const char *str, char chr, unsigned char width)
-{
-  unsigned char len = strlen(str);
-
-  width = width > LCD_COLS ? LCD_COLS : width;
-
-  if (len < LCD_COLS && width > len)
-  {
-    strcpy(dest, str);
-    strcat(dest, padc(chr, width - len));
-  }
-  else
-  {
-    strncpy(dest, str, width + 1);
-  }
-  return dest;
-}
+// The control path (volume, input, mute, temperatures) only marks the parts of the screen that have changed - renderDisplay()
+// draws the latest state at most once per DISPLAY_FRAME_INTERVAL, so a burst of volume steps costs one redraw and never delays the Muses72320 or the relays
+#define DISPLAY_FRAME_INTERVAL 33 // ms - approx. 30 frames per second
+#define DISPLAY_VOLUME 0x01
+#define DISPLAY_INPUT 0x02
+#define DISPLAY_TEMPERATURES 0x04
+#define DISPLAY_ALL (DISPLAY_VOLUME | DISPLAY_INPUT | DISPLAY_TEMPERATURES)
+byte displayDirty = 0;
+unsigned long mil_LastFrame = 0;
 
 // Enumerated set of possible inputs from the user
 enum UserInput
@@ -253,13 +432,8 @@ enum UserInput
   KEY_RIGHT,   // Rotary 2 turned CW or IR
   KEY_LEFT,    // Rotary 2 turned CCW or IR
   KEY_BACK,    // Rotary 2 switch pressed or IR
-  KEY_1,       // IR
-  KEY_2,       // IR
-  KEY_3,       // IR
-  KEY_4,       // IR
-  KEY_5,       // IR
-  KEY_6,       // IR
-  KEY_MUTE,    // IR
+  KEY_1,       // IR - followed by the keys of the other inputs, the key of input i is KEY_1 + i
+  KEY_MUTE = KEY_1 + INPUTS, // IR
   KEY_ONOFF,   // IR
   KEY_PREVIOUS // IR
 };
@@ -268,114 +442,250 @@ byte UIkey; // holds the last received user input (from rotary encoders or IR)
 byte lastReceivedInput = KEY_NONE;
 unsigned long last_KEY_ONOFF = millis(); // Used to ensure that fast repetition of KEY_ONOFF is not accepted
 void toStandbyMode(void);
+void standbyDisplayOff(void);
+bool readyToSleep(void);
+void sleepUntilWoken(void);
+
+// In standby the MCU sleeps (power-down) when there is nothing left to do - Timer1 and the ADC are stopped while it sleeps
+// It is woken by a pin change of the IR receiver (pin 2), the button of encoder 2 (pin 3) or RX of the serial port (pin 0) and stays awake for STANDBY_AWAKE_TIME to receive the IR code, the double click or the serial command
+// If that is not KEY_ONOFF (or SERIAL_CMD_SET_POWER) it goes back to sleep. The byte of the serial port that wakes it up is lost, so a serial host must repeat a command that is not acknowledged
+#define STANDBY_AWAKE_TIME 1500
+unsigned long mil_Awake; // millis when standby was entered or the MCU was woken up
+
+// Default IR codes (of the Apple remote) - loaded by setSettingsToDefault(). The codes of the input keys are last, only those of the first INPUTS inputs are loaded
+const IRBinding defaultIRBindings[] PROGMEM = {
+  {{0x24, 0x41D976CF}, KEY_ONOFF},
+  {{0x24, 0x3AEA5A5F}, KEY_UP},
+  {{0x24, 0xE64E6057}, KEY_DOWN},
+  {{0x24, 0x4C7A8423}, KEY_LEFT},
+  {{0x24, 0xA1167E2B}, KEY_RIGHT},
+  {{0x24, 0x91998CA3}, KEY_SELECT},
+  {{0x24, 0xE28395C7}, KEY_BACK},
+  {{0x24, 0x41C09D23}, KEY_MUTE},
+  {{0x24, 0x5A3E996B}, KEY_PREVIOUS},
+  {{0x24, 0xC43587C7}, KEY_1},
+  {{0x24, 0x6F998DBF}, KEY_1 + 1},
+  {{0x24, 0xB9947A73}, KEY_1 + 2},
+  {{0x24, 0x64F8806B}, KEY_1 + 3},
+  {{0x24, 0x1FC09E3F}, KEY_1 + 4},
+  {{0x24, 0xCB24A437}, KEY_1 + 5}
+};
+#define DEFAULT_IR_BINDINGS (sizeof(defaultIRBindings) / sizeof(IRBinding) - 6 + min(INPUTS, 6))
 
-// Returns input from the user - enumerated to be the same value no matter if input is from encoders or IR remote
-byte getUserInput()
+// Key whose IR code is being learned by editIRCode() - the current code of the key is ignored meanwhile
+byte learningIRKey = KEY_NONE;
+// The last IR code received by getUserInput() (used when learning new codes)
+HashIR_data_t lastIRCode;
+bool IRCodeReceived = false;
+
+// Compare two IR codes - returns a negative number, 0 or a positive number if a is before, equal to or after b in Settings.IR
+int8_t compareIRCode(const HashIR_data_t &a, const HashIR_data_t &b)
 {
-  byte receivedInput = KEY_NONE;
+  if (a.command != b.command)
+    return (a.command < b.command) ? -1 : 1;
+  if (a.address != b.address)
+    return (a.address < b.address) ? -1 : 1;
+  return 0;
+}
 
-  // Read input from encoder 1
-  e1value += encoder1->getValue();
+// Return the index in Settings.IR of the binding of Code, or -1 if Code is not bound
+int8_t findIRBinding(const HashIR_data_t &Code)
+{
+  int8_t low = 0;
+  int8_t high = Settings.IRBindingCount - 1;
 
-  if (e1value != e1last)
+  while (low <= high)
   {
-    if (e1value > e1last)
-      receivedInput = KEY_UP;
-    if (e1value < e1last)
-      receivedInput = KEY_DOWN;
-    e1last = e1value;
+    int8_t middle = (low + high) / 2;
+    int8_t compared = compareIRCode(Code, Settings.IR[middle].Code);
+    if (compared == 0)
+      return middle;
+    if (compared < 0)
+      high = middle - 1;
+    else
+      low = middle + 1;
   }
+  return -1;
+}
 
-  // Check if button on encoder 1 is clicked
-  button1 = encoder1->getButton();
-  switch (button1)
+// Return the index in Settings.IR of the first binding of Key, or -1 if no code is bound to Key
+int8_t findIRBindingOfKey(byte Key)
+{
+  for (byte i = 0; i < Settings.IRBindingCount; i++)
   {
-  case ClickEncoder::Clicked:
-    receivedInput = KEY_SELECT;
-    break;
-  default:
-    break;
+    if (Settings.IR[i].Key == Key)
+      return i;
   }
+  return -1;
+}
 
-  // Read input from encoder 2
-  e2value += encoder2->getValue();
+// Sort Settings.IR by code (insertion sort - the table is small and almost always sorted already)
+void sortIRBindings()
+{
+  for (byte i = 1; i < Settings.IRBindingCount; i++)
+  {
+    IRBinding binding = Settings.IR[i];
+    int8_t j = i - 1;
+    while (j >= 0 && compareIRCode(Settings.IR[j].Code, binding.Code) > 0)
+    {
+      Settings.IR[j + 1] = Settings.IR[j];
+      j--;
+    }
+    Settings.IR[j + 1] = binding;
+  }
+}
+
+// Bind Code to Key - replacing the code currently bound to Key. Returns false if Code is bound to another key or if there is no room for the binding
+bool bindIRCode(const HashIR_data_t &Code, byte Key)
+{
+  int8_t index = findIRBinding(Code);
+
+  if (index >= 0)
+    return Settings.IR[index].Key == Key;
+
+  index = findIRBindingOfKey(Key);
+  if (index < 0)
+  {
+    if (Settings.IRBindingCount == IR_BINDINGS)
+      return false;
+    index = Settings.IRBindingCount++;
+    Settings.IR[index].Key = Key;
+  }
+  Settings.IR[index].Code = Code;
+  sortIRBindings();
+  markSettingsDirty(&Settings.IRBindingCount, sizeof(Settings.IRBindingCount) + sizeof(Settings.IR));
+  return true;
+}
+
+// Remove the code bound to Key (the table stays sorted)
+void unbindIRKey(byte Key)
+{
+  int8_t index = findIRBindingOfKey(Key);
 
-  if (e2value != e2last)
+  if (index >= 0)
   {
-    if (e2value > e2last)
-      receivedInput = KEY_RIGHT;
-    if (e2value < e2last)
-      receivedInput = KEY_LEFT;
-    e2last = e2value;
+    Settings.IRBindingCount--;
+    for (byte i = index; i < Settings.IRBindingCount; i++)
+      Settings.IR[i] = Settings.IR[i + 1];
+    markSettingsDirty(&Settings.IRBindingCount, sizeof(Settings.IRBindingCount) + sizeof(Settings.IR));
   }
+}
+
+// Return the key Code is bound to (KEY_NONE if Code is not bound)
+byte lookupIRKey(const HashIR_data_t &Code)
+{
+  int8_t index = findIRBinding(Code);
+
+  if (index < 0 || Settings.IR[index].Key == learningIRKey)
+    return KEY_NONE;
+  return Settings.IR[index].Key;
+}
+
+// Queue input from the encoders and the IR remote - called from timerIsr() every PIN_CHANGE_ENCODER_TICK ms
+void queueUserInput()
+{
+  // Every step of the encoders is queued. Steps that there is no room for are kept until next time
+  e1pending += encoder1.getValue();
+  while (e1pending > 0 && inputEvents.push(KEY_UP))
+    e1pending--;
+  while (e1pending < 0 && inputEvents.push(KEY_DOWN))
+    e1pending++;
+
+  // Check if button on encoder 1 is clicked
+  if (encoder1.getButton() == ClickEncoder::Clicked)
+    inputEvents.push(KEY_SELECT);
+
+  e2pending += encoder2.getValue();
+  while (e2pending > 0 && inputEvents.push(KEY_RIGHT))
+    e2pending--;
+  while (e2pending < 0 && inputEvents.push(KEY_LEFT))
+    e2pending++;
 
   // Check if button on encoder 2 is clicked
-  button2 = encoder2->getButton();
-  switch (button2)
+  switch (encoder2.getButton())
   {
   case ClickEncoder::Clicked:
-    receivedInput = KEY_BACK;
+    inputEvents.push(KEY_BACK);
     break;
   case ClickEncoder::DoubleClicked:
-    receivedInput = KEY_ONOFF;
+    inputEvents.push(KEY_ONOFF);
     break;
   default:
     break;
   }
 
-  // Check if any input from the IR remote
-  if (IRLremote.available())
+  // Check if any input from the IR remote - it is left in the receiver if there is no room for it
+  if (irReceiver.available() && !IRCodes.isFull() && !inputEvents.isFull())
   {
-    // Get the new data from the remote
-    auto data = IRLremote.read();
-
-    //Often the IR remote is to sensitive, reset reading if its to fast, but only if IR code is not REPEAT
-    if (millis() - mil_LastUserInput < 100 && (data.address != Settings.IR_REPEAT.address && data.command != Settings.IR_REPEAT.command)) {
-      data.address = 0;
-      data.command = 0;
-      receivedInput = KEY_NONE;
-    }
+    unsigned long now = millis();
+    HashIR_data_t code = irReceiver.read();
+
+    IRCodes.push(code);
+    if (irReceiver.repeated())
+      inputEvents.push(EVENT_IR_REPEAT);
+    else if (code.address < IR_ADDRESS_PANASONIC && now - mil_LastIRCode < 100) // Only hash codes can be noise
+      inputEvents.push(EVENT_IR_QUICK);
     else
-    // Map the received IR input to UserInput values
-    if (data.address == Settings.IR_UP.address && data.command == Settings.IR_UP.command)
-      receivedInput = KEY_UP;
-    else if (data.address == Settings.IR_DOWN.address && data.command == Settings.IR_DOWN.command)
-      receivedInput = KEY_DOWN;
-    else if (data.address == Settings.IR_LEFT.address && data.command == Settings.IR_LEFT.command)
-      receivedInput = KEY_LEFT;
-    else if (data.address == Settings.IR_RIGHT.address && data.command == Settings.IR_RIGHT.command)
-      receivedInput = KEY_RIGHT;
-    else if (data.address == Settings.IR_SELECT.address && data.command == Settings.IR_SELECT.command)
-      receivedInput = KEY_SELECT;
-    else if (data.address == Settings.IR_BACK.address && data.command == Settings.IR_BACK.command)
-      receivedInput = KEY_BACK;
-    else if (data.address == Settings.IR_MUTE.address && data.command == Settings.IR_MUTE.command)
-      receivedInput = KEY_MUTE;
-    else if (data.address == Settings.IR_ONOFF.address && data.command == Settings.IR_ONOFF.command)
-      receivedInput = KEY_ONOFF;
-    else if (data.address == Settings.IR_1.address && data.command == Settings.IR_1.command)
-      receivedInput = KEY_1;
-    else if (data.address == Settings.IR_2.address && data.command == Settings.IR_2.command)
-      receivedInput = KEY_2;
-    else if (data.address == Settings.IR_3.address && data.command == Settings.IR_3.command)
-      receivedInput = KEY_3;
-    else if (data.address == Settings.IR_4.address && data.command == Settings.IR_4.command)
-      receivedInput = KEY_4;
-    else if (data.address == Settings.IR_5.address && data.command == Settings.IR_5.command)
-      receivedInput = KEY_5;
-    else if (data.address == Settings.IR_6.address && data.command == Settings.IR_6.command)
-      receivedInput = KEY_6;
-    else if (data.address == Settings.IR_PREVIOUS.address && data.command == Settings.IR_PREVIOUS.command)
-      receivedInput = KEY_PREVIOUS;
-    else if (data.address == Settings.IR_REPEAT.address && data.command == Settings.IR_REPEAT.command)
+      inputEvents.push(EVENT_IR);
+    mil_LastIRCode = now;
+  }
+}
+
+// Map a received IR code to UserInput values - event is the EVENT_IR, EVENT_IR_QUICK or EVENT_IR_REPEAT queued with the code
+byte decodeIRCode(byte event, const HashIR_data_t &data)
+{
+  byte key = lookupIRKey(data);
+
+  // Only the volume keys repeat while they are held
+  if (event == EVENT_IR_REPEAT)
+    return (key == KEY_UP || key == KEY_DOWN) ? key : (byte)KEY_NONE;
+  //Often the IR remote is to sensitive, reset reading if its to fast, but only if IR code is not REPEAT
+  if (event == EVENT_IR_QUICK && key != KEY_REPEAT)
+    return KEY_NONE;
+  if (key == KEY_REPEAT && (lastReceivedInput == KEY_UP || lastReceivedInput == KEY_DOWN))
+    return lastReceivedInput;
+  return key;
+}
+
+// Returns the input getUserInput() will return next (without removing it from the queue)
+byte peekUserInput()
+{
+  byte event;
+  HashIR_data_t data;
+
+  if (!inputEvents.peek(event))
+    return KEY_NONE;
+  if (event < EVENT_IR_REPEAT)
+    return event;
+  IRCodes.peek(data);
+  return decodeIRCode(event, data);
+}
+
+// Returns input from the user - enumerated to be the same value no matter if input is from encoders or IR remote
+byte getUserInput()
+{
+  byte receivedInput = KEY_NONE;
+  byte event;
+
+  if (inputEvents.pop(event))
+  {
+    if (event >= EVENT_IR_REPEAT)
     {
-      receivedInput = KEY_REPEAT;
-      if (lastReceivedInput == KEY_UP)
-        receivedInput = KEY_UP;
-      else if (lastReceivedInput == KEY_DOWN)
-        receivedInput = KEY_DOWN;
+      // Get the new data from the remote
+      HashIR_data_t data;
+      IRCodes.pop(data);
+
+      if (event != EVENT_IR_REPEAT)
+      {
+        lastIRCode = data;
+        IRCodeReceived = true;
+      }
+
+      receivedInput = decodeIRCode(event, data);
+      lastReceivedInput = receivedInput;
     }
-    lastReceivedInput = receivedInput;
+    else
+      receivedInput = event;
   }
 
   // Cancel received KEY_ONOFF if it has been received before within the last 5 seconds
@@ -387,10 +697,7 @@ byte getUserInput()
     {
       last_KEY_ONOFF = millis();
       if (appMode != APP_STANDBY_MODE)
-      {
-        appMode = APP_STANDBY_MODE;
         toStandbyMode();
-      }
       else // wake from standby
         startUp();
     }
@@ -422,243 +729,333 @@ byte getUserInput()
 
   // If inactivity timer is set, go to standby if the set number of hours have passed since last user input
   if ((appMode != APP_STANDBY_MODE) && (Settings.TriggerInactOffTimer > 0) && ((mil_LastUserInput + Settings.TriggerInactOffTimer * 3600000) < millis()))
-  {
-    appMode = APP_STANDBY_MODE;
     toStandbyMode();
-  }
   
   return (receivedInput);
 }
 
+// Returns the number of volume steps (negative if down) of key (KEY_UP or KEY_DOWN) and the volume keys queued right after it
+// The queued keys are taken from the queue, so a fast spin of the encoder or a burst of IR repeats gives one change of the volume
+int16_t collectVolumeSteps(byte key)
+{
+  int16_t steps = (key == KEY_UP) ? 1 : -1;
+  byte next;
+
+  while ((next = peekUserInput()) == KEY_UP || next == KEY_DOWN)
+    steps += (getUserInput() == KEY_UP) ? 1 : -1;
+  return steps;
+}
+
 // Lets get started ----------------------------------------------------------------------------------------
 void setup()
 {
   pinMode(A1, INPUT);
   pinMode(A2, INPUT);
 
-  //Serial.begin(115200);
-  Wire.begin();
-  relayController.begin();
-
-  setupRotaryEncoders();
-  IRLremote.begin(pinIR);
+  serialControl.begin(SERIAL_BAUD);
+#ifdef PROFILING
+  profiler.setDevice(0, 0x3c); // OLED
+  profiler.setDevice(1, MCP23008_ADDRESS);
+  profiler.setDevice(2, EEPROM_Address);
+#endif
+  i2cBus.begin(); // The only place the I2C clock is set - the display, the relay expanders and the EEPROM share the bus through i2cBus
+  // The display is powered up by the powerUpDisplay task - its power stabilization delays are spent reading the settings and setting up the relays and the Muses72320, and what startUp() prints is drawn when it is up
+  scheduler.schedule(powerUpDisplay, oled.beginPowerUp());
+  for (byte i = 0; i < RELAY_EXPANDERS; i++)
+    relayControllers[i].begin(i);
+  eeprom.begin();
+
+  irReceiver.begin(pinIR, IR_PROTOCOLS);
+  setupRotaryEncoders(); // Also starts the queueing of user input (from timerIsr), so it must be done after irReceiver.begin
+  adcSampler.begin(A0, A1);
+  adcSampler.setPowerLossWindow(3000, 4600);
+  loadSettings();
   muses.begin();
-  oled.begin();
+  for (byte i = 0; i < MUSES_CHIPS; i++)
+    musesChips[i].setTrim(pgm_read_word(&musesTrims[i][0]), pgm_read_word(&musesTrims[i][1]));
+  muses.setZeroCrossing(true);
+  setBalance();
 
   startUp();
 }
 
-void startUp()
+// Do the next step of the power up of the display when its power has stabilized
+void powerUpDisplay()
 {
-  oled.lcdOn();
+  uint8_t wait = oled.continuePowerUp();
 
-  // Define all pins as OUTPUT and disable all relais
-  for (byte pin = 0; pin <= 7; pin++)
-  {
-    relayController.pinMode(pin, OUTPUT);
-    relayController.digitalWrite(pin, LOW);
-  }
+  if (wait)
+    scheduler.schedule(powerUpDisplay, wait);
+}
 
+// Read Settings and RuntimeSettings from the EEPROM - only done by setup(), as they are kept in RAM in standby and when the power returns after a power loss
+void loadSettings()
+{
   readSettingsFromEEPROM();
   readRuntimeSettingsFromEEPROM();
 
-  // Check if settings stored in EEPROM are INVALID - if so, we write the default settings to the EEPROM and reboots
-  if ((Settings.Version != VERSION) || (RuntimeSettings.Version != VERSION))
+  // Check if settings stored in EEPROM are INVALID - if so, we write the default settings to the EEPROM
+  // VERSION is compared as a float, as it is stored (it is a double on the native build)
+  if ((Settings.Version != (float)VERSION) || (RuntimeSettings.Version != (float)VERSION))
   {
+    // The message must be seen, so the power up of the display is finished first
+    for (uint8_t wait = oled.continuePowerUp(); wait != 0; wait = oled.continuePowerUp())
+      delay(wait);
     oled.clear();
     oled.setCursor(0, 0);
     oled.print(F("Restoring default"));
     oled.setCursor(0, 1);
     oled.print(F("settings..."));
+    oled.flush();
     delay(2000);
     writeDefaultSettingsToEEPROM();
   }
+}
+
+// Start (or restart from standby or after a power loss) with the Settings and RuntimeSettings in RAM
+void startUp()
+{
+  scheduler.cancel(standbyDisplayOff);
+  oled.lcdOn();
+
+  // Define all pins as OUTPUT and disable all relais - except a trigger that is in the middle of a pulse (it is released by its task)
+  byte relayMask = 0xFF;
+  for (byte i = 0; i < TRIGGERS; i++)
+  {
+    if (triggerReleaseAt[i])
+      relayMask &= ~(1 << triggerRelay(i));
+  }
+  for (byte i = 0; i < RELAY_EXPANDERS; i++)
+  {
+    relayControllers[i].writeIODIR(0x00);
+    relayControllers[i].writeMask(i == 0 ? relayMask : 0xFF, 0x00);
+  }
 
-  // Settings read from EEPROM are read and are valid so let's move on!
+  buildAttenuationTable();
   mil_On = millis();
   oled.backlight((Settings.DisplayOnLevel + 1) * 64 - 1);
-  // If triggers are active then wait for the set number of seconds and turn them on
-  unsigned long delayTrigger1 = (Settings.Trigger1Active) ? (mil_On + Settings.Trigger1OnDelay * 1000) : 0;
-  unsigned long delayTrigger2 = (Settings.Trigger2Active) ? (mil_On + Settings.Trigger2OnDelay * 1000) : 0;
 
-  if (delayTrigger1 || delayTrigger2)
+  UIkey = KEY_NONE;
+  lastReceivedInput = KEY_NONE;
+
+  // If triggers are active then wait for the set number of seconds and turn them on
+  if (startTriggers())
   {
     oled.clear();
     oled.print(F("Wait..."));
+    // The countdown is run by the scheduler, so loop() keeps running (and the user can go back to standby) while we wait
+    appMode = APP_STARTUP_MODE;
+    scheduler.schedule(startUpCountdown, 0, 100);
   }
+  else
+    finishStartUp();
+}
 
-  while (delayTrigger1 || delayTrigger2)
+// Show the remaining seconds until the triggers are turned on (by sequenceTriggers) and finish the startup when they have been
+void startUpCountdown()
+{
+  bool waiting = false;
+
+  for (byte i = 0; i < TRIGGERS; i++)
   {
-    if (millis() > delayTrigger1 && delayTrigger1 != 0)
-    {
-      setTrigger1On();
-      delayTrigger1 = 0;
-      oled.print3x3Number(2, 1, 0, false);
-    }
-    else
-    {
-      if (Settings.Trigger1Active && delayTrigger1 != 0)
-        oled.print3x3Number(2, 1, (delayTrigger1 - millis()) / 1000, false);
-    }
+    long remaining = triggerOnAt[i] - millis();
 
-    if (millis() > delayTrigger2 && delayTrigger2 != 0)
-    {
-      setTrigger2On();
-      delayTrigger2 = 0;
-      oled.print3x3Number(11, 1, 0, false);
-    }
-    else
-    {
-      if (Settings.Trigger2Active && delayTrigger2 != 0)
-        oled.print3x3Number(11, 1, (delayTrigger2 - millis()) / 1000, false);
-    }
+    if (triggerOnAt[i])
+      waiting = true;
+    if (i < 2 && Settings.Trigger[i].Active) // There is room for the countdown of two triggers on the display
+      oled.print3x3Number(2 + 9 * i, 1, (triggerOnAt[i] && remaining > 0) ? remaining / 1000 : 0, false);
   }
 
+  if (!waiting)
+  {
+    scheduler.cancel(startUpCountdown);
+    finishStartUp();
+  }
+}
+
+// Select the input and set the volume when the triggers have been turned on
+void finishStartUp()
+{
   oled.clear();
-  setInput(RuntimeSettings.CurrentInput);
   RuntimeSettings.CurrentVolume = min(RuntimeSettings.InputLastVol[RuntimeSettings.CurrentInput], Settings.MaxStartVolume); // Avoid setting volume higher than MaxStartVol
-  unmute();
-  displayInput();
-  displayTemperatures();
+  setInput(RuntimeSettings.CurrentInput); // Turns the relay of the input on and unmutes the volume
+  markDisplayDirty(DISPLAY_ALL);
 
-  UIkey = KEY_NONE;
-  lastReceivedInput = KEY_NONE;
   appMode = APP_NORMAL_MODE;
+
+  // The first sample is taken right away, so the temperatures are displayed (and protected) from the start
+  thermalMonitor.begin(TEMP_SAMPLE_INTERVAL, TEMP_MAX_RISE);
+  temperatureSamples = 0;
+  scheduler.schedule(sampleTemperatures, TEMP_SAMPLE_INTERVAL, TEMP_SAMPLE_INTERVAL);
+  sampleTemperatures();
 }
 
-void setTrigger1On()
+// Set the turn on deadlines of the active triggers from their on delay. Returns true if there is a trigger to wait for
+bool startTriggers()
 {
-  if (Settings.Trigger1Active)
+  bool pending = false;
+
+  for (byte i = 0; i < TRIGGERS; i++)
   {
-    if (Settings.Trigger1Mode == 0) // Standard
-    {
-      relayController.digitalWrite(6, HIGH);
-      if (Settings.Trigger1Type == 0) // Momentary
-      {
-        delay(100);
-        relayController.digitalWrite(6, LOW);
-      }
-    }
-    else // SmartON
-    {
-      if (getTemperature(A0) < 0) // Check if device is powered off
-      {
-        relayController.digitalWrite(6, HIGH);
-        if (Settings.Trigger1Type == 0) // Momentary
-        {
-          delay(100);
-          relayController.digitalWrite(6, LOW);
-        }
-      }
-    }
+    triggerOnAt[i] = Settings.Trigger[i].Active ? mil_On + Settings.Trigger[i].OnDelay * 1000UL : 0;
+    if (triggerOnAt[i])
+      pending = true;
   }
+  if (pending)
+    sequenceTriggers();
+  return pending;
 }
 
-void setTrigger2On()
+// Turn off the triggers that have been turned on - a trigger still waiting for its turn on delay has not been turned on, so it must not be turned off
+void stopTriggers()
 {
-  if (Settings.Trigger2Active)
+  byte triggers = 0;
+
+  for (byte i = 0; i < TRIGGERS; i++)
   {
-    if (Settings.Trigger2Mode == 0) // Standard
-    {
-      relayController.digitalWrite(7, HIGH);
-      if (Settings.Trigger2Type == 0) // Momentary
-      {
-        delay(100);
-        relayController.digitalWrite(7, LOW);
-      }
-    }
-    else // SmartON
-    {
-      if (getTemperature(A1) < 0) // Check if device is powered off
-      {
-        relayController.digitalWrite(7, HIGH);
-        if (Settings.Trigger2Type == 0) // Momentary
-        {
-          delay(100);
-          relayController.digitalWrite(7, LOW);
-        }
-      }
-    }
+    if (triggerOnAt[i] == 0)
+      triggers |= 1 << i;
+    triggerOnAt[i] = 0;
   }
+  switchTriggers(triggers, false);
+  sequenceTriggers();
+}
+
+// Returns true if trigger t must be switched on (or off) - a SmartON trigger is not switched if its sensor shows that the power amplifier already is on (or off)
+bool triggerNeeded(byte t, bool on)
+{
+  const TriggerSettings &trigger = Settings.Trigger[t];
+
+  if (!trigger.Active)
+    return false;
+  if (trigger.Mode == 0) // Standard
+    return true;
+  int16_t temp = getTemperature(triggerSensor(t));
+  return on ? temp < 0 : temp > 0;
 }
 
-void setTrigger1Off()
+// Switch the triggers in the bit mask triggers on (or off) in one write to the relays
+// Momentary triggers are pulsed: the relay is set HIGH and sequenceTriggers releases it when the pulse has lasted long enough
+// A trigger in the middle of a pulse must see a second edge, so the new pulse is queued to be started by sequenceTriggers TRIGGER_PULSE_GAP after the release
+void switchTriggers(byte triggers, bool on)
 {
-  if (Settings.Trigger1Active)
+  unsigned long now = millis();
+  byte mask = 0;
+  byte value = 0;
+
+  for (byte i = 0; i < TRIGGERS; i++)
   {
-    if (Settings.Trigger1Mode == 0) // Standard
-    {
-      if (Settings.Trigger1Type == 0) // Momentary
-      {
-        relayController.digitalWrite(6, HIGH);
-        delay(50);
-      }
-      relayController.digitalWrite(6, LOW);
-    }
-    else // SmartON
+    if ((triggers & (1 << i)) && triggerNeeded(i, on))
     {
-      if (getTemperature(A0) > 0) // Check if device is powered on
+      byte relay = 1 << triggerRelay(i);
+
+      if (Settings.Trigger[i].Type == 0) // Momentary
       {
-        if (Settings.Trigger1Type == 0) // Momentary
+        byte length = on ? TRIGGER_ON_PULSE : TRIGGER_OFF_PULSE;
+
+        if (triggerReleaseAt[i] || triggerPulseAt[i])
         {
-          relayController.digitalWrite(6, HIGH);
-          delay(50);
+          if (!triggerPulseAt[i])
+            triggerPulseAt[i] = triggerReleaseAt[i] + TRIGGER_PULSE_GAP;
+          triggerPulseLength[i] = length;
+          continue;
         }
-        relayController.digitalWrite(6, LOW);
+        value |= relay;
+        triggerReleaseAt[i] = now + length;
       }
+      else if (on)
+        value |= relay;
+      mask |= relay;
     }
   }
+  if (mask)
+    relayControllers[0].writeMask(mask, value);
 }
 
-void setTrigger2Off()
+// Task: turn on the triggers and end the pulses that are due, and reschedule itself for the next deadline
+void sequenceTriggers()
 {
-  if (Settings.Trigger2Active)
+  unsigned long now = millis();
+  unsigned long next = 0;
+  byte released = 0;
+  byte pulsed = 0;
+  byte due = 0;
+
+  for (byte i = 0; i < TRIGGERS; i++)
   {
-    if (Settings.Trigger2Mode == 0) // Standard
+    if (triggerReleaseAt[i] && (long)(now - triggerReleaseAt[i]) >= 0)
     {
-      if (Settings.Trigger2Type == 0) // Momentary
-      {
-        relayController.digitalWrite(7, HIGH);
-        delay(50);
-      }
-      relayController.digitalWrite(7, LOW);
+      released |= 1 << triggerRelay(i);
+      triggerReleaseAt[i] = 0;
+      // Keep the gap before a queued pulse, also if this task runs late
+      if (triggerPulseAt[i] && (long)(now + TRIGGER_PULSE_GAP - triggerPulseAt[i]) > 0)
+        triggerPulseAt[i] = now + TRIGGER_PULSE_GAP;
     }
-    else // SmartON
+    else if (triggerPulseAt[i] && (long)(now - triggerPulseAt[i]) >= 0)
     {
-      if (getTemperature(A1) > 0) // Check if device is powered on
-      {
-        if (Settings.Trigger2Type == 0) // Momentary
-        {
-          relayController.digitalWrite(7, HIGH);
-          delay(50);
-        }
-        relayController.digitalWrite(7, LOW);
-      }
+      pulsed |= 1 << triggerRelay(i);
+      triggerReleaseAt[i] = now + triggerPulseLength[i];
+      triggerPulseAt[i] = 0;
+    }
+    if (triggerOnAt[i] && (long)(now - triggerOnAt[i]) >= 0)
+    {
+      due |= 1 << i;
+      triggerOnAt[i] = 0;
     }
   }
+  if (released | pulsed)
+    relayControllers[0].writeMask(released | pulsed, pulsed);
+  switchTriggers(due, true);
+
+  for (byte i = 0; i < TRIGGERS; i++)
+  {
+    if (triggerOnAt[i] && (next == 0 || (long)(triggerOnAt[i] - next) < 0))
+      next = triggerOnAt[i];
+    if (triggerReleaseAt[i] && (next == 0 || (long)(triggerReleaseAt[i] - next) < 0))
+      next = triggerReleaseAt[i];
+    if (triggerPulseAt[i] && (next == 0 || (long)(triggerPulseAt[i] - next) < 0))
+      next = triggerPulseAt[i];
+  }
+  if (next)
+    scheduler.schedule(sequenceTriggers, next - now);
+  else
+    scheduler.cancel(sequenceTriggers);
 }
 
-uint8_t getAttenuation(uint8_t steps, uint8_t selStep, uint8_t min_dB, uint8_t max_dB)
+// Calculate the attenuation of every volume step from the current settings
+// The attenuation range is divided into large steps at the low end and small steps (half the size) closest to the highest volume. The large steps are the largest power of two dB that allows all steps to fit in the range
+void buildAttenuationTable()
 {
-  //Serial.print("Antal steps: "); Serial.println(steps);
-  //Serial.print("Valgt steps: "); Serial.println(selStep);
-  //Serial.print("Min dB: "); Serial.println(min_dB);
-  //Serial.print("Max dB: "); Serial.println(max_dB);
-  uint8_t att_dB = max_dB - min_dB;
-  float sizeOfLargeSteps = round(pow(2.0, att_dB / steps) - 0.5);
-  uint8_t numberOfSmallSteps = (sizeOfLargeSteps * steps - att_dB) / (sizeOfLargeSteps / 2);
-  //Serial.print("Attenuation: "); Serial.println(min((min_dB + min(steps - selStep, numberOfSmallSteps) * (sizeOfLargeSteps / 2) + max(steps - numberOfSmallSteps - selStep, 0) * sizeOfLargeSteps), max_dB) * 2); 
-  return min((min_dB + min(steps - selStep, numberOfSmallSteps) * (sizeOfLargeSteps / 2) + max(steps - numberOfSmallSteps - selStep, 0) * sizeOfLargeSteps), max_dB) * -2;
+  uint8_t att_dB = Settings.MaxAttenuation - Settings.MinAttenuation;
+  uint8_t shift = min(att_dB / Settings.VolumeSteps, 8); // Larger steps than 256 dB would all end at MaxAttenuation anyway
+  uint16_t sizeOfSmallSteps = 1 << shift;               // In 0.5 dB, so this is half the size of the large steps in dB
+  uint16_t numberOfSmallSteps = ((uint32_t)sizeOfSmallSteps * Settings.VolumeSteps - att_dB) * 2 >> shift;
+
+  for (uint8_t step = 0; step <= Settings.VolumeSteps; step++)
+  {
+    uint16_t stepsFromTop = Settings.VolumeSteps - step;
+    uint32_t attenuation = Settings.MinAttenuation * 2 + (uint32_t)min(stepsFromTop, numberOfSmallSteps) * sizeOfSmallSteps;
+    if (stepsFromTop > numberOfSmallSteps)
+      attenuation += (uint32_t)(stepsFromTop - numberOfSmallSteps) * sizeOfSmallSteps * 2;
+    attenuationTable[step] = min(attenuation, (uint32_t)Settings.MaxAttenuation * 2);
+  }
 }
 
-void setVolume(int16_t newVolumeStep)
+// Return the attenuation in 0.5 dB steps of a volume step
+uint8_t getAttenuation(uint8_t step)
 {
+  return attenuationTable[min(step, Settings.VolumeSteps)];
+}
+
+// Set the volume step - if rampTime is given the Muses72320 moves to the new level over that many ms instead of jumping to it
+void setVolume(int16_t newVolumeStep, uint16_t rampTime)
+{
+  PROFILE_SECTION(PROFILE_SET_VOLUME);
   if (newVolumeStep < Settings.Input[RuntimeSettings.CurrentInput].MinVol)
     newVolumeStep = Settings.Input[RuntimeSettings.CurrentInput].MinVol;
   else if (newVolumeStep > Settings.Input[RuntimeSettings.CurrentInput].MaxVol)
     newVolumeStep = Settings.Input[RuntimeSettings.CurrentInput].MaxVol;
 
-  // TO DO call muses incl. balance logic
   if (!RuntimeSettings.Muted)
   {
     if (Settings.Input[RuntimeSettings.CurrentInput].Active != INPUT_HT_PASSTHROUGH)
@@ -666,24 +1063,46 @@ void setVolume(int16_t newVolumeStep)
     else
       RuntimeSettings.CurrentVolume = Settings.Input[RuntimeSettings.CurrentInput].MaxVol; // Set to max volume
     RuntimeSettings.InputLastVol[RuntimeSettings.CurrentInput] = RuntimeSettings.CurrentVolume;
-    muses.setVolume(getAttenuation(Settings.VolumeSteps, RuntimeSettings.CurrentVolume, Settings.MinAttenuation, Settings.MaxAttenuation));
-    displayVolume();
+    scheduler.schedule(checkpointRuntimeSettings, RUNTIME_CHECKPOINT_DELAY);
+    if (rampTime)
+      muses.rampTo(-getAttenuation(RuntimeSettings.CurrentVolume), rampTime);
+    else
+      muses.setVolume(-getAttenuation(RuntimeSettings.CurrentVolume));
+    markDisplayDirty(DISPLAY_VOLUME);
   }
 }
 
+// Apply Settings.Balance as attenuation offsets of the channels - the Muses72320 library only writes the channel that changes
+void setBalance()
+{
+  if (Settings.Balance < 10)
+    muses.setOffset(0, -(10 - Settings.Balance) * 2);
+  else
+    muses.setOffset(-(Settings.Balance - 10) * 2, 0);
+}
+
+// Mute and unmute ramp the volume (with zero crossing detection enabled in the Muses72320) to avoid clicks
 void mute()
 {
   if (Settings.MuteLevel)
-    muses.setVolume(getAttenuation(Settings.VolumeSteps, Settings.MuteLevel, Settings.MinAttenuation, Settings.MaxAttenuation));
+    muses.rampTo(-getAttenuation(Settings.MuteLevel), VOLUME_RAMP_TIME);
   else
-    muses.mute();
+    muses.rampTo(-getAttenuation(0), VOLUME_RAMP_TIME, true);
   RuntimeSettings.Muted = true;
+  pendingInputUnmute = false; // Stays muted on an input being switched to
+  scheduler.schedule(checkpointRuntimeSettings, RUNTIME_CHECKPOINT_DELAY);
 }
 
 void unmute()
 {
+  // The old input must not be heard while an input change is pending - unmuted when the relays have been switched
+  if (pendingInput != INPUT_NONE)
+  {
+    pendingInputUnmute = true;
+    return;
+  }
   RuntimeSettings.Muted = false;
-  setVolume(RuntimeSettings.CurrentVolume);
+  setVolume(RuntimeSettings.CurrentVolume, VOLUME_RAMP_TIME);
 }
 
 void displayVolume()
@@ -708,7 +1127,7 @@ void displayVolume()
       {
         oled.setCursor(17, 0);
         oled.print(F("-dB"));
-        oled.print3x3Number(10, 1, (getAttenuation(Settings.VolumeSteps, RuntimeSettings.CurrentVolume, Settings.MinAttenuation, Settings.MaxAttenuation) / 2) * 10, true); // Display volume as -dB - RuntimeSettings.CurrentAttennuation are converted to -dB and multiplied by 10 to be able to show 0.5 dB steps
+        oled.print3x3Number(10, 1, getAttenuation(RuntimeSettings.CurrentVolume) * 5, true); // Display volume as -dB - the attenuation in 0.5 dB steps is multiplied by 5 to get tenths of a dB to be able to show 0.5 dB steps
       }
     }
     else
@@ -716,6 +1135,33 @@ void displayVolume()
   }
 }
 
+// Mark parts of the normal screen for redraw - the render task is scheduled for the next frame slot unless it is already pending
+void markDisplayDirty(byte parts)
+{
+  displayDirty |= parts;
+  if (!scheduler.isScheduled(renderDisplay))
+  {
+    unsigned long sinceLastFrame = millis() - mil_LastFrame;
+    scheduler.schedule(renderDisplay, sinceLastFrame >= DISPLAY_FRAME_INTERVAL ? 0 : DISPLAY_FRAME_INTERVAL - sinceLastFrame);
+  }
+}
+
+// Task: draw the parts of the normal screen marked by markDisplayDirty() - the buffer is sent to the display by oled.flush() at the end of loop()
+void renderDisplay()
+{
+  if (appMode != APP_NORMAL_MODE)
+    return; // Parts stay marked - the screen is redrawn in full when returning to APP_NORMAL_MODE anyway
+
+  mil_LastFrame = millis();
+  if (displayDirty & DISPLAY_INPUT)
+    displayInput();
+  if (displayDirty & DISPLAY_VOLUME)
+    displayVolume();
+  if (displayDirty & DISPLAY_TEMPERATURES)
+    displayTemperatures();
+  displayDirty = 0;
+}
+
 // Clear previously displayed volume steps/-dB to indicate that mute is selected
 void displayMute()
 {
@@ -727,36 +1173,79 @@ void displayMute()
   }
 }
 
-boolean setInput(uint8_t NewInput)
-{  
-  if (Settings.Input[NewInput].Active != INPUT_INACTIVATED && NewInput >= 0 && NewInput <= 5)
+// Select NewInput - the volume is muted and the relays are switched by the switchInput task when the volume has ramped down, so loop() keeps running
+// The volume is unmuted on the new input unless unmuteAfter is false. Returns false if NewInput is not valid
+boolean setInput(uint8_t NewInput, bool unmuteAfter)
+{
+  PROFILE_SECTION(PROFILE_SET_INPUT);
+  if (NewInput < INPUTS && Settings.Input[NewInput].Active != INPUT_INACTIVATED)
   {
-      if (!RuntimeSettings.Muted)
-        mute();
+    if (!RuntimeSettings.Muted)
+      mute();
+    // A change already pending just gets a new target - the relays are only switched once
+    pendingInput = NewInput;
+    pendingInputUnmute = unmuteAfter;
+    scheduler.schedule(switchInput, 0);
+    return true;
+  }
+  return false;
+}
 
-      //Unselect currently selected input
-      relayController.digitalWrite(RuntimeSettings.CurrentInput, LOW);
+// Task: switch to pendingInput when the volume has ramped down
+void switchInput()
+{
+  if (muses.isRamping())
+  {
+    scheduler.schedule(switchInput, 1);
+    return;
+  }
+
+  byte NewInput = pendingInput;
+  pendingInput = INPUT_NONE;
+  switchInputRelays(RuntimeSettings.CurrentInput, NewInput);
+
+  if (NewInput != RuntimeSettings.CurrentInput)
+  {
+    // Save the currently selected input to enable switching between two inputs
+    RuntimeSettings.PrevSelectedInput = RuntimeSettings.CurrentInput;
+
+    //Select new input
+    RuntimeSettings.CurrentInput = NewInput;
+
+    if (Settings.RecallSetLevel)
+      RuntimeSettings.CurrentVolume = RuntimeSettings.InputLastVol[RuntimeSettings.CurrentInput];
+    else if (RuntimeSettings.CurrentVolume > Settings.Input[RuntimeSettings.CurrentInput].MaxVol)
+      RuntimeSettings.CurrentVolume = Settings.Input[RuntimeSettings.CurrentInput].MaxVol;
+    else if (RuntimeSettings.CurrentVolume < Settings.Input[RuntimeSettings.CurrentInput].MinVol)
+      RuntimeSettings.CurrentVolume = Settings.Input[RuntimeSettings.CurrentInput].MinVol;
+  }
+  if (pendingInputUnmute)
+    unmute();
+  markDisplayDirty(DISPLAY_INPUT | DISPLAY_VOLUME);
+}
 
-      // Save the currently selected input to enable switching between two inputs
-      RuntimeSettings.PrevSelectedInput = RuntimeSettings.CurrentInput;
+// Returns the input selected - the one being switched to while an input change is pending
+byte selectedInput()
+{
+  return (pendingInput != INPUT_NONE) ? pendingInput : RuntimeSettings.CurrentInput;
+}
 
-      //Select new input
-      RuntimeSettings.CurrentInput = NewInput;
-      relayController.digitalWrite(NewInput, HIGH);
+// Release the relay of input from and activate the relay of input to - the old relay is released before the new one is activated
+// Both are switched in a single transaction when they are on the same expander, otherwise with one transaction per expander
+void switchInputRelays(byte from, byte to)
+{
+  byte fromExpander = inputRelayExpander(from);
+  byte toExpander = inputRelayExpander(to);
+  byte fromBit = 1 << inputRelayPin(from);
+  byte toBit = 1 << inputRelayPin(to);
 
-      if (Settings.RecallSetLevel)
-        RuntimeSettings.CurrentVolume = RuntimeSettings.InputLastVol[RuntimeSettings.CurrentInput];
-      else if (RuntimeSettings.CurrentVolume > Settings.Input[RuntimeSettings.CurrentInput].MaxVol)
-        RuntimeSettings.CurrentVolume = Settings.Input[RuntimeSettings.CurrentInput].MaxVol;
-      else if (RuntimeSettings.CurrentVolume < Settings.Input[RuntimeSettings.CurrentInput].MinVol)
-        RuntimeSettings.CurrentVolume = Settings.Input[RuntimeSettings.CurrentInput].MinVol;
-      setVolume(RuntimeSettings.CurrentVolume);
-      if (RuntimeSettings.Muted)
-        unmute();
-      displayInput();
-    return true;
+  if (fromExpander == toExpander)
+    relayControllers[toExpander].writeMask(fromBit | toBit, toBit, true);
+  else
+  {
+    relayControllers[fromExpander].writeMask(fromBit, 0x00);
+    relayControllers[toExpander].writeMask(toBit, toBit);
   }
-  return false;
 }
 
 // Display the name of the current input (but only if it has been chosen to be so by the user)
@@ -773,33 +1262,57 @@ void displayTemperatures()
 {
   if (Settings.DisplayTemperature1)
   {
-    float Temp = getTemperature(A0);
-    float MaxTemp;
-    if (Settings.Trigger1Temp == 0)
+    int16_t Temp = thermalMonitor.average(0); // Sensor of trigger 1
+    uint8_t MaxTemp;
+    if (Settings.Trigger[0].Temp == 0)
       MaxTemp = 60;
     else
-      MaxTemp = Settings.Trigger1Temp;
+      MaxTemp = Settings.Trigger[0].Temp;
     displayTempDetails(Temp, MaxTemp, Settings.DisplayTemperature1, 1);
   }
 
   if (Settings.DisplayTemperature2)
   {
-    float Temp = getTemperature(A1);
-    float MaxTemp;
-    if (Settings.Trigger2Temp == 0)
+    int16_t Temp = thermalMonitor.average(1); // Sensor of trigger 2
+    uint8_t MaxTemp;
+    if (Settings.Trigger[1].Temp == 0)
       MaxTemp = 60;
     else
-      MaxTemp = Settings.Trigger2Temp;
+      MaxTemp = Settings.Trigger[1].Temp;
     if (Settings.DisplayTemperature1)
       displayTempDetails(Temp, MaxTemp, Settings.DisplayTemperature1, 2);
     else
       displayTempDetails(Temp, MaxTemp, Settings.DisplayTemperature1, 1);
   }
+}
 
-  mil_onRefreshTemperatureDisplay = millis();
+// Task: sample the temperatures into thermalMonitor and check the temperature protection - also while a menu is shown
+void sampleTemperatures()
+{
+  for (byte i = 0; i < TRIGGERS; i++)
+    thermalMonitor.add(i, getTemperature(triggerSensor(i)));
+
+  for (byte i = 0; i < TRIGGERS; i++)
+  {
+    // The median of the newest samples is used, so a single noisy sample doesn't turn the amplifiers off
+    if ((Settings.Trigger[i].Temp != 0) && (thermalMonitor.median(i) >= Settings.Trigger[i].Temp * 10 || thermalMonitor.rising(i)))
+    {
+      if (appMode == APP_MENU_MODE)
+        Menu1.reset();
+      toStandbyMode();
+      return;
+    }
+  }
+
+  if (++temperatureSamples >= TEMP_REFRESH_INTERVAL / TEMP_SAMPLE_INTERVAL)
+  {
+    temperatureSamples = 0;
+    markDisplayDirty(DISPLAY_TEMPERATURES);
+  }
 }
 
-void displayTempDetails(float Temp, uint8_t TriggerTemp, uint8_t DispTemp, uint8_t FirstOrSecond)
+// Temp is in tenths of degrees Celcius
+void displayTempDetails(int16_t Temp, uint8_t TriggerTemp, uint8_t DispTemp, uint8_t FirstOrSecond)
 {
   byte Col;
   if (FirstOrSecond == 1)
@@ -816,7 +1329,7 @@ void displayTempDetails(float Temp, uint8_t TriggerTemp, uint8_t DispTemp, uint8
       oled.print(F("AMP "));
     }
   }
-  else if (Temp > TriggerTemp)
+  else if (Temp > TriggerTemp * 10)
   {
     oled.setCursor(Col, 3);
     oled.print(F("HIGH"));
@@ -831,9 +1344,9 @@ void displayTempDetails(float Temp, uint8_t TriggerTemp, uint8_t DispTemp, uint8
     if (DispTemp == 1 || DispTemp == 3)
     {
       oled.setCursor(Col, 3);
-      oled.print(int(Temp));
+      oled.print(Temp / 10);
       oled.write(128); // Degree symbol
-      oled.print(" ");
+      oled.write(' ');
     }
     if (DispTemp == 2 || DispTemp == 3)
     {
@@ -843,7 +1356,7 @@ void displayTempDetails(float Temp, uint8_t TriggerTemp, uint8_t DispTemp, uint8
         oled.setCursor(Col, 2);
 
       // Map the range (0c ~ max temperature) to the range of the bar (0 to Number of characters to show the bar * Number of possible values per character )
-      byte nb_columns = map(Temp, 0, TriggerTemp, 0, 4 * 5);
+      byte nb_columns = map(Temp, 0, TriggerTemp * 10, 0, 4 * 5);
 
       for (byte i = 0; i < 4; ++i) // Number of characters to show the bar = 4
       {
@@ -866,67 +1379,54 @@ void displayTempDetails(float Temp, uint8_t TriggerTemp, uint8_t DispTemp, uint8
       }
     }
   }
-  mil_onRefreshTemperatureDisplay = millis();
 }
 
-// Return measured temperature from 4.7K NTC connected to pinNmbr
-float getTemperature(uint8_t pinNmbr)
+// Return measured temperature in tenths of degrees Celcius from 4.7K NTC connected to pinNmbr
+// The averaged measurement from the background sampling is converted by linear interpolation in ntcTable (see NtcTable.h)
+int16_t getTemperature(uint8_t pinNmbr)
 {
-  uint16_t sensorValue = 0;
-  float Vin = 5.0;   // Input voltage 5V for Arduino Nano V3
-  float Vout = 0;    // Measured voltage
-  float Rref = 4700; // Reference resistor's value in ohms
-  float Rntc = 0;    // Measured resistance of NTC
-  float Temp;
-
-  sensorValue = analogRead(pinNmbr); // Read Vout on analog input pin (Arduino can sense from 0-1023, 1023 is Vin)
+  const uint16_t stepSize = NTC_TABLE_STEP * ADC_SAMPLER_OVERSAMPLING; // Size of a table step in the resolution returned by adcSampler
+  uint16_t sensorValue = adcSampler.read(pinNmbr);
+  uint8_t index = sensorValue / stepSize;
+  int16_t low = pgm_read_word(&ntcTable[index]);
+  int16_t high = pgm_read_word(&ntcTable[index + 1]);
 
-  Vout = (sensorValue * Vin) / 1024.0; // Convert Vout to volts
-  Rntc = Rref / ((Vin / Vout) - 1);    // Formula to calculate the resisatance of the NTC
-
-  Temp = (-25.37 * log(Rntc)) + 239.43; // Formula to calculate the temperature based on the resistance of the NTC - the formula is derived from the datasheet of the NTC
-  return (Temp);
+  return low + ((int32_t)(high - low) * (sensorValue % stepSize)) / stepSize;
 }
 
 void loop()
 {
+  PROFILE_LOOP();
   UIkey = getUserInput();
 
   // Detect power off
-  // If low power is detected the RuntimeSettings are written to EEPROM. We only write these data when power down is detected to avoid to write to the EEPROM every time the volume or input is changed (an EEPROM has a limited lifetime of about 100000 write cycles)
-  if (appMode != APP_POWERLOSS_STATE)
-  {
-    long vcc;
-    ADMUX = _BV(REFS0) | _BV(MUX3) | _BV(MUX2) | _BV(MUX1);
-    delay(2);
-    ADCSRA |= _BV(ADSC);
-    while (bit_is_set(ADCSRA, ADSC))
-      ;
-    vcc = ADCL;
-    vcc |= ADCH << 8;
-    vcc = 1126400L / vcc;
-    if (vcc > 3000 && vcc < 4600)
-    {
-      writeRuntimeSettingsToEEPROM();
-      setTrigger1Off();
-      setTrigger2Off();
-      appMode = APP_POWERLOSS_STATE; // Switch to APP_STATE_OFF and do nothing until power disappears completely
-    }
+  // If low power is detected the RuntimeSettings are written to EEPROM. They are also saved when the volume or input has been left unchanged for RUNTIME_CHECKPOINT_DELAY, the journal spreads these writes over JOURNAL_SLOTS pages (an EEPROM has a limited lifetime of about 100000 write cycles per page)
+  // Vcc is measured in the background by adcSampler, which flags the power loss from its interrupt as soon as it is measured
+  if (appMode != APP_POWERLOSS_STATE && adcSampler.powerLost())
+  {
+    scheduler.cancel(checkpointRuntimeSettings);
+    writeRuntimeSettingsToEEPROM();
+    scheduler.cancel(startUpCountdown);
+    stopTriggers();
+    appMode = APP_POWERLOSS_STATE; // Switch to APP_STATE_OFF and do nothing until power disappears completely
+    oled.lcdOn();
+    oled.clear();
+    oled.setCursor(0, 1);
+    oled.print(F("ATTENTION:"));
+    oled.setCursor(0, 2);
+    oled.print(F("Check power supply!"));
+    scheduler.schedule(clearPowerLossMessage, 2000);
   }
 
+  // Run the tasks that are due - this may change appMode, so it must be done before the switch
+  scheduler.run();
+  muses.service();
+
+  handleSerialCommands();
+
   switch (appMode)
   {
     case APP_NORMAL_MODE:
-      if (millis() > mil_onRefreshTemperatureDisplay + TEMP_REFRESH_INTERVAL)
-      {
-        displayTemperatures();
-        if (((Settings.Trigger1Temp != 0) && (getTemperature(A0) >= Settings.Trigger1Temp)) || ((Settings.Trigger2Temp != 0) && (getTemperature(A1) >= Settings.Trigger2Temp)))
-        {
-          toStandbyMode();
-          UIkey = KEY_NONE;
-        }
-      }
-
       switch (UIkey)
       {
         case KEY_NONE:
@@ -934,42 +1434,39 @@ void loop()
         case KEY_BACK:
           appMode = APP_MENU_MODE;
           menuIndex = 0;
-          refreshMenuDisplay(REFRESH_DESCEND);
+          drawMenu();
           break;
         case KEY_UP:
-          // Turn volume up if we're not muted and we'll not exceed the maximum volume set for the currently selected input
-          if (!RuntimeSettings.Muted && (RuntimeSettings.CurrentVolume < Settings.Input[RuntimeSettings.CurrentInput].MaxVol))
-            setVolume(RuntimeSettings.CurrentVolume + 1);
-          break;
         case KEY_DOWN:
+        {
+          // All volume steps waiting in the queue are applied at once - with one update of the Muses72320 and the display (setVolume() keeps the volume within the limits of the input)
+          int16_t steps = collectVolumeSteps(UIkey);
+          // Turn volume up if we're not muted and we'll not exceed the maximum volume set for the currently selected input
+          if (steps > 0 && !RuntimeSettings.Muted && (RuntimeSettings.CurrentVolume < Settings.Input[RuntimeSettings.CurrentInput].MaxVol))
+            setVolume(RuntimeSettings.CurrentVolume + steps);
           // Turn volume down if we're not muted and we'll not get below the minimum volume set for the currently selected input
-          if (!RuntimeSettings.Muted && (RuntimeSettings.CurrentVolume > Settings.Input[RuntimeSettings.CurrentInput].MinVol))
-            setVolume(RuntimeSettings.CurrentVolume - 1);
+          else if (steps < 0 && !RuntimeSettings.Muted && (RuntimeSettings.CurrentVolume > Settings.Input[RuntimeSettings.CurrentInput].MinVol))
+            setVolume(RuntimeSettings.CurrentVolume + steps);
           break;
+        }
         case KEY_LEFT:
-          {// add new code here
-            byte nextInput = (RuntimeSettings.CurrentInput == 0) ? 5 : RuntimeSettings.CurrentInput - 1;
-            while(!setInput(nextInput)) {
-              nextInput = (nextInput==0) ? 5 : nextInput - 1;
-            }
-            break;
-          }
+        {
+          // Select the previous input that is not inactivated - wrapping around to the last input
+          byte nextInput = selectedInput();
+          do
+            nextInput = (nextInput == 0) ? INPUTS - 1 : nextInput - 1;
+          while (nextInput != selectedInput() && !setInput(nextInput));
+          break;
+        }
         case KEY_RIGHT:
-          {// add new code here
-            byte nextInput = (RuntimeSettings.CurrentInput == 5) ? 0 : RuntimeSettings.CurrentInput + 1;
-            while(!setInput(nextInput)) {
-              nextInput = (nextInput>5) ? 0 : nextInput + 1;
-            }
-            break;
-          }
-        case KEY_1:
-        case KEY_2:
-        case KEY_3:
-        case KEY_4:
-        case KEY_5:
-        case KEY_6:
-          setInput(UIkey - KEY_1);
+        {
+          // Select the next input that is not inactivated - wrapping around to the first input
+          byte nextInput = selectedInput();
+          do
+            nextInput = (nextInput == INPUTS - 1) ? 0 : nextInput + 1;
+          while (nextInput != selectedInput() && !setInput(nextInput));
           break;
+        }
         case KEY_PREVIOUS:
           // Switch to previous selected input if it is not inactivated
           setInput(RuntimeSettings.PrevSelectedInput);
@@ -981,9 +1478,13 @@ void loop()
           else
           {
             mute();
-            displayMute();
+            markDisplayDirty(DISPLAY_VOLUME);
           }
           break;
+        default:
+          if (UIkey >= KEY_1 && UIkey < KEY_1 + INPUTS)
+            setInput(UIkey - KEY_1);
+          break;
     }
       break;    
 
@@ -995,9 +1496,7 @@ void loop()
       {
         // Back to APP_NORMAL_MODE
         oled.clear();
-        displayInput();
-        displayVolume();
-        displayTemperatures();
+        markDisplayDirty(DISPLAY_ALL);
         appMode = APP_NORMAL_MODE;
       }
       else if (menuMode == MENU_INVOKE_ITEM) // TO DO MENU_INVOKE_ITEM seems to be superfluous after my other changes
@@ -1006,87 +1505,367 @@ void loop()
       }
       break;
   }
-    
-    case APP_PROCESS_MENU_CMD:
-    {
-      byte processingComplete = processMenuCommand(Menu1.getCurrentItemCmdId());
+    
+    case APP_PROCESS_MENU_CMD:
+    {
+      byte processingComplete = processMenuCommand(Menu1.getCurrentItemCmdId());
+
+      if (appMode != APP_PROCESS_MENU_CMD)
+      {
+        // The command has changed mode itself (restart or standby)
+        Menu1.reset();
+      }
+      else if (processingComplete == ABANDON)
+      {
+        // Back to APP_NORMAL_MODE
+        oled.clear();
+        markDisplayDirty(DISPLAY_ALL);
+        appMode = APP_NORMAL_MODE;
+        Menu1.reset();
+      }
+      else if (processingComplete == true)
+      {
+        appMode = APP_MENU_MODE;
+        drawMenu();
+      }
+      break;
+    }
+  
+    case APP_STANDBY_MODE:
+    // Sleep if in APP_STANDBY_MODE - if the user presses KEY_ONOFF a restart is done by getUserInput(). By the way: you don't need an IR remote: a doubleclick on encoder_2 is also KEY_ONOFF
+      if (millis() - mil_Awake > STANDBY_AWAKE_TIME && millis() - mil_LastUserInput > STANDBY_AWAKE_TIME && readyToSleep())
+        sleepUntilWoken();
+      break;
+
+    case APP_STARTUP_MODE:
+    // Do nothing while the startup countdown is running - it is done by startUpCountdown()
+      break;
+
+    case APP_POWERLOSS_STATE: // Only active if power drop is detected
+      // Wait until power is completely gone or restart if it returns
+      if (!scheduler.isScheduled(clearPowerLossMessage) && adcSampler.readVcc() >= 4700)
+      {
+        adcSampler.clearPowerLoss();
+        startUp();
+      }
+      break;
+  }
+
+  pushSerialState();
+#ifdef PROFILING
+  pushProfileRecords();
+#endif
+
+  // Send what has been drawn during this pass to the display
+  {
+    PROFILE_SECTION(PROFILE_DISPLAY_FLUSH);
+    oled.flush();
+  }
+}
+
+void toStandbyMode()
+{
+  appMode = APP_STANDBY_MODE;
+  mil_Awake = millis();
+  scheduler.cancel(startUpCountdown);
+  scheduler.cancel(sampleTemperatures);
+  scheduler.cancel(switchInput);
+  pendingInput = INPUT_NONE;
+  writeRuntimeSettingsToEEPROM();
+  if (ScreenSaverIsOn)
+  {
+    if (Settings.DisplayDimLevel == 0)
+      oled.lcdOn();
+    oled.backlight((Settings.DisplayOnLevel + 1) * 64 - 1);
+    ScreenSaverIsOn = false;
+  }
+  oled.clear();
+  oled.setCursor(0, 1);
+  oled.print(F("Going to sleep!"));
+  oled.setCursor(11, 3);
+  oled.print(F("...zzzZZZ"));
+  oled.flush();
+  mute();
+  scheduler.cancel(checkpointRuntimeSettings); // Scheduled by mute() - the RuntimeSettings have just been saved (unmuted, as they must be restored)
+  stopTriggers();
+  // Turn off the display when the message has been shown - getUserInput() will take care of wakeup when KEY_ONOFF is received
+  scheduler.schedule(standbyDisplayOff, 3000);
+}
+
+void standbyDisplayOff()
+{
+  oled.lcdOff();
+}
+
+void clearPowerLossMessage()
+{
+  oled.clear();
+}
+
+// Nothing may be going on when the MCU is put to sleep: no tasks (the display is turned off and the trigger pulses are ended by tasks), no input waiting and no IR code, EEPROM write or I2C transaction in progress
+bool readyToSleep()
+{
+  return scheduler.idle() && inputEvents.isEmpty() && !irReceiver.receiving() && !eeprom.busy() && i2cBus.idle() && !muses.isRamping() && !Serial.available();
+}
+
+void sleepUntilWoken()
+{
+  Serial.flush(); // Send what is left in the transmit buffer before the UART stops
+  Timer1.stop();
+  adcSampler.stop();
+
+  // PCINT2 is already enabled for the encoders
+  PCMSK2 |= _BV(PCINT16) | _BV(PCINT18) | _BV(PCINT19);
+
+  set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+  cli();
+  sleep_enable();
+  sleep_bod_disable();
+  sei(); // The instruction after sei() is always executed, so a pin change right now still wakes us up
+  sleep_cpu();
+  sleep_disable();
+
+  PCMSK2 &= ~(_BV(PCINT16) | _BV(PCINT18) | _BV(PCINT19));
+  adcSampler.resume();
+  Timer1.start();
+
+  mil_Awake = millis();
+  // millis() has not counted the time asleep, so the KEY_ONOFF that started standby must not block the KEY_ONOFF that ends it (see getUserInput())
+  last_KEY_ONOFF = millis() - 5000;
+}
+
+// Serial control ---------------------------------------------------------------------------------------------
+// Handle the frames received since the last pass of loop() - nothing waits for the serial port, so this is cheap when nothing is received
+void handleSerialCommands()
+{
+  PROFILE_SECTION(PROFILE_SERIAL);
+  // An ack that didn't fit in the transmit buffer is sent before the next command is read - the commands wait in the receive buffer meanwhile
+  if (serialAckUnsent)
+    serialAckUnsent = !serialControl.send(SERIAL_EVT_ACK, serialAck, sizeof(serialAck));
+  while (!serialAckUnsent && serialControl.poll())
+  {
+    const byte *payload = serialControl.payload();
+    byte status = SERIAL_STATUS_OK;
+
+    switch (serialControl.command())
+    {
+      case SERIAL_CMD_GET_STATE:
+        if (serialControl.length() != 0)
+          status = SERIAL_STATUS_UNKNOWN;
+        else
+        {
+          serialStateUnsent = true;
+          continue;
+        }
+        break;
+      case SERIAL_CMD_SET_VOLUME:
+        status = checkSerialCommand(1);
+        if (status == SERIAL_STATUS_OK)
+        {
+          if (RuntimeSettings.Muted)
+          {
+            // Used when unmuted - the input is muted while an input switch is pending, so the volume is for the input selected (switchInput() recalls it from InputLastVol)
+            byte input = selectedInput();
+            RuntimeSettings.CurrentVolume = limitSerialVolume(input, payload[0]);
+            if (input != RuntimeSettings.CurrentInput)
+              RuntimeSettings.InputLastVol[input] = RuntimeSettings.CurrentVolume;
+          }
+          else
+            setVolume(payload[0]);
+        }
+        break;
+      case SERIAL_CMD_SET_INPUT:
+        status = checkSerialCommand(1);
+        if (status == SERIAL_STATUS_OK && !setInput(payload[0]))
+          status = SERIAL_STATUS_INVALID;
+        break;
+      case SERIAL_CMD_SET_MUTE:
+        status = checkSerialCommand(1);
+        if (status == SERIAL_STATUS_OK && payload[0] != RuntimeSettings.Muted)
+        {
+          if (payload[0])
+          {
+            mute();
+            markDisplayDirty(DISPLAY_VOLUME);
+          }
+          else
+            unmute();
+        }
+        break;
+      case SERIAL_CMD_SET_POWER:
+        if (serialControl.length() != 1)
+          status = SERIAL_STATUS_UNKNOWN;
+        else if (appMode == APP_POWERLOSS_STATE)
+          status = SERIAL_STATUS_BUSY;
+        else if (payload[0] && appMode == APP_STANDBY_MODE)
+          startUp();
+        else if (!payload[0] && appMode != APP_STANDBY_MODE)
+          toStandbyMode();
+        break;
+      case SERIAL_CMD_SET_STATE:
+        status = checkSerialCommand(3);
+        if (status == SERIAL_STATUS_OK && !applySerialState(payload[0], payload[1], payload[2]))
+          status = SERIAL_STATUS_INVALID;
+        break;
+#ifdef PROFILING
+      case SERIAL_CMD_GET_PROFILE:
+        profileRecordsUnsent = PROFILER_RECORDS;
+        break;
+      case SERIAL_CMD_RESET_PROFILE:
+        profiler.reset();
+        break;
+#endif
+      default:
+        status = SERIAL_STATUS_UNKNOWN;
+    }
+    if (status == SERIAL_STATUS_OK)
+      mil_LastUserInput = millis(); // Serial commands count as user input for the inactivity timer
+
+    serialAck[0] = serialControl.command();
+    serialAck[1] = status;
+    serialAckUnsent = !serialControl.send(SERIAL_EVT_ACK, serialAck, sizeof(serialAck));
+  }
+}
+
+// Commands changing input, volume or mute are only accepted in APP_NORMAL_MODE with a payload of payloadLength bytes
+byte checkSerialCommand(byte payloadLength)
+{
+  if (serialControl.length() != payloadLength)
+    return SERIAL_STATUS_UNKNOWN;
+  if (appMode != APP_NORMAL_MODE)
+    return SERIAL_STATUS_BUSY;
+  return SERIAL_STATUS_OK;
+}
+
+// Return volume kept within the limits of input, like setVolume() does - used for a volume received while muted, as it is stored (and reported by SERIAL_EVT_STATE) without setVolume()
+byte limitSerialVolume(byte input, byte volume)
+{
+  return min(constrain(volume, Settings.Input[input].MinVol, Settings.Input[input].MaxVol), Settings.VolumeSteps);
+}
+
+// Select input with volume step volume and mute/unmute in one go (SERIAL_CMD_SET_STATE)
+// The volume is set before the input is changed, so the volume ramps straight to it when the new input is unmuted. Returns false if input is not valid
+bool applySerialState(byte input, byte volume, bool muted)
+{
+  if (input >= INPUTS || Settings.Input[input].Active == INPUT_INACTIVATED)
+    return false;
+
+  volume = limitSerialVolume(input, volume);
+  if (input != selectedInput())
+  {
+    RuntimeSettings.CurrentVolume = volume;
+    RuntimeSettings.InputLastVol[input] = volume;
+    setInput(input, !muted);
+  }
+  else if (RuntimeSettings.Muted)
+  {
+    RuntimeSettings.CurrentVolume = volume;
+    if (!muted)
+      unmute();
+  }
+  else
+    setVolume(volume);
 
-      if (processingComplete == ABANDON)
-      {
-        // Back to APP_NORMAL_MODE
-        oled.clear();
-        displayInput();
-        displayVolume();
-        displayTemperatures();
-        appMode = APP_NORMAL_MODE;
-        Menu1.reset();
-      }
-      else if (processingComplete == true)
-      {
-        appMode = APP_MENU_MODE;
-        drawMenu();
-      }
-      break;
-    }
-  
-    case APP_STANDBY_MODE:
-    // Do nothing if in APP_STANDBY_MODE - if the user presses KEY_ONOFF a restart is done by getUserInput(). By the way: you don't need an IR remote: a doubleclick on encoder_2 is also KEY_ONOFF
-      break;
+  if (muted && !RuntimeSettings.Muted)
+  {
+    mute();
+    markDisplayDirty(DISPLAY_VOLUME);
+  }
+  return true;
+}
 
-    case APP_POWERLOSS_STATE: // Only active if power drop is detected
-    {
-      oled.lcdOn();
-      oled.clear();
-      oled.setCursor(0, 1);
-      oled.print("ATTENTION:");
-      oled.setCursor(0, 2);
-      oled.print("Check power supply!");
-      delay(2000);
-      oled.clear();
-      long vcc;
-      do
-      {
-        ADMUX = _BV(REFS0) | _BV(MUX3) | _BV(MUX2) | _BV(MUX1);
-        delay(2);
-        ADCSRA |= _BV(ADSC);
-        while (bit_is_set(ADCSRA, ADSC));
-        vcc = ADCL;
-        vcc |= ADCH << 8;
-        vcc = 1126400L / vcc;
-      } while (vcc < 4700); // Wait until power is completely gone or restart if it returns
-      startUp();
-      break;
-    }
+// Send SERIAL_EVT_STATE if power, input, volume or mute has changed since it was sent last (or if it has been asked for)
+void pushSerialState()
+{
+  byte state[4];
+  if (appMode == APP_STANDBY_MODE || appMode == APP_POWERLOSS_STATE)
+    state[0] = SERIAL_POWER_STANDBY;
+  else if (appMode == APP_STARTUP_MODE)
+    state[0] = SERIAL_POWER_STARTING;
+  else
+    state[0] = SERIAL_POWER_ON;
+  state[1] = RuntimeSettings.CurrentInput;
+  state[2] = RuntimeSettings.CurrentVolume;
+  state[3] = RuntimeSettings.Muted;
+
+  if (serialStateUnsent || memcmp(state, serialState, sizeof(state)) != 0)
+  {
+    // If there's no room in the transmit buffer it is tried again in the next pass of loop()
+    serialStateUnsent = !serialControl.send(SERIAL_EVT_STATE, state, sizeof(state));
+    if (!serialStateUnsent)
+      memcpy(serialState, state, sizeof(state));
   }
 }
 
-void toStandbyMode()
+#ifdef PROFILING
+// Send as many records of the profile dump as there is room for in the transmit buffer - the rest follows in the next passes of loop()
+void pushProfileRecords()
 {
-  writeRuntimeSettingsToEEPROM();
-  if (ScreenSaverIsOn)
+  while (profileRecordsUnsent)
   {
-    if (Settings.DisplayDimLevel == 0)
-      oled.lcdOn();
-    oled.backlight((Settings.DisplayOnLevel + 1) * 64 - 1);
-    ScreenSaverIsOn = false;
+    byte record[5];
+    uint32_t value;
+    record[0] = PROFILER_RECORDS - profileRecordsUnsent;
+    profiler.getRecord(record[0], value);
+    for (byte i = 0; i < 4; i++)
+      record[i + 1] = value >> (8 * i);
+    if (!serialControl.send(SERIAL_EVT_PROFILE, record, sizeof(record)))
+      break;
+    profileRecordsUnsent--;
   }
-  oled.clear();
-  oled.setCursor(0, 1);
-  oled.print(F("Going to sleep!"));
-  oled.setCursor(11, 3);
-  oled.print(F("...zzzZZZ"));
-  mute();
-  setTrigger1Off();
-  setTrigger2Off();
-  delay(3000);
-  oled.lcdOff();
-  while (getUserInput() != KEY_ONOFF) // getUserInput will take care of wakeup when KEY_ONOFF is received
-    ;
 }
+#endif
 
 //----------------------------------------------------------------------
 // Addition or removal of menu items in MenuData.h will require this method
 // to be modified accordingly.
+// Options shown by editOptionValue() - tables in flash of the strings (in flash) of the options
+const char optionNo[] PROGMEM = "No";
+const char optionYes[] PROGMEM = "Yes";
+const char optionHT[] PROGMEM = "HT";
+const char optionInactive[] PROGMEM = "Inactive";
+const char optionActive[] PROGMEM = "Active";
+const char optionMomentary[] PROGMEM = "Moment.";
+const char optionLatching[] PROGMEM = "Latching";
+const char optionStandard[] PROGMEM = "Standard";
+const char optionSmartOn[] PROGMEM = "SmartON";
+const char optionOff[] PROGMEM = "Off";
+const char optionOn[] PROGMEM = "On";
+const char option25[] PROGMEM = "25%";
+const char option50[] PROGMEM = "50%";
+const char option75[] PROGMEM = "75%";
+const char option100[] PROGMEM = "100%";
+const char optionHide[] PROGMEM = "Hide";
+const char optionShow[] PROGMEM = "Show";
+const char optionSteps[] PROGMEM = "Steps";
+const char optionDB[] PROGMEM = "-dB";
+const char optionNone[] PROGMEM = "None";
+const char optionDegrees[] PROGMEM = "Degrees";
+const char optionBar[] PROGMEM = "Bar";
+const char optionBoth[] PROGMEM = "Both";
+const char *const optionsNoYes[] PROGMEM = {optionNo, optionYes};
+const char *const optionsInputActive[] PROGMEM = {optionHT, optionYes, optionNo}; // INPUT_HT_PASSTHROUGH, INPUT_NORMAL, INPUT_INACTIVATED
+const char *const optionsTriggerActive[] PROGMEM = {optionInactive, optionActive};
+const char *const optionsTriggerType[] PROGMEM = {optionMomentary, optionLatching};
+const char *const optionsTriggerMode[] PROGMEM = {optionStandard, optionSmartOn};
+const char *const optionsOffOn[] PROGMEM = {optionOff, optionOn};
+const char *const optionsDisplayLevel[] PROGMEM = {option25, option50, option75, option100};
+const char *const optionsDisplayVolume[] PROGMEM = {optionHide, optionSteps, optionDB};
+const char *const optionsHideShow[] PROGMEM = {optionHide, optionShow};
+const char *const optionsDisplayTemp[] PROGMEM = {optionNone, optionDegrees, optionBar, optionBoth};
+
+// The settings of the trigger that a command of the trigger menus is for - the menus of the triggers have the same items
+TriggerSettings &menuTrigger(byte cmdId)
+{
+  return Settings.Trigger[(cmdId - mnuCmdTRIGGER1_ACTIVE) / (mnuCmdTRIGGER2_ACTIVE - mnuCmdTRIGGER1_ACTIVE)];
+}
+
+// The input that a command of the input menu is for - the inputs share the menu, so it is the item of the input in the Inputs menu
+byte menuInput()
+{
+  return Menu1.getParentItemIndex();
+}
+
 byte processMenuCommand(byte cmdId)
 {
   byte complete = false; // set to true when menu command processing complete. Set to ABANDON_MENU if a return to APP_MODE_NORMAL must be forced
@@ -1103,7 +1882,7 @@ byte processMenuCommand(byte cmdId)
     if (editNumericValue(Settings.VolumeSteps, 1, 179, "Steps"))
     {
       // Update MaxVol for all inputs to VolumeSteps and set MinVol = 0 for all inputs.
-      for (uint8_t i = 0; i < 6; i++)
+      for (uint8_t i = 0; i < INPUTS; i++)
       {
         Settings.Input[i].MaxVol = Settings.VolumeSteps;
         Settings.Input[i].MinVol = 0;
@@ -1113,6 +1892,9 @@ byte processMenuCommand(byte cmdId)
       if (Settings.MaxStartVolume > Settings.VolumeSteps)
         Settings.MaxStartVolume = Settings.VolumeSteps;
       Settings.MuteLevel = 0;
+      markSettingsDirty(&Settings.MaxStartVolume, 2); // MaxStartVolume and MuteLevel
+      markSettingsDirty(Settings.Input, sizeof(Settings.Input));
+      buildAttenuationTable();
       setVolume(0); // Turn the volume down to the minimum (just in case)
       writeSettingsToEEPROM();
     }
@@ -1121,11 +1903,13 @@ byte processMenuCommand(byte cmdId)
   }
   case mnuCmdMIN_ATT:
     editNumericValue(Settings.MinAttenuation, 0, Settings.MaxAttenuation, "  -dB");
+    buildAttenuationTable();
     setVolume(0); // Turn the volume down to the minimum (just in case)
     complete = true;
     break;
   case mnuCmdMAX_ATT:
     editNumericValue(Settings.MaxAttenuation, Settings.MinAttenuation + 1, 90, "  -dB");
+    buildAttenuationTable();
     setVolume(0); // Turn the volume down to the minimum (just in case)
     complete = true;
     break;
@@ -1138,225 +1922,101 @@ byte processMenuCommand(byte cmdId)
     complete = true;
     break;
   case mnuCmdSTORE_LVL:
-    editOptionValue(Settings.RecallSetLevel, 2, "No", "Yes", "", "");
+    editOptionValue(Settings.RecallSetLevel, 2, optionsNoYes);
     complete = true;
     break;
-  case mnuCmdINPUT1_ACTIVE:
-    if (RuntimeSettings.CurrentInput != 0) // If this input is selected then only allow to select "HT", "Yes". If not "HT", "Yes", "No" is allowed as options
-      editOptionValue(Settings.Input[0].Active, 3, "HT", "Yes", "No", "");
-    else
-      editOptionValue(Settings.Input[0].Active, 2, "HT", "Yes", "", "");
-    complete = true;
-    break;
-  case mnuCmdINPUT1_NAME:
-    editInputName(0);
-    complete = true;
-    break;
-  case mnuCmdINPUT1_MAX_VOL:
-    editNumericValue(Settings.Input[0].MaxVol, 0, Settings.VolumeSteps, " Step");
-    complete = true;
-    break;
-  case mnuCmdINPUT1_MIN_VOL:
-    editNumericValue(Settings.Input[0].MinVol, 0, Settings.Input[0].MaxVol, " Step");
-    complete = true;
-    break;
-  case mnuCmdINPUT2_ACTIVE:
-    if (RuntimeSettings.CurrentInput != 1) // If this input is selected then only allow to select "HT", "Yes". If not "HT", "Yes", "No" is allowed as options
-      editOptionValue(Settings.Input[1].Active, 3, "HT", "Yes", "No", "");
-    else
-      editOptionValue(Settings.Input[1].Active, 2, "HT", "Yes", "", "");
-    complete = true;
-    break;
-  case mnuCmdINPUT2_NAME:
-    editInputName(1);
-    complete = true;
-    break;
-  case mnuCmdINPUT2_MAX_VOL:
-    editNumericValue(Settings.Input[1].MaxVol, 0, Settings.VolumeSteps, " Step");
-    complete = true;
-    break;
-  case mnuCmdINPUT2_MIN_VOL:
-    editNumericValue(Settings.Input[1].MinVol, 0, Settings.Input[1].MaxVol, " Step");
-    complete = true;
-    break;
-  case mnuCmdINPUT3_ACTIVE:
-    if (RuntimeSettings.CurrentInput != 2) // If this input is selected then only allow to select "HT", "Yes". If not "HT", "Yes", "No" is allowed as options
-      editOptionValue(Settings.Input[2].Active, 3, "HT", "Yes", "No", "");
-    else
-      editOptionValue(Settings.Input[2].Active, 2, "HT", "Yes", "", "");
-    complete = true;
-    break;
-  case mnuCmdINPUT3_NAME:
-    editInputName(2);
-    complete = true;
-    break;
-  case mnuCmdINPUT3_MAX_VOL:
-    editNumericValue(Settings.Input[2].MaxVol, 0, Settings.VolumeSteps, " Step");
-    complete = true;
-    break;
-  case mnuCmdINPUT3_MIN_VOL:
-    editNumericValue(Settings.Input[2].MinVol, 0, Settings.Input[2].MaxVol, " Step");
-    complete = true;
-    break;
-  case mnuCmdINPUT4_ACTIVE:
-    if (RuntimeSettings.CurrentInput != 3) // If this input is selected then only allow to select "HT", "Yes". If not "HT", "Yes", "No" is allowed as options
-      editOptionValue(Settings.Input[3].Active, 3, "HT", "Yes", "No", "");
-    else
-      editOptionValue(Settings.Input[3].Active, 2, "HT", "Yes", "", "");
-    complete = true;
-    break;
-  case mnuCmdINPUT4_NAME:
-    editInputName(3);
-    complete = true;
-    break;
-  case mnuCmdINPUT4_MAX_VOL:
-    editNumericValue(Settings.Input[3].MaxVol, 0, Settings.VolumeSteps, " Step");
+  case mnuCmdBALANCE:
+    if (editNumericValue(Settings.Balance, 0, 20, " L<>R"))
+      setBalance();
     complete = true;
     break;
-  case mnuCmdINPUT4_MIN_VOL:
-    editNumericValue(Settings.Input[3].MinVol, 0, Settings.Input[3].MaxVol, " Step");
-    complete = true;
-    break;
-  case mnuCmdINPUT5_ACTIVE:
-    if (RuntimeSettings.CurrentInput != 4) // If this input is selected then only allow to select "HT", "Yes". If not "HT", "Yes", "No" is allowed as options
-      editOptionValue(Settings.Input[4].Active, 3, "HT", "Yes", "No", "");
-    else
-      editOptionValue(Settings.Input[4].Active, 2, "HT", "Yes", "", "");
-    complete = true;
-    break;
-  case mnuCmdINPUT5_NAME:
-    editInputName(4);
-    complete = true;
-    break;
-  case mnuCmdINPUT5_MAX_VOL:
-    editNumericValue(Settings.Input[4].MaxVol, 0, Settings.VolumeSteps, " Step");
-    complete = true;
-    break;
-  case mnuCmdINPUT5_MIN_VOL:
-    editNumericValue(Settings.Input[4].MinVol, 0, Settings.Input[4].MaxVol, " Step");
-    complete = true;
-    break;
-  case mnuCmdINPUT6_ACTIVE:
-    if (RuntimeSettings.CurrentInput != 5) // If this input is selected then only allow to select "HT", "Yes". If not "HT", "Yes", "No" is allowed as options
-      editOptionValue(Settings.Input[5].Active, 3, "HT", "Yes", "No", "");
+  case mnuCmdINPUT_ACTIVE:
+    if (RuntimeSettings.CurrentInput != menuInput()) // If this input is selected then only allow to select "HT", "Yes". If not "HT", "Yes", "No" is allowed as options
+      editOptionValue(Settings.Input[menuInput()].Active, 3, optionsInputActive);
     else
-      editOptionValue(Settings.Input[5].Active, 2, "HT", "Yes", "", "");
+      editOptionValue(Settings.Input[menuInput()].Active, 2, optionsInputActive);
     complete = true;
     break;
-  case mnuCmdINPUT6_NAME:
-    editInputName(5);
+  case mnuCmdINPUT_NAME:
+    editInputName(menuInput());
     complete = true;
     break;
-  case mnuCmdINPUT6_MAX_VOL:
-    editNumericValue(Settings.Input[5].MaxVol, 0, Settings.VolumeSteps, " Step");
+  case mnuCmdINPUT_MAX_VOL:
+    editNumericValue(Settings.Input[menuInput()].MaxVol, 0, Settings.VolumeSteps, " Step");
     complete = true;
     break;
-  case mnuCmdINPUT6_MIN_VOL:
-    editNumericValue(Settings.Input[5].MinVol, 0, Settings.Input[5].MaxVol, " Step");
+  case mnuCmdINPUT_MIN_VOL:
+    editNumericValue(Settings.Input[menuInput()].MinVol, 0, Settings.Input[menuInput()].MaxVol, " Step");
     complete = true;
     break;
   case mnuCmdIR_ONOFF:
-    editIRCode(Settings.IR_ONOFF);
+    editIRCode(KEY_ONOFF);
     complete = true;
     break;
   case mnuCmdIR_UP:
-    editIRCode(Settings.IR_UP);
+    editIRCode(KEY_UP);
     complete = true;
     break;
   case mnuCmdIR_DOWN:
-    editIRCode(Settings.IR_DOWN);
+    editIRCode(KEY_DOWN);
     complete = true;
     break;
   case mnuCmdIR_REPEAT:
-    editIRCode(Settings.IR_REPEAT);
+    editIRCode(KEY_REPEAT);
     complete = true;
     break;
   case mnuCmdIR_LEFT:
-    editIRCode(Settings.IR_LEFT);
+    editIRCode(KEY_LEFT);
     complete = true;
     break;
   case mnuCmdIR_RIGHT:
-    editIRCode(Settings.IR_RIGHT);
+    editIRCode(KEY_RIGHT);
     complete = true;
     break;
   case mnuCmdIR_SELECT:
-    editIRCode(Settings.IR_SELECT);
+    editIRCode(KEY_SELECT);
     complete = true;
     break;
   case mnuCmdIR_BACK:
-    editIRCode(Settings.IR_BACK);
+    editIRCode(KEY_BACK);
     complete = true;
     break;
   case mnuCmdIR_MUTE:
-    editIRCode(Settings.IR_MUTE);
+    editIRCode(KEY_MUTE);
     complete = true;
     break;
   case mnuCmdIR_PREV:
-    editIRCode(Settings.IR_PREVIOUS);
-    complete = true;
-    break;
-  case mnuCmdIR_1:
-    editIRCode(Settings.IR_1);
-    complete = true;
-    break;
-  case mnuCmdIR_2:
-    editIRCode(Settings.IR_2);
-    complete = true;
-    break;
-  case mnuCmdIR_3:
-    editIRCode(Settings.IR_3);
-    complete = true;
-    break;
-  case mnuCmdIR_4:
-    editIRCode(Settings.IR_4);
-    complete = true;
-    break;
-  case mnuCmdIR_5:
-    editIRCode(Settings.IR_5);
+    editIRCode(KEY_PREVIOUS);
     complete = true;
     break;
-  case mnuCmdIR_6:
-    editIRCode(Settings.IR_6);
+  case mnuCmdIR_INPUT:
+    // The items of the Learn IR menu are in the order of the command ids, so the first input key is item mnuCmdIR_INPUT - mnuCmdIR_ONOFF
+    editIRCode(KEY_1 + Menu1.getCurrentItemIndex() - (mnuCmdIR_INPUT - mnuCmdIR_ONOFF));
     complete = true;
     break;
   case mnuCmdTRIGGER1_ACTIVE:
-    editOptionValue(Settings.Trigger1Active, 2, "Inactive", "Active", "", "");
-    complete = true;
-    break;
-  case mnuCmdTRIGGER1_TYPE:
-    editOptionValue(Settings.Trigger1Type, 2, "Moment.", "Latching", "", "");
-    complete = true;
-    break;
-  case mnuCmdTRIGGER1_MODE:
-    editOptionValue(Settings.Trigger1Mode, 2, "Standard", "SmartON", "", "");
-    complete = true;
-    break;
-  case mnuCmdTRIGGER1_ON_DELAY:
-    editNumericValue(Settings.Trigger1OnDelay, 0, 90, "Secs.");
-    complete = true;
-    break;
-  case mnuCmdTRIGGER1_TEMP:
-    editNumericValue(Settings.Trigger1Temp, 0, 90, "Deg C");
-    complete = true;
-    break;
   case mnuCmdTRIGGER2_ACTIVE:
-    editOptionValue(Settings.Trigger2Active, 2, "Inactive", "Active", "", "");
+    editOptionValue(menuTrigger(cmdId).Active, 2, optionsTriggerActive);
     complete = true;
     break;
+  case mnuCmdTRIGGER1_TYPE:
   case mnuCmdTRIGGER2_TYPE:
-    editOptionValue(Settings.Trigger2Type, 2, "Moment.", "Latching", "", "");
+    editOptionValue(menuTrigger(cmdId).Type, 2, optionsTriggerType);
     complete = true;
     break;
+  case mnuCmdTRIGGER1_MODE:
   case mnuCmdTRIGGER2_MODE:
-    editOptionValue(Settings.Trigger2Mode, 2, "Standard", "SmartON", "", "");
+    editOptionValue(menuTrigger(cmdId).Mode, 2, optionsTriggerMode);
     complete = true;
     break;
+  case mnuCmdTRIGGER1_ON_DELAY:
   case mnuCmdTRIGGER2_ON_DELAY:
-    editNumericValue(Settings.Trigger2OnDelay, 0, 90, "Secs.");
+    editNumericValue(menuTrigger(cmdId).OnDelay, 0, 90, "Secs.");
     complete = true;
     break;
+  case mnuCmdTRIGGER1_TEMP:
   case mnuCmdTRIGGER2_TEMP:
-    editNumericValue(Settings.Trigger2Temp, 0, 90, "Deg C");
+    editNumericValue(menuTrigger(cmdId).Temp, 0, 90, "Deg C");
     complete = true;
     break;
   case mnuCmdTRIGGER_INACT_TIMER:
@@ -1364,11 +2024,11 @@ byte processMenuCommand(byte cmdId)
     complete = true;
     break;
   case mnuCmdDISP_SAVER_ACTIVE:
-    editOptionValue(Settings.ScreenSaverActive, 2, "Off", "On", "", "");
+    editOptionValue(Settings.ScreenSaverActive, 2, optionsOffOn);
     complete = true;
     break;
   case mnuCmdDISP_ON_LEVEL:
-    editOptionValue(Settings.DisplayOnLevel, 4, "25%", "50%", "75%", "100%");
+    editOptionValue(Settings.DisplayOnLevel, 4, optionsDisplayLevel);
     oled.backlight((Settings.DisplayOnLevel + 1) * 64 - 1);
     complete = true;
     break;
@@ -1377,7 +2037,7 @@ byte processMenuCommand(byte cmdId)
     if (Settings.DisplayDimLevel != 0)
     {
       oled.backlight(Settings.DisplayDimLevel * 4 - 1);
-      delay(2000);
+      holdMessage(2000);
       oled.backlight((Settings.DisplayOnLevel + 1) * 64 - 1);
     }
     complete = true;
@@ -1387,19 +2047,19 @@ byte processMenuCommand(byte cmdId)
     complete = true;
     break;
   case mnuCmdDISP_VOL:
-    editOptionValue(Settings.DisplayVolume, 3, "Hide", "Steps", "-dB", "");
+    editOptionValue(Settings.DisplayVolume, 3, optionsDisplayVolume);
     complete = true;
     break;
   case mnuCmdDISP_INPUT:
-    editOptionValue(Settings.DisplaySelectedInput, 2, "Hide", "Show", "", "");
+    editOptionValue(Settings.DisplaySelectedInput, 2, optionsHideShow);
     complete = true;
     break;
   case mnuCmdDISP_TEMP1:
-    editOptionValue(Settings.DisplayTemperature1, 4, "None", "Degrees", "Bar", "Both");
+    editOptionValue(Settings.DisplayTemperature1, 4, optionsDisplayTemp);
     complete = true;
     break;
   case mnuCmdDISP_TEMP2:
-    editOptionValue(Settings.DisplayTemperature2, 4, "None", "Degrees", "Bar", "Both");
+    editOptionValue(Settings.DisplayTemperature2, 4, optionsDisplayTemp);
     complete = true;
     break;
   case mnuCmdABOUT:
@@ -1416,7 +2076,7 @@ byte processMenuCommand(byte cmdId)
     oled.print(F("jan"));
     oled.write(160);
     oled.print(F("tofft.dk (c)2020"));
-    delay(5000);
+    holdMessage(5000);
     complete = true;
     break;
   case mnuCmdSAVE_CUST:
@@ -1424,22 +2084,31 @@ byte processMenuCommand(byte cmdId)
     oled.clear();
     oled.setCursor(0, 1);
     oled.print(F("Saved..."));
-    delay(1000);
+    holdMessage(1000);
     complete = true;
     break;
   case mnuCmdLOAD_CUST:
-    readUserSettingsFromEEPROM();
-    writeSettingsToEEPROM();
-    writeRuntimeSettingsToEEPROM();
-    setTrigger1Off();
-    setTrigger2Off();
-    startUp();
-    complete = ABANDON;
+    if (readUserSettingsFromEEPROM())
+    {
+      markSettingsDirty(Settings.data, sizeof(Settings));
+      writeSettingsToEEPROM();
+      writeRuntimeSettingsToEEPROM();
+      stopTriggers();
+      startUp();
+      complete = ABANDON;
+    }
+    else
+    {
+      oled.clear();
+      oled.setCursor(0, 1);
+      oled.print(F("No saved setup"));
+      holdMessage(2000);
+      complete = true;
+    }
     break;
   case mnuCmdLOAD_DEFAULT:
     writeDefaultSettingsToEEPROM();
-    setTrigger1Off();
-    setTrigger2Off();
+    stopTriggers();
     startUp();
     complete = ABANDON;
     break;
@@ -1466,150 +2135,80 @@ byte getNavAction()
 
 //----------------------------------------------------------------------
 // Show menu items based upon where the user has navigated to
-// The menu consists of up to four lines: one line to show the name of the current menu and up to three lines of menu items.
+// The menu consists of up to four lines: one line to show the name of the current menu and up to three lines of menu items with the current item on row menuIndex + 1
+// The rows are written in full to the frame buffer of the display - oled.flush() only sends the characters that have changed, so scrolling costs a few characters
 void drawMenu()
 {
-  char strbuf[21]; // one line of lcd display
-  char nameBuf[18];
+  PROFILE_SECTION(PROFILE_DRAW_MENU);
+  byte top = Menu1.getCurrentItemIndex() - menuIndex;
 
   // Display the name of the menu
-  oled.setCursor(0, 0);
   if (Menu1.currentMenuHasParent())
-  {
-    rpad(strbuf, Menu1.getParentItemName(nameBuf), ' ', 20);
-    oled.print(strbuf);
-  }
+    printPadded(0, 0, Menu1.getParentItemName(lineBuf), LCD_COLS);
   else
+  {
+    oled.setCursor(0, 0);
     oled.print(F("Main menu           "));
+  }
 
-  // Clear any previously displayed arrow
-  for (int i = 1; i < 4; i++)
+  for (byte row = 0; row < 3; row++)
   {
-    oled.setCursor(0, i);
-    oled.print("  ");
+    oled.setCursor(0, row + 1);
+    oled.write(' ');
+    oled.write(row == menuIndex ? 16 : ' '); // Mark with an arrow the menu item that will be activated if the user press select
+    printPadded(2, row + 1, (top + row < Menu1.getMenuItemCount()) ? Menu1.getItemName(lineBuf, top + row) : "", MENU_NAME_WIDTH);
   }
+}
 
-  // Display the name of the currently active menu item on the row set by menuIndex (+1 because row 0 is used to display the name of the menu)
-  oled.setCursor(1, menuIndex + 1);
-  oled.write(16); // Mark with an arrow that this is the menu item that will be activated if the user press select
-  rpad(strbuf, Menu1.getCurrentItemName(nameBuf), ' ', 18);
-  oled.print(strbuf);
-
-  switch (menuIndex)
+// Print text at col, row - cut or padded with spaces to width characters
+void printPadded(byte col, byte row, const char *text, byte width)
+{
+  oled.setCursor(col, row);
+  for (byte i = 0; i < width; i++)
   {
-  case 0:                                                            // The current menu item was displayed on row 0 - see if there is items to display on row 1 and 2
-    if (Menu1.getCurrentItemIndex() + 1 <= Menu1.getMenuItemCount()) // Check if there is more menu items to display
-    {
-      Menu1.moveToNextItem();
-      rpad(strbuf, Menu1.getCurrentItemName(nameBuf), ' ', 18);
-      oled.setCursor(2, menuIndex + 2);
-      oled.print(strbuf);
-      if (Menu1.getCurrentItemIndex() + 2 <= Menu1.getMenuItemCount())
-      {
-        Menu1.moveToNextItem();
-        rpad(strbuf, Menu1.getCurrentItemName(nameBuf), ' ', 18);
-        oled.setCursor(2, menuIndex + 3);
-        oled.print(strbuf);
-        Menu1.moveToPreviousItem();
-      }
-      else
-      {
-        /* clear line at menuIndex + 3 */
-        rpad(strbuf, " ", ' ', 17);
-        oled.setCursor(2, menuIndex + 3);
-        oled.print(strbuf);
-      }
-      Menu1.moveToPreviousItem();
-    }
-    else // No more items in the menu - make sure we clear up any previously displayed info from the display
-    {
-      /* clear line at menuIndex + 2 and menuIndex + 3*/
-      rpad(strbuf, " ", ' ', 17);
-      oled.setCursor(2, menuIndex + 2);
-      oled.print(strbuf);
-      oled.setCursor(2, menuIndex + 3);
-      oled.print(strbuf);
-    }
-
-    break;
-  case 1:                       // The current menu item was displayed on row 1 - display item on row 0 and see if there is an item to display on row 2
-    Menu1.moveToPreviousItem(); // Move one item up in the menu to find the name of the item to be displayed one the line just before the current one
-    rpad(strbuf, Menu1.getCurrentItemName(nameBuf), ' ', 18);
-    oled.setCursor(2, menuIndex);
-    oled.print(strbuf);
-    Menu1.moveToNextItem(); // Move to next menu item to get back to current one
-    if (Menu1.getCurrentItemIndex() + 1 <= Menu1.getMenuItemCount())
-    {
-      Menu1.moveToNextItem(); // Move to next menu item to find the name of the item after the current one
-      rpad(strbuf, Menu1.getCurrentItemName(nameBuf), ' ', 18);
-      oled.setCursor(2, menuIndex + 2);
-      oled.print(strbuf);
-      Menu1.moveToPreviousItem(); // Move to previous menu item to get back to current one
-    }
-    else // No more items in the menu - make sure we clear up any previously displayed info from the display
-    {
-      /* clear line at menuIndex + 2 */
-      rpad(strbuf, " ", ' ', 17);
-      oled.setCursor(2, menuIndex + 2);
-      oled.print(strbuf);
-    }
-    break;
-  case 2:                       // The current menu item was displayed on row 2 - display items on row 0 and 1
-    Menu1.moveToPreviousItem(); // Move one item up in the menu to find the name of the item to be displayed one the line just before the current one
-    rpad(strbuf, Menu1.getCurrentItemName(nameBuf), ' ', 18);
-    oled.setCursor(2, menuIndex);
-    oled.print(strbuf);
-    Menu1.moveToPreviousItem(); // Once again we move one item up in the menu to find the name of the item to be displayed as the first one
-    rpad(strbuf, Menu1.getCurrentItemName(nameBuf), ' ', 18);
-    oled.setCursor(2, menuIndex - 1);
-    oled.print(strbuf);
-    Menu1.moveToNextItem(); // Move to next menu item
-    Menu1.moveToNextItem(); // Move to next menu item to get back to current one
-    break;
+    if (*text)
+      oled.write(*text++);
+    else
+      oled.write(' ');
   }
 }
 
 // Callback to refresh display during menu navigation, using parameter of type enum DisplayRefreshMode.
 void refreshMenuDisplay(byte refreshMode)
 {
-  // Display first line of the menu
+  // The window only scrolls when the user moves past its first or last row
   switch (refreshMode)
   {
   case REFRESH_MOVE_PREV: // user has navigated to previous menu item.
-    if (menuIndex == 0)
-      drawMenu();
-    else
-    {
-      oled.setCursor(1, menuIndex + 1);
-      oled.write(32); // Delete the arrow previously set
+    if (menuIndex > 0)
       menuIndex--;
-      // Redraw indication of what menu item is selected
-      oled.setCursor(1, menuIndex + 1);
-      oled.write(16); // Mark with an arrow that this is the menu item that will be activated if the user press select
-    }
     break;
   case REFRESH_MOVE_NEXT: // user has navigated to next menu item.
-    if (menuIndex == 2)
-      drawMenu();
-    else
-    {
-      oled.setCursor(1, menuIndex + 1);
-      oled.write(32); // Delete the arrow previously set
+    if (menuIndex < 2)
       menuIndex++;
-      // Redraw indication of what menu item is selected
-      oled.setCursor(1, menuIndex + 1);
-      oled.write(16); // Mark with an arrow that this is the menu item that will be activated if the user press select
-    }
-    break;
-  case REFRESH_ASCEND: // user has navigated to parent menu.
-    menuIndex = 0;
-    drawMenu();
     break;
+  case REFRESH_ASCEND:  // user has navigated to parent menu.
   case REFRESH_DESCEND: // user has navigated to child menu.
     menuIndex = 0;
-    drawMenu();
     break;
   }
+  drawMenu();
+}
+
+// Remove leading and trailing spaces from name - returns the new length
+byte trimName(char *name)
+{
+  byte first = 0;
+  byte length = strlen(name);
+
+  while (name[first] == ' ')
+    first++;
+  while (length > first && name[length - 1] == ' ')
+    length--;
+  length -= first;
+  memmove(name, name + first, length);
+  name[length] = '\0';
+  return length;
 }
 
 //----------------------------------------------------------------------
@@ -1622,10 +2221,11 @@ void editInputName(uint8_t InputNumber)
   bool isUpperCase = true;     // show upper or lower case characters
   int arrowX = 1;              // text edit arrow start X position on selection line
   int arrowPointingUpDown = 0; // text edit arrow start direction: up == 0, down == 1
-  String newInputName = "          ";
+  char newInputName[sizeof(Settings.Input[0].Name)];
+  byte length; // of newInputName
   // Display the screen
   oled.clear();
-  oled.print("Input ");
+  oled.print(F("Input "));
   oled.print(InputNumber + 1);
   oled.setCursor(7, 0);
   oled.write(223); // Right arrow
@@ -1633,15 +2233,14 @@ void editInputName(uint8_t InputNumber)
 
   oled.setCursor(arrowX, 2);
   oled.write(byte(26 + arrowPointingUpDown)); // 26 is arrow up, 27 is arrow down
-  newInputName = Settings.Input[InputNumber].Name;
-  newInputName.trim();
+  strcpy(newInputName, Settings.Input[InputNumber].Name);
+  length = trimName(newInputName);
   oled.setCursor(9, 0);
   oled.print(newInputName);
-  oled.setCursor(9 + newInputName.length(), 0);
+  oled.setCursor(9 + length, 0);
   oled.BlinkingCursorOn();
-  while (!complete)
+  while (!complete && serviceMenuCommand())
   {
-    mil_LastUserInput = millis(); // Prevent the screen saver to kick in while editing
     switch (byte UserInput = getUserInput())
     {
     case KEY_RIGHT:
@@ -1673,7 +2272,7 @@ void editInputName(uint8_t InputNumber)
         oled.write(27);
       else
         oled.write(26);
-      oled.setCursor(9 + newInputName.length(), 0);
+      oled.setCursor(9 + length, 0);
       oled.BlinkingCursorOn();
       break;
     case KEY_SELECT:
@@ -1687,33 +2286,32 @@ void editInputName(uint8_t InputNumber)
         }
         else if (arrowX == 18) // Back Space (the Backspace icon has been selected)
         {
-          if (newInputName.length() > 0) // Make sure there is a character to delete!
+          if (length > 0) // Make sure there is a character to delete!
           {
-            oled.setCursor(9 + newInputName.length() - 1, 0);
-            oled.print(" "); // Print to clear the deleted character on the display
-            newInputName = newInputName.substring(0, newInputName.length() - 1);
+            oled.setCursor(9 + length - 1, 0);
+            oled.write(' '); // Print to clear the deleted character on the display
+            newInputName[--length] = '\0';
           }
         }
         else if (arrowX == 19) // Done editing (the Enter icon has been selected)
         {
-          newInputName.trim();
-          if (newInputName == "") // If no characters in new name then reset to original name
-            newInputName = Settings.Input[InputNumber].Name;
-          else
+          length = trimName(newInputName);
+          if (length > 0) // If no characters in new name then keep the original name
           {
             // Save new name to Settings
-            for (uint8_t i = 0; i < newInputName.length(); i++)
-              Settings.Input[InputNumber].Name[i] = newInputName.charAt(i);
+            for (uint8_t i = 0; i < length; i++)
+              Settings.Input[InputNumber].Name[i] = newInputName[i];
             // Pad Name with spaces - makes it easier to display
-            for (uint8_t i = newInputName.length(); i < 10; i++)
+            for (uint8_t i = length; i < 10; i++)
               Settings.Input[InputNumber].Name[i] = ' ';
             Settings.Input[InputNumber].Name[10] = '\0';
             // Save to EEPROM
+            markSettingsDirty(Settings.Input[InputNumber].Name, sizeof(Settings.Input[InputNumber].Name));
             writeSettingsToEEPROM();
           }
           complete = true;
         }
-        else if (newInputName.length() < 10) // Only allow up to 10 characters
+        else if (length < 10) // Only allow up to 10 characters
         {
           byte v;
           if (isUpperCase)
@@ -1722,22 +2320,24 @@ void editInputName(uint8_t InputNumber)
             v = 116;
           if (arrowX > 6)
             v = 41;
-          newInputName = newInputName + (char(arrowX + v));
+          newInputName[length++] = char(arrowX + v);
+          newInputName[length] = '\0';
         }
       }
       else // Arrow points up
       {
-        if (newInputName.length() < 10) // Only allow up to 10 characters
+        if (length < 10) // Only allow up to 10 characters
         {
           if (arrowX == 0) // Space character has been selected (though it is shown as underscore)
-            newInputName = newInputName + " ";
+            newInputName[length++] = ' ';
           else // A character between A-S has been selected, so add it to the string
           {
             if (isUpperCase)
-              newInputName = newInputName + (char(arrowX + 64));
+              newInputName[length++] = char(arrowX + 64);
             else
-              newInputName = newInputName + (char(arrowX + 96));
+              newInputName[length++] = char(arrowX + 96);
           }
+          newInputName[length] = '\0';
         }
       }
       if (!complete)
@@ -1788,17 +2388,40 @@ void drawEditInputNameScreen(bool isUpperCase)
   oled.write(28);  // "Enter" icon
 }
 
+// Keep the controller running while a menu command waits for the user: flush the display, run the tasks that are due, service the Muses72320 and the serial control
+// Returns false if the command must be abandoned because the mode has changed (i.e. a task or KEY_ONOFF has sent us to standby) or the power is lost, so loop() can take care of it
+bool serviceMenuCommand()
+{
+  oled.flush();
+  scheduler.run();
+  muses.service();
+  handleSerialCommands();
+  mil_LastUserInput = millis(); // Prevent the screen saver to kick in while the menu command is processed
+  return appMode == APP_PROCESS_MENU_CMD && !adcSampler.powerLost();
+}
+
+// Keep what is on the display for duration ms - or until a key is pressed, the mode changes or the power is lost
+void holdMessage(unsigned long duration)
+{
+  unsigned long start = millis();
+
+  while (millis() - start < duration && serviceMenuCommand())
+  {
+    if (getUserInput() != KEY_NONE)
+      break;
+  }
+}
+
 bool editNumericValue(byte &Value, byte MinValue, byte MaxValue, const char Unit[5])
 {
   bool complete = false;
   bool result = false;
-  char nameBuf[11];
 
   byte NewValue = Value;
 
   // Display the screen
   oled.clear();
-  oled.print(Menu1.getCurrentItemName(nameBuf));
+  oled.print(Menu1.getCurrentItemName(lineBuf));
   oled.setCursor(0, 2);
   oled.print(F("Min. "));
   oled.print(MinValue);
@@ -1810,9 +2433,8 @@ bool editNumericValue(byte &Value, byte MinValue, byte MaxValue, const char Unit
 
   oled.print3x3Number(11, 1, NewValue, false); // Display number from 000-999 with 3x3 digits
 
-  while (!complete)
+  while (!complete && serviceMenuCommand())
   {
-    mil_LastUserInput = millis(); // Prevent the screen saver to kick in while editing
     switch (getUserInput())
     {
     case KEY_RIGHT:
@@ -1831,6 +2453,7 @@ bool editNumericValue(byte &Value, byte MinValue, byte MaxValue, const char Unit
       break;
     case KEY_SELECT:
       Value = NewValue;
+      markSettingsDirty(&Value, 1);
       writeSettingsToEEPROM();
       result = true;
       complete = true;
@@ -1847,47 +2470,33 @@ bool editNumericValue(byte &Value, byte MinValue, byte MaxValue, const char Unit
   return result;
 }
 
-bool editOptionValue(byte &Value, byte NumOptions, const char Option1[9], const char Option2[9], const char Option3[9], const char Option4[9])
+// Options is a table in flash of NumOptions (up to 4) strings in flash
+bool editOptionValue(byte &Value, byte NumOptions, const char *const Options[])
 {
   bool complete = false;
   bool result = false;
-  char nameBuf[11];
 
   byte NewValue = Value;
 
   // Display the screen
   oled.clear();
-  oled.print(Menu1.getCurrentItemName(nameBuf));
-  if (NumOptions < 3)
-  {
-    oled.setCursor(1, 2);
-    oled.print(Option1);
-    oled.setCursor(11, 2);
-    oled.print(Option2);
-  }
-  else
+  oled.print(Menu1.getCurrentItemName(lineBuf));
+  for (byte i = 0; i < NumOptions; i++)
   {
-    oled.setCursor(1, 2);
-    oled.print(Option1);
-    oled.setCursor(11, 2);
-    oled.print(Option2);
-    oled.setCursor(1, 3);
-    oled.print(Option3);
-    oled.setCursor(11, 3);
-    oled.print(Option4);
+    oled.setCursor((i % 2) * 10 + 1, (i / 2) + 2);
+    oled.print((const __FlashStringHelper *)pgm_read_ptr(&Options[i]));
   }
 
   oled.setCursor((NewValue % 2) * 10, (NewValue / 2) + 2);
   oled.write(16);
 
-  while (!complete)
+  while (!complete && serviceMenuCommand())
   {
-    mil_LastUserInput = millis(); // Prevent the screen saver to kick in while editing
     switch (getUserInput())
     {
     case KEY_RIGHT:
       oled.setCursor((NewValue % 2) * 10, (NewValue / 2) + 2);
-      oled.print(" ");
+      oled.write(' ');
       if (NewValue < NumOptions - 1)
         NewValue++;
       else
@@ -1897,7 +2506,7 @@ bool editOptionValue(byte &Value, byte NumOptions, const char Option1[9], const
       break;
     case KEY_LEFT:
       oled.setCursor((NewValue % 2) * 10, (NewValue / 2) + 2);
-      oled.print(" ");
+      oled.write(' ');
       if (NewValue == 0)
         NewValue = NumOptions - 1;
       else
@@ -1907,6 +2516,7 @@ bool editOptionValue(byte &Value, byte NumOptions, const char Option1[9], const
       break;
     case KEY_SELECT:
       Value = NewValue;
+      markSettingsDirty(&Value, 1);
       writeSettingsToEEPROM();
       result = true;
       complete = true;
@@ -1923,20 +2533,24 @@ bool editOptionValue(byte &Value, byte NumOptions, const char Option1[9], const
   return result;
 }
 
-bool editIRCode(HashIR_data_t &Value)
+bool editIRCode(byte Key)
 {
   bool complete = false;
   bool result = false;
-  char nameBuf[11];
 
-  HashIR_data_t NewValue, OldValue;
+  HashIR_data_t NewValue, Value;
   NewValue.address = 0;
   NewValue.command = 0;
+  Value.address = 0;
+  Value.command = 0;
+  int8_t index = findIRBindingOfKey(Key);
+  if (index >= 0)
+    Value = Settings.IR[index].Code;
 
   // Display the screen
   oled.clear();
   oled.print(F("IR key "));
-  oled.print(Menu1.getCurrentItemName(nameBuf));
+  oled.print(Menu1.getCurrentItemName(lineBuf));
 
   oled.setCursor(0, 1);
   oled.print(F("Current:"));
@@ -1951,38 +2565,43 @@ bool editIRCode(HashIR_data_t &Value)
   oled.setCursor(10, 3);
   oled.print(NewValue.command, HEX);
 
-  // As we don't want to react to received IR code while learning new code we temporaryly disable the current code in the Settings (we save a copy in OldValue)
-  OldValue.address = Value.address;
-  OldValue.command = Value.command;
-  Value.address = 0x00;
-  Value.command = 0x00;
+  // As we don't want to react to received IR code while learning new code we ignore the current code of the key
+  learningIRKey = Key;
+  IRCodeReceived = false;
 
-  while (!complete)
+  while (!complete && serviceMenuCommand())
   {
-    mil_LastUserInput = millis(); // Prevent the screen saver to kick in while editing
     switch (getUserInput())
     {
     case KEY_SELECT:
-      Value.address = NewValue.address;
-      Value.command = NewValue.command;
+      if (NewValue.address == 0 && NewValue.command == 0) // No code received - remove the code of the key
+        unbindIRKey(Key);
+      else if (!bindIRCode(NewValue, Key))
+      {
+        // The code is already used for another key (or there is no room for it) - let the user try another one
+        oled.setCursor(10, 1);
+        oled.print(F("In use!   "));
+        break;
+      }
       writeSettingsToEEPROM();
       result = true;
       complete = true;
       break;
     case KEY_BACK:
-      // Exit without saving new value, but restore the original one
-      Value.address = OldValue.address;
-      Value.command = OldValue.command;
+      // Exit without saving new value
       result = false;
       complete = true;
       break;
     default:
       break;
     }
-    if (IRLremote.available())
+    if (IRCodeReceived)
     {
       // Get the new data from the remote
-      NewValue = IRLremote.read();
+      IRCodeReceived = false;
+      NewValue = lastIRCode;
+      oled.setCursor(10, 1);
+      oled.print(F("New:      "));
       oled.setCursor(10, 2);
       oled.print(F("          "));
       oled.setCursor(10, 2);
@@ -1993,6 +2612,7 @@ bool editIRCode(HashIR_data_t &Value)
       oled.print(NewValue.command, HEX);
     }
   }
+  learningIRKey = KEY_NONE;
   return result;
 }
 
@@ -2005,72 +2625,28 @@ void setSettingsToDefault()
   Settings.MaxStartVolume = Settings.VolumeSteps;
   Settings.MuteLevel = 0;
   Settings.RecallSetLevel = true;
-  Settings.IR_UP.address = 0x24;
-  Settings.IR_UP.command = 0x3AEA5A5F;
-  Settings.IR_DOWN.address = 0x24;
-  Settings.IR_DOWN.command = 0xE64E6057;
-  Settings.IR_REPEAT.address = 0x00;
-  Settings.IR_REPEAT.command = 0x00;
-  Settings.IR_LEFT.address = 0x24;
-  Settings.IR_LEFT.command = 0x4C7A8423;
-  Settings.IR_RIGHT.address = 0x24;
-  Settings.IR_RIGHT.command = 0xA1167E2B;
-  Settings.IR_SELECT.address = 0x24;
-  Settings.IR_SELECT.command = 0x91998CA3;
-  Settings.IR_BACK.address = 0x24;
-  Settings.IR_BACK.command = 0xE28395C7;
-  Settings.IR_MUTE.address = 0x24;
-  Settings.IR_MUTE.command = 0x41C09D23;
-  Settings.IR_PREVIOUS.address = 0x24;
-  Settings.IR_PREVIOUS.command = 0x5A3E996B;
-  Settings.IR_ONOFF.address = 0x24;
-  Settings.IR_ONOFF.command = 0x41D976CF;
-  Settings.IR_1.address = 0x24;
-  Settings.IR_1.command = 0xC43587C7;
-  Settings.IR_2.address = 0x24;
-  Settings.IR_2.command = 0x6F998DBF;
-  Settings.IR_3.address = 0x24;
-  Settings.IR_3.command = 0xB9947A73;
-  Settings.IR_4.address = 0x24;
-  Settings.IR_4.command = 0x64F8806B;
-  Settings.IR_5.address = 0x24;
-  Settings.IR_5.command = 0x1FC09E3F;
-  Settings.IR_6.address = 0x24;
-  Settings.IR_6.command = 0xCB24A437;
-  Settings.Input[0].Active = INPUT_NORMAL;
-  strcpy(Settings.Input[0].Name, "Input 1   ");
-  Settings.Input[0].MaxVol = Settings.VolumeSteps;
-  Settings.Input[0].MinVol = 0;
-  Settings.Input[1].Active = INPUT_NORMAL;
-  strcpy(Settings.Input[1].Name, "Input 2   ");
-  Settings.Input[1].MaxVol = Settings.VolumeSteps;
-  Settings.Input[1].MinVol = 0;
-  Settings.Input[2].Active = INPUT_NORMAL;
-  strcpy(Settings.Input[2].Name, "Input 3   ");
-  Settings.Input[2].MaxVol = Settings.VolumeSteps;
-  Settings.Input[2].MinVol = 0;
-  Settings.Input[3].Active = INPUT_NORMAL;
-  strcpy(Settings.Input[3].Name, "Input 4   ");
-  Settings.Input[3].MaxVol = Settings.VolumeSteps;
-  Settings.Input[3].MinVol = 0;
-  Settings.Input[4].Active = INPUT_NORMAL;
-  strcpy(Settings.Input[4].Name, "Input 5   ");
-  Settings.Input[4].MaxVol = Settings.VolumeSteps;
-  Settings.Input[4].MinVol = 0;
-  Settings.Input[5].Active = INPUT_NORMAL;
-  strcpy(Settings.Input[5].Name, "Input 6   ");
-  Settings.Input[5].MaxVol = Settings.VolumeSteps;
-  Settings.Input[5].MinVol = 0;
-  Settings.Trigger1Active = 1;
-  Settings.Trigger1Type = 0;
-  Settings.Trigger1Mode = 1;
-  Settings.Trigger1OnDelay = 10;
-  Settings.Trigger1Temp = 60;
-  Settings.Trigger2Active = 1;
-  Settings.Trigger2Type = 0;
-  Settings.Trigger2Mode = 1;
-  Settings.Trigger2OnDelay = 10;
-  Settings.Trigger2Temp = 60;
+  Settings.Balance = 10;
+  memcpy_P(Settings.IR, defaultIRBindings, DEFAULT_IR_BINDINGS * sizeof(IRBinding));
+  Settings.IRBindingCount = DEFAULT_IR_BINDINGS;
+  sortIRBindings();
+  for (byte i = 0; i < INPUTS; i++)
+  {
+    Settings.Input[i].Active = INPUT_NORMAL;
+    strcpy_P(Settings.Input[i].Name, PSTR("Input     "));
+    Settings.Input[i].Name[6] = (i < 9) ? '1' + i : '1';
+    if (i >= 9)
+      Settings.Input[i].Name[7] = '0' + i - 9;
+    Settings.Input[i].MaxVol = Settings.VolumeSteps;
+    Settings.Input[i].MinVol = 0;
+  }
+  for (byte i = 0; i < TRIGGERS; i++)
+  {
+    Settings.Trigger[i].Active = 1;
+    Settings.Trigger[i].Type = 0;
+    Settings.Trigger[i].Mode = 1;
+    Settings.Trigger[i].OnDelay = 10;
+    Settings.Trigger[i].Temp = 60;
+  }
   Settings.TriggerInactOffTimer = 0;
   Settings.ScreenSaverActive = true;
   Settings.DisplayOnLevel = 3;
@@ -2085,29 +2661,79 @@ void setSettingsToDefault()
   RuntimeSettings.CurrentInput = 0;
   RuntimeSettings.CurrentVolume = 0;
   RuntimeSettings.Muted = 0;
-  RuntimeSettings.InputLastVol[0] = 0;
-  RuntimeSettings.InputLastVol[1] = 0;
-  RuntimeSettings.InputLastVol[2] = 0;
-  RuntimeSettings.InputLastVol[3] = 0;
-  RuntimeSettings.InputLastVol[4] = 0;
-  RuntimeSettings.InputLastVol[5] = 0;
+  memset(RuntimeSettings.InputLastVol, 0, sizeof(RuntimeSettings.InputLastVol));
   RuntimeSettings.PrevSelectedInput = 0;
   RuntimeSettings.Version = VERSION;
 }
 
-// Write Settings to EEPROM
+// Mark size bytes of Settings from field as changed, so they are written by the next writeSettingsToEEPROM() - fields outside Settings are ignored
+void markSettingsDirty(const void *field, uint16_t size)
+{
+  uint16_t offset = (const byte *)field - Settings.data;
+
+  if ((const byte *)field < Settings.data || offset >= sizeof(Settings) || size == 0)
+    return;
+  for (uint8_t page = offset / EEPROM_PAGE_SIZE; page <= (offset + size - 1) / EEPROM_PAGE_SIZE && page < SETTINGS_PAGES; page++)
+    settingsDirtyPages |= 1U << page;
+}
+
+// Write the changed parts of Settings to EEPROM
+// The pages marked by markSettingsDirty() are written one at a time by the pollEEPROM() task - so the UI (and the power loss detection) keeps running while they are written
 void writeSettingsToEEPROM()
 {
-  // Write the settings to the EEPROM
-  eeprom.begin(extEEPROM::twiClock400kHz);
-  eeprom.write(0, Settings.data, sizeof(Settings));
+  if (!eeprom.busy())
+    writeNextSettingsPage();
+  if (eeprom.busy() || settingsDirtyPages)
+    scheduler.schedule(pollEEPROM, EEPROM_POLL_INTERVAL, EEPROM_POLL_INTERVAL);
+}
+
+// Start the write of the first page marked by markSettingsDirty() that differs from what the EEPROM holds - only the changed bytes of the page are written
+void writeNextSettingsPage()
+{
+  byte stored[EEPROM_PAGE_SIZE];
+
+  for (uint8_t page = 0; settingsDirtyPages && page < SETTINGS_PAGES; page++)
+  {
+    if (!(settingsDirtyPages & (1U << page)))
+      continue;
+    settingsDirtyPages &= ~(1U << page);
+
+    uint16_t start = page * EEPROM_PAGE_SIZE;
+    uint8_t length = min(sizeof(Settings) - start, (uint16_t)EEPROM_PAGE_SIZE);
+    uint8_t first = 0;
+    uint8_t last = length;
+
+    // Find the changed bytes of the page - if the page cannot be read it is written in full
+    if (eeprom.read(start, stored, length) == 0)
+    {
+      while (first < length && stored[first] == Settings.data[start + first])
+        first++;
+      while (last > first && stored[last - 1] == Settings.data[start + last - 1])
+        last--;
+    }
+    if (first < last)
+    {
+      eeprom.writeAsync(start + first, Settings.data + start + first, last - first);
+      return;
+    }
+  }
+}
+
+// Task moving the EEPROM writes along - when the EEPROM has completed a page the next dirty page of Settings is written
+void pollEEPROM()
+{
+  if (eeprom.poll() == EEPROM_BUSY)
+    return;
+  if (settingsDirtyPages)
+    writeNextSettingsPage();
+  if (!eeprom.busy())
+    scheduler.cancel(pollEEPROM);
 }
 
 // Read Settings from EEPROM
 void readSettingsFromEEPROM()
 {
   // Read settings from EEPROM
-  eeprom.begin(extEEPROM::twiClock400kHz);
   eeprom.read(0, Settings.data, sizeof(Settings));
 }
 
@@ -2117,39 +2743,113 @@ void writeDefaultSettingsToEEPROM()
   // Read default settings into Settings
   setSettingsToDefault();
   // Write the settings to the EEPROM
+  markSettingsDirty(Settings.data, sizeof(Settings));
   writeSettingsToEEPROM();
   // Write the runtime settings to the EEPROM
   writeRuntimeSettingsToEEPROM();
 }
 
-// Write the current runtime settings to EEPROM - called if a power drop is detected or if the EEPROM data is not valid or if the user chooses to reset all settings to default values
+// Write the current runtime settings to EEPROM as a new journal record - called if a power drop is detected, when the volume/input has settled, if the EEPROM data is not valid or if the user chooses to reset all settings to default values
+// The record is a single page write, which is sent before any dirty pages of Settings still waiting to be written (only a page already being written by the EEPROM is waited for)
 void writeRuntimeSettingsToEEPROM()
 {
-  // Write the settings to the EEPROM
-  eeprom.begin(extEEPROM::twiClock400kHz);
-  eeprom.write(sizeof(Settings) + 1, RuntimeSettings.data, sizeof(RuntimeSettings));
+  PROFILE_SECTION(PROFILE_RUNTIME_SAVE);
+  // Let the EEPROM complete the page it is writing before journalRecord is changed
+  eeprom.finishAsync();
+
+  journalRecord.Sequence = journalSequence;
+  memcpy(journalRecord.Data, RuntimeSettings.data, sizeof(RuntimeSettings));
+  journalRecord.CRC = crc8((byte *)&journalRecord, offsetof(JournalRecord, CRC));
+
+  // Write the record to the EEPROM
+  eeprom.writeAsync(JOURNAL_START + (uint16_t)journalSlot * JOURNAL_SLOT_SIZE, (byte *)&journalRecord, sizeof(journalRecord));
+  scheduler.schedule(pollEEPROM, EEPROM_POLL_INTERVAL, EEPROM_POLL_INTERVAL);
+  journalSequence++;
+  journalSlot = (journalSlot + 1) % JOURNAL_SLOTS;
+}
+
+// Task run when the volume/input has not been changed for RUNTIME_CHECKPOINT_DELAY
+void checkpointRuntimeSettings()
+{
+  writeRuntimeSettingsToEEPROM();
+}
+
+// Read the sequence number of the record in a journal slot
+uint16_t readJournalSequence(uint8_t slot)
+{
+  uint16_t sequence;
+  eeprom.read(JOURNAL_START + (uint16_t)slot * JOURNAL_SLOT_SIZE, (byte *)&sequence, sizeof(sequence));
+  return sequence;
 }
 
-// Read the last runtime settings from EEPROM
+// Read the newest valid runtime settings from the EEPROM journal. If no valid record is found RuntimeSettings is cleared (so the Version check fails and defaults are restored)
+// The records are written with consecutive sequence numbers to consecutive slots, so the slots from slot 0 up to the newest record hold a run of consecutive sequence numbers - the end of the run is found by a binary search of the sequence numbers, and only the newest record (or the one before it if its CRC fails) is read in full
 void readRuntimeSettingsFromEEPROM()
 {
-  // Read the settings from the EEPROM
-  eeprom.begin(extEEPROM::twiClock400kHz);
-  eeprom.read(sizeof(Settings) + 1, RuntimeSettings.data, sizeof(RuntimeSettings));
+  JournalRecord record;
+  uint16_t first = readJournalSequence(0);
+  uint8_t newest = 0;
+  uint8_t last = JOURNAL_SLOTS - 1;
+
+  // Find the last slot continuing the run of sequence numbers from slot 0
+  while (newest < last)
+  {
+    uint8_t middle = newest + (last - newest + 1) / 2;
+    if (readJournalSequence(middle) == (uint16_t)(first + middle))
+      newest = middle;
+    else
+      last = middle - 1;
+  }
+
+  memset(RuntimeSettings.data, 0, sizeof(RuntimeSettings));
+  // The journal goes on after the newest record - also if it is not valid, so the run of sequence numbers is kept
+  journalSequence = first + newest + 1;
+  journalSlot = (newest + 1) % JOURNAL_SLOTS;
+
+  // Use the newest record with a valid CRC - the newest may have been torn by a power loss while it was written
+  for (uint8_t i = 0; i < 2; i++)
+  {
+    uint8_t slot = (newest + JOURNAL_SLOTS - i) % JOURNAL_SLOTS;
+    eeprom.read(JOURNAL_START + (uint16_t)slot * JOURNAL_SLOT_SIZE, (byte *)&record, sizeof(record));
+    if (record.CRC == crc8((byte *)&record, offsetof(JournalRecord, CRC)))
+    {
+      memcpy(RuntimeSettings.data, record.Data, sizeof(RuntimeSettings));
+      return;
+    }
+  }
 }
 
-// Read the user defined settings from EEPROM
-void readUserSettingsFromEEPROM()
+// CRC8 (polynomial 0x31) used to validate the journal records
+byte crc8(const byte *data, uint8_t length)
+{
+  byte crc = 0xFF;
+  while (length--)
+  {
+    crc ^= *data++;
+    for (uint8_t i = 0; i < 8; i++)
+      crc = (crc & 0x80) ? (crc << 1) ^ 0x31 : crc << 1;
+  }
+  return crc;
+}
+
+// Read the user defined settings from EEPROM - returns false (and keeps the current settings) if no user settings have been saved by this version of the code
+bool readUserSettingsFromEEPROM()
 {
+  const uint16_t address = sizeof(Settings) + sizeof(RuntimeSettings) + 1;
+  float version;
+
+  // Check the Version first - the layout of the settings changes between versions, so settings saved by another version can't be used
+  eeprom.read(address + offsetof(mySettings, Version), (byte *)&version, sizeof(version));
+  if (version != (float)VERSION)
+    return false;
   // Read the settings from the EEPROM
-  eeprom.begin(extEEPROM::twiClock400kHz);
-  eeprom.read(sizeof(Settings) + sizeof(RuntimeSettings) + 1, Settings.data, sizeof(Settings));
+  eeprom.read(address, Settings.data, sizeof(Settings));
+  return true;
 }
 
 // Read the user defined settings from EEPROM
 void writeUserSettingsToEEPROM()
 {
   // Write the user settings to the EEPROM
-  eeprom.begin(extEEPROM::twiClock400kHz);
   eeprom.write(sizeof(Settings) + sizeof(RuntimeSettings) + 1, Settings.data, sizeof(Settings));
 }